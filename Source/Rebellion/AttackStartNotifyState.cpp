@@ -3,12 +3,12 @@
 
 #include "AttackStartNotifyState.h"
 #include "RebellionCharacter.h"
-#include "Engine.h"
+#include "RebellionLog.h"
+#include "Components/SkeletalMeshComponent.h"
 
 void UAttackStartNotifyState::NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration) 
 {
-	//Print message and leave on screen for a duration(4.5 currently)
-	GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Magenta, __FUNCTION__);
+	REB_LOG(TRACE, "AttackStartNotifyState begin");
 
 	if (MeshComp != NULL && MeshComp->GetOwner() != NULL) 
 	{
@@ -23,7 +23,7 @@ void UAttackStartNotifyState::NotifyBegin(USkeletalMeshComponent* MeshComp, UAni
 
 void UAttackStartNotifyState::NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation) 
 {
-	GEngine->AddOnScreenDebugMessage(-1, 4.5f, FColor::Magenta, __FUNCTION__);
+	REB_LOG(TRACE, "AttackStartNotifyState end");
 
 	if (MeshComp != NULL && MeshComp->GetOwner() != NULL)
 	{
@@ -32,23 +32,6 @@ void UAttackStartNotifyState::NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimS
 		if (player != NULL)
 		{
 			player->AttackEnd();
-			player->SetIsKeyboardEnabled(true);
-		}
-	}
-}
-
-void UAttackStartNotifyState::NotifyTick(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float frameDeltaTime)
-{
-	if (MeshComp != NULL && MeshComp->GetOwner() != NULL)
-	{
-		//this with the RebellionCharacter.h creates a reference to the player
-		ARebellionCharacter* player = Cast<ARebellionCharacter>(MeshComp->GetOwner());
-		if (player != NULL)
-		{
-			if(player->GetCurrentAttack() == EAttackType::MELEE_SECONDARY || player->GetCurrentAttack() == EAttackType::MELEE_PRIMARY)
-			{
-				player->SetIsKeyboardEnabled(false);
-			}
 		}
 	}
 }
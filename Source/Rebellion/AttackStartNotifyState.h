@@ -7,7 +7,8 @@
 #include "AttackStartNotifyState.generated.h"
 
 /**
- * 
+ * Opens and closes a character's attack window. Only the begin and end are forwarded,
+ * the weapon is swept by UCombatSubsystem while the window is open.
  */
 UCLASS()
 class REBELLION_API UAttackStartNotifyState : public UAnimNotifyState
@@ -18,5 +19,4 @@ public:
 
 	virtual void NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration) override;
 	virtual void NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation) override;
-	virtual void NotifyTick(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float frameDeltaTime) override;
 };
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttackWindowStateMachine.generated.h"
+
+/** Where a character is in its current attack, only changed through FAttackWindowStateMachine */
+UENUM(BlueprintType)
+enum class EAttackWindowState : uint8
+{
+	IDLE,
+	//Attack montage playing, window not open yet
+	WINDUP,
+	//Between the attack notify's begin and end: movement locked, hitbox on, weapon swept every frame
+	ACTIVE,
+	//Window closed, combo window open until the montage blends out
+	RECOVERY
+};
+
+/**
+ * Attack window transitions of one character, without the side effects so they can be tested on their own.
+ * Every event returns true if it changed the state, outPrevious is then the state left and
+ * ARebellionCharacter runs the side effects of that transition.
+ */
+struct FAttackWindowStateMachine
+{
+	/** A new attack replaces the current one, closing its window if it is still open */
+	bool StartAttack(EAttackWindowState& outPrevious)
+	{
+		//Bumped even when already winding up, the replaced montage's blend out must not end the new attack
+		serial++;
+		return SetState(EAttackWindowState::WINDUP, outPrevious);
+	}
+
+	/** The attack notify began */
+	bool NotifyBegin(EAttackWindowState& outPrevious)
+	{
+		return SetState(EAttackWindowState::ACTIVE, outPrevious);
+	}
+
+	/** The attack notify ended, ignored if the window was already closed by an interrupt or death */
+	bool NotifyEnd(EAttackWindowState& outPrevious)
+	{
+		if (state != EAttackWindowState::ACTIVE)
+		{
+			return false;
+		}
+		return SetState(EAttackWindowState::RECOVERY, outPrevious);
+	}
+
+	/** The montage of attack montageSerial finished, was interrupted or blended out. Ignored if a newer attack replaced it */
+	bool MontageBlendingOut(uint32 montageSerial, EAttackWindowState& outPrevious)
+	{
+		if (montageSerial != serial)
+		{
+			return false;
+		}
+		return SetState(EAttackWindowState::IDLE, outPrevious);
+	}
+
+	/** Ends the attack right away: death, end play or a montage that didn't play */
+	bool Stop(EAttackWindowState& outPrevious)
+	{
+		return SetState(EAttackWindowState::IDLE, outPrevious);
+	}
+
+	EAttackWindowState GetState() const { return state; }
+	/** Bumped per attack, identifies the attack montage events and weapon sweeps belong to */
+	uint32 GetSerial() const { return serial; }
+
+private:
+
+	bool SetState(EAttackWindowState newState, EAttackWindowState& outPrevious)
+	{
+		if (newState == state)
+		{
+			return false;
+		}
+		outPrevious = state;
+		state = newState;
+		return true;
+	}
+
+	EAttackWindowState state = EAttackWindowState::IDLE;
+	uint32 serial = 0;
+};
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatAudioSubsystem.h"
+#include "RebellionStats.h"
+#include "AudioDevice.h"
+#include "Components/AudioComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/WorldSettings.h"
+#include "Sound/SoundBase.h"
+
+//Voices each category may have playing at once, indexed by ECombatSound
+static const int32 maxVoicesPerCategory[] = { 8, 12, 4 };
+//Distance from the closest listener past which a category is not played, the sound's own attenuation can be shorter
+static const float maxAudibleDistances[] = { 2500.f, 4000.f, 3000.f };
+static_assert(UE_ARRAY_COUNT(maxVoicesPerCategory) == (int32)ECombatSound::COUNT, "Every category needs a voice limit");
+static_assert(UE_ARRAY_COUNT(maxAudibleDistances) == (int32)ECombatSound::COUNT, "Every category needs an audible distance");
+
+void UCombatAudioSubsystem::Deinitialize()
+{
+	for (const FCombatVoice& voice : voices)
+	{
+		if (voice.bActive)
+		{
+			DEC_DWORD_STAT(STAT_Rebellion_CombatAudioVoices);
+		}
+		if (voice.component)
+		{
+			voice.component->OnAudioFinishedNative.RemoveAll(this);
+			voice.component->Stop();
+			voice.component->DestroyComponent();
+		}
+	}
+	voices.Empty();
+	freeVoices.Empty();
+	pooledComponents.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UCombatAudioSubsystem::PlaySound(ECombatSound category, USoundBase* sound, const FVector& location, float pitchMultiplier)
+{
+	REBELLION_SCOPE(CombatAudioPlay);
+
+	if (!sound)
+	{
+		return false;
+	}
+
+	const int32 categoryIndex = (int32)category;
+	const float maxDistance = FMath::Min(maxAudibleDistances[categoryIndex], sound->GetMaxDistance());
+	if (activeVoiceCounts[categoryIndex] >= maxVoicesPerCategory[categoryIndex] || !IsAudible(location, maxDistance))
+	{
+		culledCount++;
+		INC_DWORD_STAT(STAT_Rebellion_CombatSoundsCulled);
+		return false;
+	}
+
+	const int32 voiceIndex = AcquireVoice();
+	if (voiceIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FCombatVoice& voice = voices[voiceIndex];
+	voice.category = category;
+	voice.bActive = true;
+	activeVoiceCounts[categoryIndex]++;
+	playedCount++;
+	INC_DWORD_STAT(STAT_Rebellion_CombatAudioVoices);
+
+	voice.component->SetWorldLocation(location);
+	voice.component->SetSound(sound);
+	voice.component->SetPitchMultiplier(pitchMultiplier);
+	voice.component->Play(0.f);
+	return true;
+}
+
+bool UCombatAudioSubsystem::IsAudible(const FVector& location, float maxDistance) const
+{
+	UWorld* world = GetWorld();
+	//No device on dedicated servers and -nosound runs, nothing can be heard
+	if (!world || !world->GetAudioDeviceRaw())
+	{
+		return false;
+	}
+
+	const float maxDistanceSquared = FMath::Square(maxDistance);
+	for (FConstPlayerControllerIterator iterator = world->GetPlayerControllerIterator(); iterator; ++iterator)
+	{
+		const APlayerController* controller = iterator->Get();
+		if (!controller || !controller->IsLocalController())
+		{
+			continue;
+		}
+
+		FVector listenerLocation;
+		FVector listenerFront;
+		FVector listenerRight;
+		controller->GetAudioListenerPosition(listenerLocation, listenerFront, listenerRight);
+		if (FVector::DistSquared(listenerLocation, location) <= maxDistanceSquared)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 UCombatAudioSubsystem::AcquireVoice()
+{
+	if (freeVoices.Num() > 0)
+	{
+		return freeVoices.Pop(false);
+	}
+
+	UWorld* world = GetWorld();
+	AWorldSettings* worldSettings = world ? world->GetWorldSettings() : nullptr;
+	if (!worldSettings)
+	{
+		return INDEX_NONE;
+	}
+
+	//Owned by the world settings so the components live exactly as long as the world
+	UAudioComponent* component = NewObject<UAudioComponent>(worldSettings, NAME_None, RF_Transient);
+	component->bAutoActivate = false;
+	component->bAutoDestroy = false;
+	component->bAllowSpatialization = true;
+	component->RegisterComponentWithWorld(world);
+	component->OnAudioFinishedNative.AddUObject(this, &UCombatAudioSubsystem::OnVoiceFinished);
+	pooledComponents.Add(component);
+
+	FCombatVoice& voice = voices.AddDefaulted_GetRef();
+	voice.component = component;
+	return voices.Num() - 1;
+}
+
+void UCombatAudioSubsystem::OnVoiceFinished(UAudioComponent* component)
+{
+	for (int32 voiceIndex = 0; voiceIndex < voices.Num(); voiceIndex++)
+	{
+		FCombatVoice& voice = voices[voiceIndex];
+		if (voice.component != component || !voice.bActive)
+		{
+			continue;
+		}
+
+		voice.bActive = false;
+		activeVoiceCounts[(int32)voice.category]--;
+		freeVoices.Add(voiceIndex);
+		DEC_DWORD_STAT(STAT_Rebellion_CombatAudioVoices);
+		return;
+	}
+}
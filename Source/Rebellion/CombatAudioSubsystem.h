@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatAudioSubsystem.generated.h"
+
+class UAudioComponent;
+class USoundBase;
+
+/** Combat sound categories, each with its own voice limit and audible distance */
+UENUM()
+enum class ECombatSound : uint8
+{
+	SWOOSH,
+	IMPACT,
+	BLOCK,
+	COUNT		UMETA(Hidden)
+};
+
+/**
+ * One pool of audio components for every combat one shot in the world, instead of a component per character.
+ * A sound is culled before a component is taken when its category is at its voice limit or no local
+ * listener is within its audible distance. Components return to the pool when playback finishes.
+ */
+UCLASS()
+class REBELLION_API UCombatAudioSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/** Plays sound at location, false if it was culled */
+	bool PlaySound(ECombatSound category, USoundBase* sound, const FVector& location, float pitchMultiplier = 1.f);
+
+	/** Components created so far, the pool never shrinks */
+	int32 GetPoolSize() const { return voices.Num(); }
+	int32 GetActiveVoiceCount(ECombatSound category) const { return activeVoiceCounts[(int32)category]; }
+	int32 GetPlayedCount() const { return playedCount; }
+	int32 GetCulledCount() const { return culledCount; }
+
+private:
+
+	struct FCombatVoice
+	{
+		UAudioComponent* component = nullptr;
+		ECombatSound category = ECombatSound::SWOOSH;
+		bool bActive = false;
+	};
+
+	bool IsAudible(const FVector& location, float maxDistance) const;
+	//Free voice, or a new component when every voice is playing
+	int32 AcquireVoice();
+	void OnVoiceFinished(UAudioComponent* component);
+
+	TArray<FCombatVoice> voices;
+	TArray<int32> freeVoices;
+	int32 activeVoiceCounts[(int32)ECombatSound::COUNT] = {};
+	int32 playedCount = 0;
+	int32 culledCount = 0;
+
+	//Keeps the pooled components alive, voices holds raw pointers into it
+	UPROPERTY(Transient)
+		TArray<UAudioComponent*> pooledComponents;
+};
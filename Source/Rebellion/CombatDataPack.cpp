@@ -0,0 +1,214 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatDataPack.h"
+#include "Rebellion.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+
+FCombatDataPack::FCombatDataPack() = default;
+
+FCombatDataPack::~FCombatDataPack()
+{
+	Close();
+}
+
+//A table of count records at offset has to end inside the file
+static bool IsTableInFile(uint32 offset, uint32 count, uint32 recordSize, uint32 fileSize)
+{
+	const uint64 end = (uint64)offset + (uint64)count * recordSize;
+	return offset % 4 == 0 && end <= fileSize;
+}
+
+bool FCombatDataPack::Open(const FString& inPath)
+{
+	Close();
+
+	IMappedFileHandle* fileHandle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*inPath);
+	if (!fileHandle)
+	{
+		return false;
+	}
+	mappedFile.Reset(fileHandle);
+
+	const int64 fileSize = mappedFile->GetFileSize();
+	if (fileSize < (int64)sizeof(FCombatPackHeader) || fileSize > MAX_uint32)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("%s is not a combat pack"), *inPath);
+		Close();
+		return false;
+	}
+
+	mappedRegion.Reset(mappedFile->MapRegion(0, fileSize));
+	if (!mappedRegion.IsValid())
+	{
+		Close();
+		return false;
+	}
+
+	const FCombatPackHeader& header = *reinterpret_cast<const FCombatPackHeader*>(mappedRegion->GetMappedPtr());
+	if (header.magic != combatPackMagic || header.version != combatPackVersion || header.fileSize != (uint32)fileSize)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("%s is combat pack version %u, expected %u, rebuild it with -run=RebellionCombatPack"), *inPath, header.magic == combatPackMagic ? header.version : 0, combatPackVersion);
+		Close();
+		return false;
+	}
+
+	if (!IsTableInFile(header.profileOffset, header.profileCount, sizeof(FCombatPackProfile), header.fileSize)
+		|| !IsTableInFile(header.attackOffset, header.attackCount, sizeof(FCombatPackAttack), header.fileSize)
+		|| !IsTableInFile(header.sectionOffset, header.sectionCount, sizeof(FCombatPackSection), header.fileSize)
+		|| (uint64)header.stringOffset + header.stringBytes > header.fileSize
+		|| (header.stringBytes > 0 && mappedRegion->GetMappedPtr()[header.stringOffset + header.stringBytes - 1] != 0))
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("%s is truncated or corrupt"), *inPath);
+		Close();
+		return false;
+	}
+
+	data = mappedRegion->GetMappedPtr();
+	path = inPath;
+	return true;
+}
+
+void FCombatDataPack::Close()
+{
+	data = nullptr;
+	mappedRegion.Reset();
+	mappedFile.Reset();
+	path.Reset();
+}
+
+TArrayView<const FCombatPackProfile> FCombatDataPack::GetProfiles() const
+{
+	const FCombatPackHeader& header = GetHeader();
+	return TArrayView<const FCombatPackProfile>(reinterpret_cast<const FCombatPackProfile*>(data + header.profileOffset), header.profileCount);
+}
+
+TArrayView<const FCombatPackAttack> FCombatDataPack::GetAttacks(const FCombatPackProfile& profile) const
+{
+	const FCombatPackHeader& header = GetHeader();
+	if ((uint64)profile.firstAttack + profile.attackCount > header.attackCount)
+	{
+		return TArrayView<const FCombatPackAttack>();
+	}
+	const FCombatPackAttack* attacks = reinterpret_cast<const FCombatPackAttack*>(data + header.attackOffset);
+	return TArrayView<const FCombatPackAttack>(attacks + profile.firstAttack, profile.attackCount);
+}
+
+TArrayView<const FCombatPackSection> FCombatDataPack::GetSections(const FCombatPackAttack& attack) const
+{
+	const FCombatPackHeader& header = GetHeader();
+	if ((uint64)attack.firstSection + attack.sectionCount > header.sectionCount)
+	{
+		return TArrayView<const FCombatPackSection>();
+	}
+	const FCombatPackSection* sections = reinterpret_cast<const FCombatPackSection*>(data + header.sectionOffset);
+	return TArrayView<const FCombatPackSection>(sections + attack.firstSection, attack.sectionCount);
+}
+
+const ANSICHAR* FCombatDataPack::GetString(uint32 offset) const
+{
+	const FCombatPackHeader& header = GetHeader();
+	if (offset >= header.stringBytes)
+	{
+		return "";
+	}
+	//Open checked the table ends with a terminator
+	return reinterpret_cast<const ANSICHAR*>(data + header.stringOffset + offset);
+}
+
+const FCombatPackProfile* FCombatDataPack::FindProfile(const FString& classPath) const
+{
+	const FTCHARToUTF8 classPathUtf8(*classPath);
+	for (const FCombatPackProfile& profile : GetProfiles())
+	{
+		if (FCStringAnsi::Strcmp(GetString(profile.classPathOffset), classPathUtf8.Get()) == 0)
+		{
+			return &profile;
+		}
+	}
+	return nullptr;
+}
+
+const FCombatPackAttack* FCombatDataPack::FindAttack(const FCombatPackProfile& profile, FName rowName) const
+{
+	const FString rowString = rowName.ToString();
+	const FTCHARToUTF8 rowUtf8(*rowString);
+	for (const FCombatPackAttack& attack : GetAttacks(profile))
+	{
+		if (FCStringAnsi::Strcmp(GetString(attack.nameOffset), rowUtf8.Get()) == 0)
+		{
+			return &attack;
+		}
+	}
+	return nullptr;
+}
+
+void FCombatDataPackWriter::AddProfile(const FString& classPath, const FCombatPackMovement& movement)
+{
+	FCombatPackProfile& profile = profiles.AddDefaulted_GetRef();
+	profile.classPathOffset = AddString(classPath);
+	profile.movement = movement;
+	profile.firstAttack = attacks.Num();
+	profile.attackCount = 0;
+}
+
+void FCombatDataPackWriter::AddAttack(const FString& rowName, const FString& montagePath, float damage)
+{
+	check(profiles.Num() > 0);
+
+	FCombatPackAttack& attack = attacks.AddDefaulted_GetRef();
+	attack.nameOffset = AddString(rowName);
+	attack.montagePathOffset = AddString(montagePath);
+	attack.damage = damage;
+	attack.firstSection = sections.Num();
+	attack.sectionCount = 0;
+	profiles.Last().attackCount++;
+}
+
+void FCombatDataPackWriter::AddSection(const FString& sectionName, int32 nextStep)
+{
+	check(attacks.Num() > 0);
+
+	FCombatPackSection& section = sections.AddDefaulted_GetRef();
+	section.nameOffset = AddString(sectionName);
+	section.nextStep = nextStep;
+	attacks.Last().sectionCount++;
+}
+
+uint32 FCombatDataPackWriter::AddString(const FString& value)
+{
+	const uint32 offset = strings.Num();
+	FTCHARToUTF8 utf8(*value);
+	strings.Append(utf8.Get(), utf8.Length());
+	strings.Add(0);
+	return offset;
+}
+
+bool FCombatDataPackWriter::Save(const FString& outputPath) const
+{
+	FCombatPackHeader header = {};
+	header.magic = combatPackMagic;
+	header.version = combatPackVersion;
+	header.profileCount = profiles.Num();
+	header.profileOffset = sizeof(FCombatPackHeader);
+	header.attackCount = attacks.Num();
+	header.attackOffset = header.profileOffset + profiles.Num() * sizeof(FCombatPackProfile);
+	header.sectionCount = sections.Num();
+	header.sectionOffset = header.attackOffset + attacks.Num() * sizeof(FCombatPackAttack);
+	header.stringOffset = header.sectionOffset + sections.Num() * sizeof(FCombatPackSection);
+	header.stringBytes = strings.Num();
+	header.fileSize = header.stringOffset + header.stringBytes;
+
+	TArray<uint8> bytes;
+	bytes.Reserve(header.fileSize);
+	bytes.Append(reinterpret_cast<const uint8*>(&header), sizeof(header));
+	bytes.Append(reinterpret_cast<const uint8*>(profiles.GetData()), profiles.Num() * sizeof(FCombatPackProfile));
+	bytes.Append(reinterpret_cast<const uint8*>(attacks.GetData()), attacks.Num() * sizeof(FCombatPackAttack));
+	bytes.Append(reinterpret_cast<const uint8*>(sections.GetData()), sections.Num() * sizeof(FCombatPackSection));
+	bytes.Append(reinterpret_cast<const uint8*>(strings.GetData()), strings.Num());
+	check(bytes.Num() == header.fileSize);
+
+	return FFileHelper::SaveArrayToFile(bytes, *outputPath);
+}
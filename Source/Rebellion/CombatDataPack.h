@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * .rcpk combat pack layout. Every record is plain 4 byte fields so the file is read in place
+ * from a mapped region, offsets are bytes from the start of the file. Little endian only.
+ *
+ *	FCombatPackHeader
+ *	FCombatPackProfile[profileCount]		one per baked character class
+ *	FCombatPackAttack[attackCount]			each profile's attacks are contiguous
+ *	FCombatPackSection[sectionCount]		each attack's combo steps are contiguous
+ *	UTF-8 strings, null terminated
+ *
+ * Written by URebellionCombatPackCommandlet, bump combatPackVersion for any layout change.
+ */
+static constexpr uint32 combatPackMagic = 0x4B504352;	//"RCPK"
+static constexpr uint32 combatPackVersion = 2;
+
+/** Character movement tuning that used to be hard coded in the constructor */
+struct FCombatPackMovement
+{
+	float jumpHeight;
+	float walkSpeed;
+	float sprintSpeed;
+	float dashDistance;
+	float dashCooldown;
+	float dashStopTimer;
+};
+
+struct FCombatPackHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint32 fileSize;
+	uint32 profileCount;
+	uint32 profileOffset;
+	uint32 attackCount;
+	uint32 attackOffset;
+	uint32 sectionCount;
+	uint32 sectionOffset;
+	uint32 stringBytes;
+	uint32 stringOffset;
+};
+
+/** Tuning and attack rows of one character class, only applied to characters of exactly that class */
+struct FCombatPackProfile
+{
+	//Class path the profile was baked from, "/Game/.../ThirdPersonCharacter.ThirdPersonCharacter_C"
+	uint32 classPathOffset;
+	FCombatPackMovement movement;
+	//Attack rows in the attack table
+	uint32 firstAttack;
+	uint32 attackCount;
+};
+
+/** One attack row */
+struct FCombatPackAttack
+{
+	//Data table row name, "PrimaryAttack"
+	uint32 nameOffset;
+	//Montage object path
+	uint32 montagePathOffset;
+	float damage;
+	//Combo steps in the section table
+	uint32 firstSection;
+	uint32 sectionCount;
+};
+
+/** One combo step of an attack, a montage section */
+struct FCombatPackSection
+{
+	uint32 nameOffset;
+	//Step chained from this one's combo window, relative to the attack's firstSection
+	int32 nextStep;
+};
+
+static_assert(sizeof(FCombatPackMovement) == 6 * 4, "Pack records must stay 4 byte fields");
+static_assert(sizeof(FCombatPackHeader) == 11 * 4, "Pack records must stay 4 byte fields");
+static_assert(sizeof(FCombatPackProfile) == 9 * 4, "Pack records must stay 4 byte fields");
+static_assert(sizeof(FCombatPackAttack) == 5 * 4, "Pack records must stay 4 byte fields");
+static_assert(sizeof(FCombatPackSection) == 2 * 4, "Pack records must stay 4 byte fields");
+
+/**
+ * A mapped .rcpk. Open only checks the header and that every table lies inside the file,
+ * so opening costs the same for any number of rows; nothing is copied or deserialised.
+ */
+class REBELLION_API FCombatDataPack
+{
+public:
+
+	FCombatDataPack();
+	~FCombatDataPack();
+
+	FCombatDataPack(const FCombatDataPack&) = delete;
+	FCombatDataPack& operator=(const FCombatDataPack&) = delete;
+
+	bool Open(const FString& path);
+	void Close();
+	bool IsOpen() const { return data != nullptr; }
+
+	const FCombatPackHeader& GetHeader() const { return *reinterpret_cast<const FCombatPackHeader*>(data); }
+	TArrayView<const FCombatPackProfile> GetProfiles() const;
+	TArrayView<const FCombatPackAttack> GetAttacks(const FCombatPackProfile& profile) const;
+	TArrayView<const FCombatPackSection> GetSections(const FCombatPackAttack& attack) const;
+
+	/** Null terminated UTF-8, empty for an offset outside the string table */
+	const ANSICHAR* GetString(uint32 offset) const;
+
+	/** Profile baked from the class at classPath, null if the pack doesn't have one */
+	const FCombatPackProfile* FindProfile(const FString& classPath) const;
+
+	/** Attack row of a profile by data table row name, null if the profile doesn't have it */
+	const FCombatPackAttack* FindAttack(const FCombatPackProfile& profile, FName rowName) const;
+
+	const FString& GetPath() const { return path; }
+
+private:
+
+	TUniquePtr<IMappedFileHandle> mappedFile;
+	TUniquePtr<IMappedFileRegion> mappedRegion;
+	const uint8* data = nullptr;
+	FString path;
+};
+
+/** Builds a pack in memory, used by the commandlet */
+class REBELLION_API FCombatDataPackWriter
+{
+public:
+
+	/** Starts a class profile, the following AddAttack calls are its attack rows */
+	void AddProfile(const FString& classPath, const FCombatPackMovement& movement);
+
+	/** Starts an attack row, the following AddSection calls are its combo steps */
+	void AddAttack(const FString& rowName, const FString& montagePath, float damage);
+	void AddSection(const FString& sectionName, int32 nextStep);
+
+	bool Save(const FString& path) const;
+
+private:
+
+	uint32 AddString(const FString& value);
+
+	TArray<FCombatPackProfile> profiles;
+	TArray<FCombatPackAttack> attacks;
+	TArray<FCombatPackSection> sections;
+	TArray<ANSICHAR> strings;
+};
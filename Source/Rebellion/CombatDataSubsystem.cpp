@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatDataSubsystem.h"
+#include "Rebellion.h"
+#include "CoreGlobals.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+
+void UCombatDataSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (GIsEditor && !FParse::Param(FCommandLine::Get(), TEXT("CombatPack")))
+	{
+		return;
+	}
+	Reload();
+}
+
+void UCombatDataSubsystem::Deinitialize()
+{
+	pack.Close();
+
+	Super::Deinitialize();
+}
+
+bool UCombatDataSubsystem::Reload()
+{
+	const double startSeconds = FPlatformTime::Seconds();
+	const FString path = GetDefaultPackPath();
+	if (!pack.Open(path))
+	{
+		UE_LOG(LogRebellion, Log, TEXT("No combat pack at %s, using the attack data table"), *path);
+		return false;
+	}
+
+	UE_LOG(LogRebellion, Log, TEXT("Mapped combat pack %s: %u profiles, %u attacks, %u bytes in %.3f ms"),
+		*path, pack.GetHeader().profileCount, pack.GetHeader().attackCount, pack.GetHeader().fileSize, (FPlatformTime::Seconds() - startSeconds) * 1000.0);
+	return true;
+}
+
+FString UCombatDataSubsystem::GetDefaultPackPath()
+{
+	return FPaths::ProjectContentDir() / TEXT("CombatData") / TEXT("Combat.rcpk");
+}
+
+namespace CombatDataConsole
+{
+	static void ReloadPack(const TArray<FString>& args, UWorld* world)
+	{
+		UGameInstance* gameInstance = world ? world->GetGameInstance() : nullptr;
+		if (UCombatDataSubsystem* combatData = gameInstance ? gameInstance->GetSubsystem<UCombatDataSubsystem>() : nullptr)
+		{
+			combatData->Reload();
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs reloadCommand(
+		TEXT("Rebellion.CombatPack.Reload"),
+		TEXT("Maps Content/CombatData/Combat.rcpk again after -run=RebellionCombatPack, characters spawned afterwards use it"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReloadPack));
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "CombatDataPack.h"
+#include "CombatDataSubsystem.generated.h"
+
+/**
+ * Maps Content/CombatData/Combat.rcpk for the life of the game instance. Characters whose class has a
+ * profile in it take their attack rows, combo graph and movement tuning from it; any other class, and
+ * every class without a pack, uses its own data table and defaults. The editor uses the live data table unless started with -CombatPack,
+ * so designers see their changes without rebuilding the pack.
+ */
+UCLASS()
+class REBELLION_API UCombatDataSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** The mapped pack, null when running from the data table */
+	const FCombatDataPack* GetPack() const { return pack.IsOpen() ? &pack : nullptr; }
+
+	/** Maps the pack again after a rebuild, characters spawned afterwards use the new values */
+	bool Reload();
+
+	/** Where the commandlet writes and the game reads the pack */
+	static FString GetDefaultPackPath();
+
+private:
+
+	FCombatDataPack pack;
+};
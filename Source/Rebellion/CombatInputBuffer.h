@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EAttackType : uint8;
+
+/** One attack press, stamped with FPlatformTime::Cycles64 when the input binding fired */
+struct FBufferedAttackInput
+{
+	EAttackType attackType;
+	uint64 pressCycles;
+};
+
+/**
+ * Fixed size ring of attack presses, oldest first. Presses made during an attack wait here
+ * until the combo window opens instead of being dropped or restarting the montage.
+ * A full buffer drops its oldest press.
+ */
+struct FAttackInputBuffer
+{
+	static constexpr uint32 Capacity = 8;
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	void Push(EAttackType attackType, uint64 pressCycles)
+	{
+		if (Num() == Capacity)
+		{
+			head++;
+		}
+		FBufferedAttackInput& press = presses[tail++ & (Capacity - 1)];
+		press.attackType = attackType;
+		press.pressCycles = pressCycles;
+	}
+
+	bool Pop(FBufferedAttackInput& outPress)
+	{
+		if (IsEmpty())
+		{
+			return false;
+		}
+		outPress = presses[head++ & (Capacity - 1)];
+		return true;
+	}
+
+	/** Drops presses stamped before minPressCycles */
+	void DropOlderThan(uint64 minPressCycles)
+	{
+		while (!IsEmpty() && presses[head & (Capacity - 1)].pressCycles < minPressCycles)
+		{
+			head++;
+		}
+	}
+
+	int32 Num() const { return (int32)(tail - head); }
+	bool IsEmpty() const { return head == tail; }
+	void Reset() { head = tail = 0; }
+
+private:
+
+	FBufferedAttackInput presses[Capacity];
+	//Free running, only the low bits index presses
+	uint32 head = 0;
+	uint32 tail = 0;
+};
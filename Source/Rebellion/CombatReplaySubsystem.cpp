@@ -0,0 +1,778 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatReplaySubsystem.h"
+#include "Rebellion.h"
+#include "RebellionCharacter.h"
+#include "RangedCharacter.h"
+#include "RebellionGameMode.h"
+#include "RebellionBenchmarkSubsystem.h"
+#include "ScriptedInput.h"
+#include "CoreGlobals.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+
+//"RBRP", then the format version
+static const uint32 replayMagic = 0x50524252;
+static const uint32 replayVersion = 1;
+
+//Axis values are logged in 127ths, what a gamepad stick resolves anyway
+static const float axisSteps = 127.f;
+
+//Camera axes aren't logged, their result is, as the control rotation
+static const FName recordedAxisNames[] = { FName(TEXT("MoveForward")), FName(TEXT("MoveRight")) };
+
+//A chunk goes to the writer when it is this big, or after this many frames so a crash loses little
+static const int32 flushBytes = 4096;
+static const uint32 flushFrames = 60;
+
+void FCombatReplayVarint::Write(TArray<uint8>& buffer, uint64 value)
+{
+	do
+	{
+		const uint8 byte = (uint8)(value & 0x7f);
+		value >>= 7;
+		buffer.Add(value != 0 ? byte | 0x80 : byte);
+	} while (value != 0);
+}
+
+bool FCombatReplayVarint::Read(const TArray<uint8>& buffer, int32& offset, uint64& outValue)
+{
+	outValue = 0;
+	for (int32 shift = 0; shift < 64; shift += 7)
+	{
+		if (offset >= buffer.Num())
+		{
+			return false;
+		}
+		const uint8 byte = buffer[offset++];
+		outValue |= (uint64)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+TUniquePtr<FCombatReplayWriter> FCombatReplayWriter::Create(const FString& path)
+{
+	FArchive* file = IFileManager::Get().CreateFileWriter(*path);
+	if (!file)
+	{
+		return nullptr;
+	}
+
+	TUniquePtr<FCombatReplayWriter> writer(new FCombatReplayWriter(file));
+	//Without threads Enqueue writes straight away
+	if (FPlatformProcess::SupportsMultithreading())
+	{
+		writer->thread = FRunnableThread::Create(writer.Get(), TEXT("CombatReplayWriter"), 0, TPri_BelowNormal);
+	}
+	return writer;
+}
+
+FCombatReplayWriter::FCombatReplayWriter(FArchive* inFile)
+	: file(inFile)
+	, wakeEvent(FPlatformProcess::GetSynchEventFromPool())
+{
+}
+
+FCombatReplayWriter::~FCombatReplayWriter()
+{
+	Stop();
+	if (thread)
+	{
+		thread->WaitForCompletion();
+		delete thread;
+	}
+	else
+	{
+		WriteQueued();
+	}
+	FPlatformProcess::ReturnSynchEventToPool(wakeEvent);
+	file->Close();
+}
+
+void FCombatReplayWriter::Enqueue(TArray<uint8>&& chunk)
+{
+	chunks.Enqueue(MoveTemp(chunk));
+	if (thread)
+	{
+		wakeEvent->Trigger();
+	}
+	else
+	{
+		WriteQueued();
+	}
+}
+
+uint32 FCombatReplayWriter::Run()
+{
+	while (!bStopping)
+	{
+		wakeEvent->Wait();
+		WriteQueued();
+	}
+	//Chunks queued between the last wake and Stop
+	WriteQueued();
+	return 0;
+}
+
+void FCombatReplayWriter::Stop()
+{
+	bStopping = true;
+	wakeEvent->Trigger();
+}
+
+void FCombatReplayWriter::WriteQueued()
+{
+	bool bWrote = false;
+	TArray<uint8> chunk;
+	while (chunks.Dequeue(chunk))
+	{
+		file->Serialize(chunk.GetData(), chunk.Num());
+		bWrote = true;
+	}
+	//On disk before the next chunk, a crashed session keeps everything but the queue
+	if (bWrote)
+	{
+		file->Flush();
+	}
+}
+
+void UCombatReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* world = GetWorld();
+	if (!world || !world->IsGameWorld())
+	{
+		return;
+	}
+
+	worldTickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UCombatReplaySubsystem::OnWorldTickStart);
+
+	//Command line sessions cover the first game world only, a map change doesn't start another
+	static bool bCommandLineHandled = false;
+	if (bCommandLineHandled)
+	{
+		return;
+	}
+	bCommandLineHandled = true;
+
+	FString path;
+	if (FParse::Value(FCommandLine::Get(), TEXT("RebellionReplay="), path))
+	{
+		StartPlayback(path, FParse::Param(FCommandLine::Get(), TEXT("ReplayExit")));
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("RebellionRecord="), path) || FParse::Param(FCommandLine::Get(), TEXT("RebellionRecord")))
+	{
+		StartRecording(path);
+	}
+}
+
+void UCombatReplaySubsystem::Deinitialize()
+{
+	StopRecording();
+	StopPlayback();
+	FWorldDelegates::OnWorldTickStart.Remove(worldTickStartHandle);
+
+	Super::Deinitialize();
+}
+
+void UCombatReplaySubsystem::StartRecording(const FString& path)
+{
+	if (mode != EMode::NONE)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("Combat replay already recording or playing"));
+		return;
+	}
+
+	replayPath = !path.IsEmpty() ? path
+		: FPaths::ProjectSavedDir() / TEXT("Replays") / FString::Printf(TEXT("Combat_%s.rbreplay"), *FDateTime::Now().ToString());
+	writer = FCombatReplayWriter::Create(replayPath);
+	if (!writer)
+	{
+		UE_LOG(LogRebellion, Error, TEXT("Could not open combat replay %s for writing"), *replayPath);
+		return;
+	}
+
+	mode = EMode::RECORD_PENDING;
+	UE_LOG(LogRebellion, Display, TEXT("Recording combat replay to %s"), *FPaths::ConvertRelativePathToFull(replayPath));
+}
+
+void UCombatReplaySubsystem::StopRecording()
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	if (mode == EMode::RECORDING)
+	{
+		BeginEvent(ECombatReplayEvent::END);
+		FlushRecording(true);
+		UE_LOG(LogRebellion, Display, TEXT("Combat replay %s: %u frames, %d events, %lld bytes"), *replayPath, frame + 1, recordedEvents, recordedBytes);
+	}
+
+	//Waits for the writer thread to finish the file
+	writer.Reset();
+	mode = EMode::NONE;
+	buffer.Empty();
+	nameIndices.Reset();
+	recordedAxisValues.Reset();
+}
+
+void UCombatReplaySubsystem::StartPlayback(const FString& path, bool bExitWhenDone)
+{
+	if (mode != EMode::NONE)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("Combat replay already recording or playing"));
+		return;
+	}
+
+	if (!FFileHelper::LoadFileToArray(replay, *path))
+	{
+		UE_LOG(LogRebellion, Error, TEXT("Could not read combat replay %s"), *path);
+		return;
+	}
+
+	replayPath = path;
+	bExitWhenPlaybackDone = bExitWhenDone;
+	mode = EMode::PLAY_PENDING;
+}
+
+void UCombatReplaySubsystem::StopPlayback()
+{
+	if (mode == EMode::PLAYING)
+	{
+		FinishPlayback(TEXT("stopped"));
+	}
+	else if (mode == EMode::PLAY_PENDING)
+	{
+		mode = EMode::NONE;
+		replay.Empty();
+	}
+}
+
+void UCombatReplaySubsystem::WrapPlayerInput(APawn* pawn, UInputComponent* inputComponent)
+{
+	if (!pawn->IsPlayerControlled() || !pawn->IsLocallyControlled())
+	{
+		return;
+	}
+
+	//The wrappers stay for the component's lifetime and only log while recording
+	TWeakObjectPtr<UCombatReplaySubsystem> weakThis(this);
+	for (int32 index = 0; index < inputComponent->GetNumActionBindings(); index++)
+	{
+		FInputActionBinding& binding = inputComponent->GetActionBinding(index);
+		if ((binding.KeyEvent != IE_Pressed && binding.KeyEvent != IE_Released) || !binding.ActionDelegate.IsBound())
+		{
+			continue;
+		}
+
+		const FInputActionUnifiedDelegate handler = binding.ActionDelegate;
+		const FName actionName = binding.GetActionName();
+		const EInputEvent keyEvent = binding.KeyEvent;
+		binding.ActionDelegate.GetDelegateWithKeyForManualSet().BindLambda([weakThis, handler, actionName, keyEvent](FKey key)
+		{
+			UCombatReplaySubsystem* replaySubsystem = weakThis.Get();
+			if (replaySubsystem && replaySubsystem->mode == EMode::RECORDING)
+			{
+				replaySubsystem->RecordAction(actionName, keyEvent);
+			}
+			handler.Execute(key);
+		});
+	}
+
+	for (FInputAxisBinding& binding : inputComponent->AxisBindings)
+	{
+		if (!MakeArrayView(recordedAxisNames).Contains(binding.AxisName) || !binding.AxisDelegate.IsBound())
+		{
+			continue;
+		}
+
+		const FInputAxisUnifiedDelegate handler = binding.AxisDelegate;
+		const FName axisName = binding.AxisName;
+		binding.AxisDelegate.GetDelegateForManualSet().BindLambda([weakThis, handler, axisName](float value)
+		{
+			UCombatReplaySubsystem* replaySubsystem = weakThis.Get();
+			handler.Execute(replaySubsystem && replaySubsystem->mode == EMode::RECORDING ? replaySubsystem->RecordAxis(axisName, value) : value);
+		});
+	}
+}
+
+void UCombatReplaySubsystem::OnWorldTickStart(UWorld* world, ELevelTick tickType, float deltaSeconds)
+{
+	if (world != GetWorld())
+	{
+		return;
+	}
+
+	switch (mode)
+	{
+	case EMode::RECORD_PENDING:
+		if (APawn* pawn = GetPlayerPawn())
+		{
+			BeginRecording();
+			RecordControlRotation(pawn);
+		}
+		break;
+
+	case EMode::RECORDING:
+		frame++;
+		if (APawn* pawn = GetPlayerPawn())
+		{
+			RecordControlRotation(pawn);
+		}
+		FlushRecording(false);
+		break;
+
+	case EMode::PLAY_PENDING:
+		if (APawn* pawn = GetPlayerPawn())
+		{
+			if (BeginPlayback(pawn))
+			{
+				PlayFrame();
+			}
+			else
+			{
+				mode = EMode::NONE;
+				replay.Empty();
+			}
+		}
+		break;
+
+	case EMode::PLAYING:
+		//Times of the frame that just ended
+		frameMs.Add(FApp::GetDeltaTime() * 1000.f);
+		gameThreadMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+		frame++;
+		if (!playbackPawn.IsValid())
+		{
+			FinishPlayback(TEXT("pawn destroyed"));
+			break;
+		}
+		PlayFrame();
+		break;
+
+	default:
+		break;
+	}
+}
+
+APawn* UCombatReplaySubsystem::GetPlayerPawn() const
+{
+	UWorld* world = GetWorld();
+	APlayerController* playerController = world->GetFirstPlayerController();
+	APawn* pawn = playerController ? playerController->GetPawn() : nullptr;
+	if (!pawn || !pawn->HasActorBegunPlay())
+	{
+		return nullptr;
+	}
+
+	//Same start as the benchmark, the combat preload hitches the first frames
+	const ARebellionGameMode* rebellionGameMode = Cast<ARebellionGameMode>(world->GetAuthGameMode());
+	return !rebellionGameMode || rebellionGameMode->IsCombatPreloadComplete() ? pawn : nullptr;
+}
+
+void UCombatReplaySubsystem::ResetRandomSeed(int32 inSeed) const
+{
+	//RandRange and FRand draw from the first, SRand from the second
+	FMath::RandInit(inSeed);
+	FMath::SRandInit(inSeed);
+}
+
+void UCombatReplaySubsystem::BeginRecording()
+{
+	if (!FParse::Value(FCommandLine::Get(), TEXT("RebellionSeed="), seed))
+	{
+		seed = (int32)(FPlatformTime::Cycles() & MAX_int32);
+	}
+	ResetRandomSeed(seed);
+
+	frame = 0;
+	lastEventFrame = 0;
+	lastFlushFrame = 0;
+	recordedBytes = 0;
+	recordedEvents = 0;
+	bHasRecordedRotation = false;
+	buffer.Reset();
+	nameIndices.Reset();
+	recordedAxisValues.Reset();
+
+	//Magic, version, seed, the fixed frame time in microseconds or 0, map
+	for (int32 shift = 0; shift < 32; shift += 8)
+	{
+		buffer.Add((uint8)(replayMagic >> shift));
+	}
+	FCombatReplayVarint::Write(buffer, replayVersion);
+	FCombatReplayVarint::Write(buffer, FCombatReplayVarint::ZigZag(seed));
+	FCombatReplayVarint::Write(buffer, FApp::UseFixedTimeStep() ? (uint64)FMath::RoundToInt(FApp::GetFixedDeltaTime() * 1000000.0) : 0);
+	WriteString(UWorld::RemovePIEPrefix(GetWorld()->GetMapName()));
+
+	mode = EMode::RECORDING;
+	UE_LOG(LogRebellion, Display, TEXT("Combat replay recording started, seed %d"), seed);
+}
+
+void UCombatReplaySubsystem::RecordAction(FName actionName, EInputEvent keyEvent)
+{
+	const uint32 nameIndex = GetNameIndex(actionName);
+	BeginEvent(keyEvent == IE_Pressed ? ECombatReplayEvent::ACTION_PRESSED : ECombatReplayEvent::ACTION_RELEASED);
+	FCombatReplayVarint::Write(buffer, nameIndex);
+}
+
+float UCombatReplaySubsystem::RecordAxis(FName axisName, float value)
+{
+	const int32 quantized = FMath::RoundToInt(value * axisSteps);
+	const int32* recorded = recordedAxisValues.Find(axisName);
+	if (recorded ? *recorded != quantized : quantized != 0)
+	{
+		const uint32 nameIndex = GetNameIndex(axisName);
+		BeginEvent(ECombatReplayEvent::AXIS);
+		FCombatReplayVarint::Write(buffer, nameIndex);
+		FCombatReplayVarint::Write(buffer, FCombatReplayVarint::ZigZag(quantized));
+		recordedAxisValues.Add(axisName, quantized);
+	}
+	return quantized / axisSteps;
+}
+
+void UCombatReplaySubsystem::RecordControlRotation(APawn* pawn)
+{
+	AController* controller = pawn->GetController();
+	if (!controller)
+	{
+		return;
+	}
+
+	//Movement input this frame reads the rotation playback will set, not the unquantized one
+	const FRotator rotation = controller->GetControlRotation();
+	const uint16 pitch = FRotator::CompressAxisToShort(rotation.Pitch);
+	const uint16 yaw = FRotator::CompressAxisToShort(rotation.Yaw);
+	controller->SetControlRotation(FRotator(FRotator::DecompressAxisFromShort(pitch), FRotator::DecompressAxisFromShort(yaw), rotation.Roll));
+
+	if (bHasRecordedRotation && pitch == recordedPitch && yaw == recordedYaw)
+	{
+		return;
+	}
+	BeginEvent(ECombatReplayEvent::CONTROL_ROTATION);
+	FCombatReplayVarint::Write(buffer, pitch);
+	FCombatReplayVarint::Write(buffer, yaw);
+	recordedPitch = pitch;
+	recordedYaw = yaw;
+	bHasRecordedRotation = true;
+}
+
+uint32 UCombatReplaySubsystem::GetNameIndex(FName name)
+{
+	if (const uint32* index = nameIndices.Find(name))
+	{
+		return *index;
+	}
+
+	const uint32 index = nameIndices.Num();
+	nameIndices.Add(name, index);
+	BeginEvent(ECombatReplayEvent::NAME);
+	FCombatReplayVarint::Write(buffer, index);
+	WriteString(name.ToString());
+	return index;
+}
+
+void UCombatReplaySubsystem::BeginEvent(ECombatReplayEvent type)
+{
+	FCombatReplayVarint::Write(buffer, frame - lastEventFrame);
+	buffer.Add((uint8)type);
+	lastEventFrame = frame;
+	recordedEvents++;
+}
+
+void UCombatReplaySubsystem::WriteString(const FString& value)
+{
+	const FTCHARToUTF8 utf8(*value);
+	FCombatReplayVarint::Write(buffer, utf8.Length());
+	buffer.Append((const uint8*)utf8.Get(), utf8.Length());
+}
+
+void UCombatReplaySubsystem::FlushRecording(bool bForce)
+{
+	if (buffer.Num() == 0 || (!bForce && buffer.Num() < flushBytes && frame - lastFlushFrame < flushFrames))
+	{
+		return;
+	}
+
+	recordedBytes += buffer.Num();
+	writer->Enqueue(MoveTemp(buffer));
+	buffer.Reset();
+	lastFlushFrame = frame;
+}
+
+bool UCombatReplaySubsystem::BeginPlayback(APawn* pawn)
+{
+	readOffset = 0;
+	names.Reset();
+	heldAxisValues.Reset();
+	playedEvents = 0;
+	frameMs.Reset();
+	gameThreadMs.Reset();
+
+	uint32 magic = 0;
+	for (int32 shift = 0; shift < 32 && readOffset < replay.Num(); shift += 8)
+	{
+		magic |= (uint32)replay[readOffset++] << shift;
+	}
+	uint64 version = 0;
+	uint64 zigZagSeed = 0;
+	uint64 fixedFrameMicros = 0;
+	FString mapName;
+	if (magic != replayMagic || !FCombatReplayVarint::Read(replay, readOffset, version) || version != replayVersion
+		|| !FCombatReplayVarint::Read(replay, readOffset, zigZagSeed) || !FCombatReplayVarint::Read(replay, readOffset, fixedFrameMicros) || !ReadString(mapName))
+	{
+		UE_LOG(LogRebellion, Error, TEXT("%s is not a version %u combat replay"), *replayPath, replayVersion);
+		return false;
+	}
+
+	const FString currentMapName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+	if (mapName != currentMapName)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("Combat replay was recorded on %s, playing on %s"), *mapName, *currentMapName);
+	}
+	if (fixedFrameMicros == 0)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("Combat replay was recorded with variable frame times, inputs land on the same frames but not the same times"));
+	}
+	else if (!FApp::UseFixedTimeStep() || FMath::Abs(FApp::GetFixedDeltaTime() * 1000000.0 - fixedFrameMicros) > 1.0)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("Combat replay was recorded at a fixed %.2f fps, run with -benchmark -fps=%.0f to match"), 1000000.0 / fixedFrameMicros, 1000000.0 / fixedFrameMicros);
+	}
+
+	if (ARebellionCharacter* rebellionCharacter = Cast<ARebellionCharacter>(pawn))
+	{
+		playbackInput = FScriptedInput::Bind(rebellionCharacter);
+	}
+	else if (ARangedCharacter* rangedCharacter = Cast<ARangedCharacter>(pawn))
+	{
+		playbackInput = FScriptedInput::Bind(rangedCharacter);
+	}
+	else
+	{
+		UE_LOG(LogRebellion, Error, TEXT("Combat replay can't drive a %s"), *pawn->GetClass()->GetName());
+		return false;
+	}
+
+	seed = (int32)FCombatReplayVarint::UnZigZag(zigZagSeed);
+	ResetRandomSeed(seed);
+	playbackPawn = pawn;
+	frame = 0;
+	mode = EMode::PLAYING;
+
+	//Deltas are read an event ahead, a frame without events costs one compare
+	uint64 firstDelta = 0;
+	bHasNextEvent = FCombatReplayVarint::Read(replay, readOffset, firstDelta);
+	nextEventFrame = (uint32)firstDelta;
+
+	UE_LOG(LogRebellion, Display, TEXT("Playing combat replay %s, seed %d"), *replayPath, seed);
+	return true;
+}
+
+void UCombatReplaySubsystem::PlayFrame()
+{
+	while (mode == EMode::PLAYING && bHasNextEvent && nextEventFrame <= frame)
+	{
+		if (readOffset >= replay.Num())
+		{
+			FinishPlayback(TEXT("log truncated"));
+			return;
+		}
+
+		const ECombatReplayEvent type = (ECombatReplayEvent)replay[readOffset++];
+		uint64 nameIndex = 0;
+		bool bValid = true;
+		switch (type)
+		{
+		case ECombatReplayEvent::NAME:
+		{
+			FString name;
+			bValid = FCombatReplayVarint::Read(replay, readOffset, nameIndex) && nameIndex == (uint64)names.Num() && ReadString(name);
+			if (bValid)
+			{
+				names.Add(FName(*name));
+			}
+			break;
+		}
+
+		case ECombatReplayEvent::ACTION_PRESSED:
+		case ECombatReplayEvent::ACTION_RELEASED:
+			bValid = FCombatReplayVarint::Read(replay, readOffset, nameIndex) && nameIndex < (uint64)names.Num();
+			if (bValid)
+			{
+				FScriptedInput::Action(playbackInput, names[(int32)nameIndex], type == ECombatReplayEvent::ACTION_PRESSED ? IE_Pressed : IE_Released);
+			}
+			break;
+
+		case ECombatReplayEvent::AXIS:
+		{
+			uint64 value = 0;
+			bValid = FCombatReplayVarint::Read(replay, readOffset, nameIndex) && nameIndex < (uint64)names.Num() && FCombatReplayVarint::Read(replay, readOffset, value);
+			if (bValid)
+			{
+				heldAxisValues.Add(names[(int32)nameIndex], FCombatReplayVarint::UnZigZag(value) / axisSteps);
+			}
+			break;
+		}
+
+		case ECombatReplayEvent::CONTROL_ROTATION:
+		{
+			uint64 pitch = 0;
+			uint64 yaw = 0;
+			bValid = FCombatReplayVarint::Read(replay, readOffset, pitch) && FCombatReplayVarint::Read(replay, readOffset, yaw);
+			AController* controller = playbackPawn.IsValid() ? playbackPawn->GetController() : nullptr;
+			if (bValid && controller)
+			{
+				controller->SetControlRotation(FRotator(FRotator::DecompressAxisFromShort((uint16)pitch), FRotator::DecompressAxisFromShort((uint16)yaw), 0.f));
+			}
+			break;
+		}
+
+		case ECombatReplayEvent::END:
+			FinishPlayback(TEXT("end of log"));
+			return;
+
+		default:
+			bValid = false;
+			break;
+		}
+
+		if (!bValid)
+		{
+			UE_LOG(LogRebellion, Error, TEXT("Combat replay %s is corrupt at byte %d"), *replayPath, readOffset);
+			FinishPlayback(TEXT("corrupt log"));
+			return;
+		}
+		playedEvents++;
+
+		uint64 delta = 0;
+		bHasNextEvent = FCombatReplayVarint::Read(replay, readOffset, delta);
+		nextEventFrame += (uint32)delta;
+	}
+
+	if (mode != EMode::PLAYING)
+	{
+		return;
+	}
+	if (!bHasNextEvent)
+	{
+		FinishPlayback(TEXT("log truncated"));
+		return;
+	}
+
+	//Axis handlers run every frame with real input too, the last logged value holds until the next change
+	for (const TPair<FName, float>& axis : heldAxisValues)
+	{
+		FScriptedInput::Axis(playbackInput, axis.Key, axis.Value);
+	}
+}
+
+bool UCombatReplaySubsystem::ReadString(FString& outValue)
+{
+	uint64 length = 0;
+	if (!FCombatReplayVarint::Read(replay, readOffset, length) || length > (uint64)(replay.Num() - readOffset))
+	{
+		return false;
+	}
+
+	const FUTF8ToTCHAR converted((const ANSICHAR*)replay.GetData() + readOffset, (int32)length);
+	outValue = FString(converted.Length(), converted.Get());
+	readOffset += (int32)length;
+	return true;
+}
+
+void UCombatReplaySubsystem::FinishPlayback(const TCHAR* reason)
+{
+	UE_LOG(LogRebellion, Display, TEXT("Combat replay %s finished after %u frames and %d events: %s"), *replayPath, frame, playedEvents, reason);
+	WritePlaybackReport();
+
+	mode = EMode::NONE;
+	replay.Empty();
+	playbackInput = nullptr;
+	playbackPawn.Reset();
+
+	if (bExitWhenPlaybackDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UCombatReplaySubsystem::WritePlaybackReport() const
+{
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	report->SetStringField(TEXT("replay"), FPaths::GetCleanFilename(replayPath));
+	report->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+	report->SetNumberField(TEXT("seed"), seed);
+	report->SetNumberField(TEXT("frames"), frame);
+	report->SetNumberField(TEXT("events"), playedEvents);
+	report->SetObjectField(TEXT("frameMs"), URebellionBenchmarkSubsystem::MakePercentiles(frameMs));
+	report->SetObjectField(TEXT("gameThreadMs"), URebellionBenchmarkSubsystem::MakePercentiles(gameThreadMs));
+	report->SetNumberField(TEXT("usedPhysicalMB"), FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0));
+
+	URebellionBenchmarkSubsystem::SaveReport(report, TEXT("Replay_") + FPaths::GetBaseFilename(replayPath), true);
+}
+
+namespace RebellionReplayCommands
+{
+	static UCombatReplaySubsystem* GetReplaySubsystem(UWorld* world)
+	{
+		return world ? world->GetSubsystem<UCombatReplaySubsystem>() : nullptr;
+	}
+
+	static void Record(const TArray<FString>& args, UWorld* world)
+	{
+		if (UCombatReplaySubsystem* replay = GetReplaySubsystem(world))
+		{
+			if (args.Contains(TEXT("stop")))
+			{
+				replay->StopRecording();
+				return;
+			}
+			replay->StartRecording(args.Num() > 0 ? args[0] : FString());
+		}
+	}
+
+	static void Play(const TArray<FString>& args, UWorld* world)
+	{
+		if (UCombatReplaySubsystem* replay = GetReplaySubsystem(world))
+		{
+			if (args.Contains(TEXT("stop")))
+			{
+				replay->StopPlayback();
+				return;
+			}
+			if (args.Num() == 0)
+			{
+				UE_LOG(LogRebellion, Warning, TEXT("Rebellion.Replay.Play needs a replay path"));
+				return;
+			}
+			replay->StartPlayback(args[0], args.Contains(TEXT("exit")));
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs recordCommand(
+		TEXT("Rebellion.Replay.Record"),
+		TEXT("Records the local player's input from the next frame it has a pawn. Args: [path] [stop], the default path is in Saved/Replays"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&Record));
+
+	static FAutoConsoleCommandWithWorldAndArgs playCommand(
+		TEXT("Rebellion.Replay.Play"),
+		TEXT("Plays a recorded replay into the local player's pawn and writes frame time percentiles to Saved/Profiling/Rebellion. Args: path [exit] [stop]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&Play));
+}
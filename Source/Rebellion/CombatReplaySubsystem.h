@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Containers/Queue.h"
+#include "CombatReplaySubsystem.generated.h"
+
+class APawn;
+class UInputComponent;
+class FRunnableThread;
+class FEvent;
+
+/** LEB128 varints and zigzag signed values, the replay log's only number encoding */
+struct FCombatReplayVarint
+{
+	static void Write(TArray<uint8>& buffer, uint64 value);
+	/** False if the buffer ends inside the varint or it is longer than 64 bits */
+	static bool Read(const TArray<uint8>& buffer, int32& offset, uint64& outValue);
+
+	static uint64 ZigZag(int64 value) { return ((uint64)value << 1) ^ (uint64)(value >> 63); }
+	static int64 UnZigZag(uint64 value) { return (int64)(value >> 1) ^ -(int64)(value & 1); }
+};
+
+/** Event kinds in the replay log. Every event is a varint frame delta, this byte and its payload */
+enum class ECombatReplayEvent : uint8
+{
+	//Varint index and a string, before the first event that uses the name
+	NAME,
+	//Varint name index
+	ACTION_PRESSED,
+	ACTION_RELEASED,
+	//Varint name index and zigzag varint value in 127ths, only when the value changes
+	AXIS,
+	//Pitch and yaw as varint compressed shorts, only when they change
+	CONTROL_ROTATION,
+	END
+};
+
+/** Appends chunks of the replay log to a file on its own thread, so the game thread never waits on disk */
+class FCombatReplayWriter : public FRunnable
+{
+public:
+
+	/** Null if the file can't be opened */
+	static TUniquePtr<FCombatReplayWriter> Create(const FString& path);
+	/** Writes everything still queued and closes the file */
+	virtual ~FCombatReplayWriter();
+
+	/** Game thread only */
+	void Enqueue(TArray<uint8>&& chunk);
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+
+	FCombatReplayWriter(FArchive* inFile);
+	void WriteQueued();
+
+	TUniquePtr<FArchive> file;
+	TQueue<TArray<uint8>, EQueueMode::Spsc> chunks;
+	FEvent* wakeEvent = nullptr;
+	FRunnableThread* thread = nullptr;
+	FThreadSafeBool bStopping;
+};
+
+/**
+ * Records the local player's input to a compact binary log and plays it back through the same handlers.
+ * Pawns pass their bindings to WrapPlayerInput at the end of SetupPlayerInputComponent; while recording,
+ * every action press and release, each change of the movement axes and of the control rotation is logged
+ * against a frame index counted from the first frame the player had a pawn. The header carries the seed
+ * FMath's random stream was reset to. Playback reseeds, binds the pawn through FScriptedInput and feeds
+ * each event at its frame, then writes frame time percentiles, so a session becomes a regression case:
+ *
+ *	UE4Editor Rebellion <map> -game -nullrhi -nosound -unattended -benchmark -fps=60
+ *		-RebellionReplay=path.rbreplay [-ReplayExit]
+ *
+ * Record with -RebellionRecord[=path] or Rebellion.Replay.Record, play with Rebellion.Replay.Play.
+ * Recording at the same fixed frame rate as playback is what makes the frames line up.
+ */
+UCLASS()
+class REBELLION_API UCombatReplaySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Records from the next frame the local player has a pawn, an empty path picks one in Saved/Replays */
+	void StartRecording(const FString& path);
+	void StopRecording();
+	/** Plays path into the local player's pawn from the next frame it has one */
+	void StartPlayback(const FString& path, bool bExitWhenDone);
+	void StopPlayback();
+
+	bool IsRecording() const { return mode == EMode::RECORD_PENDING || mode == EMode::RECORDING; }
+	bool IsPlaying() const { return mode == EMode::PLAY_PENDING || mode == EMode::PLAYING; }
+
+	/** Routes the local player's action and movement bindings through the recorder, other pawns are left alone */
+	void WrapPlayerInput(APawn* pawn, UInputComponent* inputComponent);
+
+private:
+
+	enum class EMode : uint8
+	{
+		NONE,
+		RECORD_PENDING,
+		RECORDING,
+		PLAY_PENDING,
+		PLAYING
+	};
+
+	void OnWorldTickStart(UWorld* world, ELevelTick tickType, float deltaSeconds);
+	APawn* GetPlayerPawn() const;
+	void ResetRandomSeed(int32 seed) const;
+
+	void BeginRecording();
+	void RecordAction(FName actionName, EInputEvent keyEvent);
+	//Returns the quantized value the handler gets, so playback feeds exactly what was recorded
+	float RecordAxis(FName axisName, float value);
+	void RecordControlRotation(APawn* pawn);
+	uint32 GetNameIndex(FName name);
+	void BeginEvent(ECombatReplayEvent type);
+	void WriteString(const FString& value);
+	void FlushRecording(bool bForce);
+
+	bool BeginPlayback(APawn* pawn);
+	//Feeds every event of the current frame, then the held axis values
+	void PlayFrame();
+	bool ReadString(FString& outValue);
+	void FinishPlayback(const TCHAR* reason);
+	void WritePlaybackReport() const;
+
+	EMode mode = EMode::NONE;
+	FString replayPath;
+	uint32 frame = 0;
+	int32 seed = 0;
+	FDelegateHandle worldTickStartHandle;
+
+	//Recording
+	TArray<uint8> buffer;
+	TUniquePtr<FCombatReplayWriter> writer;
+	TMap<FName, uint32> nameIndices;
+	TMap<FName, int32> recordedAxisValues;
+	uint16 recordedPitch = 0;
+	uint16 recordedYaw = 0;
+	bool bHasRecordedRotation = false;
+	uint32 lastEventFrame = 0;
+	uint32 lastFlushFrame = 0;
+	int64 recordedBytes = 0;
+	int32 recordedEvents = 0;
+
+	//Playback
+	TArray<uint8> replay;
+	int32 readOffset = 0;
+	uint32 nextEventFrame = 0;
+	bool bHasNextEvent = false;
+	TArray<FName> names;
+	TMap<FName, float> heldAxisValues;
+	TWeakObjectPtr<APawn> playbackPawn;
+	bool bExitWhenPlaybackDone = false;
+	int32 playedEvents = 0;
+	TArray<float> frameMs;
+	TArray<float> gameThreadMs;
+
+	UPROPERTY(Transient)
+		UInputComponent* playbackInput;
+};
@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatSpatialHash.h"
+
+FCombatSpatialHash::FCombatSpatialHash(float inCellSize)
+	: cellSize(FMath::Max(inCellSize, 1.f))
+	, invCellSize(1.f / FMath::Max(inCellSize, 1.f))
+	, maxTargetRadius(0.f)
+{
+}
+
+FIntPoint FCombatSpatialHash::CellOf(const FVector& position) const
+{
+	return FIntPoint(FMath::FloorToInt(position.X * invCellSize), FMath::FloorToInt(position.Y * invCellSize));
+}
+
+int32 FCombatSpatialHash::Add(AActor* actor, const FVector& position, float radius, int32 subIndex)
+{
+	int32 targetId;
+	if (freeIds.Num() > 0)
+	{
+		targetId = freeIds.Pop(false);
+	}
+	else
+	{
+		targetId = targets.AddDefaulted();
+	}
+
+	FCombatTarget& target = targets[targetId];
+	target.actor = actor;
+	target.subIndex = subIndex;
+	target.position = position;
+	target.radius = radius;
+	maxTargetRadius = FMath::Max(maxTargetRadius, radius);
+	target.cell = CellOf(position);
+	AddToCell(targetId);
+
+	return targetId;
+}
+
+void FCombatSpatialHash::Remove(int32 targetId)
+{
+	//A destroyed actor's target is still in its cell, only a removed one is explicitly null
+	if (!targets.IsValidIndex(targetId) || targets[targetId].actor.IsExplicitlyNull())
+	{
+		return;
+	}
+
+	RemoveFromCell(targetId);
+	targets[targetId] = FCombatTarget();
+	freeIds.Add(targetId);
+}
+
+void FCombatSpatialHash::Update(int32 targetId, const FVector& position)
+{
+	FCombatTarget& target = targets[targetId];
+	target.position = position;
+
+	const FIntPoint newCell = CellOf(position);
+	if (newCell != target.cell)
+	{
+		RemoveFromCell(targetId);
+		target.cell = newCell;
+		AddToCell(targetId);
+	}
+}
+
+void FCombatSpatialHash::Empty()
+{
+	targets.Reset();
+	freeIds.Reset();
+	cells.Reset();
+	maxTargetRadius = 0.f;
+}
+
+void FCombatSpatialHash::AddToCell(int32 targetId)
+{
+	FCombatTarget& target = targets[targetId];
+	TArray<int32>& cellIds = cells.FindOrAdd(target.cell);
+	target.slotInCell = cellIds.Add(targetId);
+}
+
+void FCombatSpatialHash::RemoveFromCell(int32 targetId)
+{
+	FCombatTarget& target = targets[targetId];
+	TArray<int32>* cellIds = cells.Find(target.cell);
+	if (!cellIds)
+	{
+		return;
+	}
+
+	cellIds->RemoveAtSwap(target.slotInCell, 1, false);
+	//Whoever got swapped into the hole needs its slot fixed
+	if (cellIds->IsValidIndex(target.slotInCell))
+	{
+		targets[(*cellIds)[target.slotInCell]].slotInCell = target.slotInCell;
+	}
+	target.slotInCell = INDEX_NONE;
+	//Empty cells are kept, crowds keep walking back into them
+}
+
+template<typename TVisitor>
+void FCombatSpatialHash::ForEachInBox(const FVector& boxMin, const FVector& boxMax, TVisitor&& visitor) const
+{
+	const FIntPoint minCell = CellOf(boxMin);
+	const FIntPoint maxCell = CellOf(boxMax);
+	for (int32 cellX = minCell.X; cellX <= maxCell.X; cellX++)
+	{
+		for (int32 cellY = minCell.Y; cellY <= maxCell.Y; cellY++)
+		{
+			if (const TArray<int32>* cellIds = cells.Find(FIntPoint(cellX, cellY)))
+			{
+				for (int32 targetId : *cellIds)
+				{
+					visitor(targetId, targets[targetId]);
+				}
+			}
+		}
+	}
+}
+
+void FCombatSpatialHash::QueryRadius(const FVector& center, float radius, TArray<int32>& outIds) const
+{
+	//Targets are bucketed by center, so widen by the largest bounding sphere to catch ones poking in from next door
+	const FVector reach(radius + maxTargetRadius);
+	ForEachInBox(center - reach, center + reach, [&](int32 targetId, const FCombatTarget& target)
+	{
+		if (FVector::DistSquared(center, target.position) <= FMath::Square(radius + target.radius))
+		{
+			outIds.Add(targetId);
+		}
+	});
+}
+
+void FCombatSpatialHash::QueryCone(const FVector& origin, const FVector& direction, float range, float cosHalfAngle, TArray<int32>& outIds) const
+{
+	const FVector reach(range + maxTargetRadius);
+	ForEachInBox(origin - reach, origin + reach, [&](int32 targetId, const FCombatTarget& target)
+	{
+		const FVector toTarget = target.position - origin;
+		const float distanceSquared = toTarget.SizeSquared();
+		if (distanceSquared > FMath::Square(range + target.radius))
+		{
+			return;
+		}
+
+		//Anything overlapping the apex is always inside
+		if (distanceSquared <= FMath::Square(target.radius) || FVector::DotProduct(toTarget, direction) >= cosHalfAngle * FMath::Sqrt(distanceSquared))
+		{
+			outIds.Add(targetId);
+		}
+	});
+}
+
+void FCombatSpatialHash::QuerySegment(const FVector& start, const FVector& end, float radius, TArray<int32>& outIds) const
+{
+	const FVector reach(radius + maxTargetRadius);
+	ForEachInBox(start.ComponentMin(end) - reach, start.ComponentMax(end) + reach, [&](int32 targetId, const FCombatTarget& target)
+	{
+		if (FMath::PointDistToSegmentSquared(target.position, start, end) <= FMath::Square(radius + target.radius))
+		{
+			outIds.Add(targetId);
+		}
+	});
+}
+
+void FCombatSpatialHash::QueryBatch(const TArray<FCombatSpatialQuery>& queries, TArray<int32>& outIds, TArray<int32>& outOffsets) const
+{
+	outOffsets.Reset(queries.Num() + 1);
+	outOffsets.Add(outIds.Num());
+
+	for (const FCombatSpatialQuery& query : queries)
+	{
+		switch (query.type)
+		{
+		case ECombatSpatialQueryType::RADIUS:
+			QueryRadius(query.origin, query.radius, outIds);
+			break;
+		case ECombatSpatialQueryType::CONE:
+			QueryCone(query.origin, query.direction, query.radius, query.cosHalfAngle, outIds);
+			break;
+		case ECombatSpatialQueryType::SEGMENT:
+			QuerySegment(query.origin, query.direction, query.radius, outIds);
+			break;
+		}
+		outOffsets.Add(outIds.Num());
+	}
+}
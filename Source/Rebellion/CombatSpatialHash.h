@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+
+class AActor;
+
+/** One thing attacks can target: a pawn or prop, or one enemy of a crowd manager when subIndex is set */
+struct FCombatTarget
+{
+	//Null once the actor is destroyed, until its owner removes the target
+	TWeakObjectPtr<AActor> actor;
+	int32 subIndex = INDEX_NONE;
+	FVector position = FVector::ZeroVector;
+	//Bounding sphere, queries are conservative by this much
+	float radius = 0.f;
+	FIntPoint cell = FIntPoint::ZeroValue;
+	//Position inside the cell's id list so removal is a swap
+	int32 slotInCell = INDEX_NONE;
+};
+
+enum class ECombatSpatialQueryType : uint8
+{
+	RADIUS,
+	CONE,
+	SEGMENT
+};
+
+/** One query of a batch, see FCombatSpatialHash::QueryBatch */
+struct FCombatSpatialQuery
+{
+	ECombatSpatialQueryType type = ECombatSpatialQueryType::RADIUS;
+	//Center for RADIUS, origin for CONE, start for SEGMENT
+	FVector origin = FVector::ZeroVector;
+	//Unit direction for CONE, end for SEGMENT
+	FVector direction = FVector::ForwardVector;
+	float radius = 0.f;
+	//CONE only
+	float cosHalfAngle = 1.f;
+};
+
+/**
+ * Uniform 2D grid over the combat targets. Targets are bucketed by their XY cell and only change
+ * buckets when they cross a cell edge, so per frame position updates are cheap. Queries return
+ * target ids whose bounding sphere touches the query shape; callers do any exact test themselves.
+ */
+class REBELLION_API FCombatSpatialHash
+{
+public:
+	explicit FCombatSpatialHash(float inCellSize = 400.f);
+
+	int32 Add(AActor* actor, const FVector& position, float radius, int32 subIndex = INDEX_NONE);
+	void Remove(int32 targetId);
+	void Update(int32 targetId, const FVector& position);
+	void Empty();
+
+	const FCombatTarget& GetTarget(int32 targetId) const { return targets[targetId]; }
+	int32 Num() const { return targets.Num() - freeIds.Num(); }
+
+	void QueryRadius(const FVector& center, float radius, TArray<int32>& outIds) const;
+	void QueryCone(const FVector& origin, const FVector& direction, float range, float cosHalfAngle, TArray<int32>& outIds) const;
+	void QuerySegment(const FVector& start, const FVector& end, float radius, TArray<int32>& outIds) const;
+
+	/** Runs every query, results for query i are outIds[outOffsets[i]] up to outIds[outOffsets[i + 1]] */
+	void QueryBatch(const TArray<FCombatSpatialQuery>& queries, TArray<int32>& outIds, TArray<int32>& outOffsets) const;
+
+private:
+
+	FIntPoint CellOf(const FVector& position) const;
+	void AddToCell(int32 targetId);
+	void RemoveFromCell(int32 targetId);
+
+	/** Calls visitor with every target id in the cells overlapping the XY box */
+	template<typename TVisitor>
+	void ForEachInBox(const FVector& boxMin, const FVector& boxMax, TVisitor&& visitor) const;
+
+	float cellSize;
+	float invCellSize;
+	//Never shrinks, only widens the cell range queries visit
+	float maxTargetRadius;
+
+	TArray<FCombatTarget> targets;
+	TArray<int32> freeIds;
+	TMap<FIntPoint, TArray<int32>> cells;
+};
@@ -0,0 +1,788 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatSubsystem.h"
+#include "EnemyCrowdManager.h"
+#include "ProjectileManager.h"
+#include "Rebellion.h"
+#include "RebellionCharacter.h"
+#include "RangedCharacter.h"
+#include "RebellionBenchmarkSubsystem.h"
+#include "RebellionLog.h"
+#include "RebellionSignificanceSubsystem.h"
+#include "RebellionStats.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/Level.h"
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/Crc.h"
+#include "Dom/JsonObject.h"
+
+static TAutoConsoleVariable<int32> CVarCullWeaponSweeps(
+	TEXT("Rebellion.Combat.CullSweeps"),
+	1,
+	TEXT("Skip physics weapon sweeps that have no pawn or damageable prop near their path in the target hash. 0 sweeps everything."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarHitResolveTasks(
+	TEXT("Rebellion.Combat.HitResolveTasks"),
+	0,
+	TEXT("Tasks the damage pass computes hits on. 0 uses every task graph worker plus the game thread, 1 computes inline."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarHitChunkSize(
+	TEXT("Rebellion.Combat.HitChunkSize"),
+	64,
+	TEXT("Contiguous hit records a compute task takes at a time."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarParallelHitThreshold(
+	TEXT("Rebellion.Combat.ParallelHitThreshold"),
+	16384,
+	TEXT("Frames with fewer hits compute them inline. A hit is a few nanoseconds of math, below this the whole stage costs less than waking task graph workers. Set from Rebellion.Bench.HitResolve's break even on the target hardware."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRangedFalloffStart(
+	TEXT("Rebellion.Combat.RangedFalloffStart"),
+	1500.f,
+	TEXT("Distance in cm from the attacker where ranged damage starts to drop off."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRangedFalloffEnd(
+	TEXT("Rebellion.Combat.RangedFalloffEnd"),
+	4000.f,
+	TEXT("Distance in cm from the attacker where ranged damage reaches Rebellion.Combat.RangedFalloffMinScale."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarRangedFalloffMinScale(
+	TEXT("Rebellion.Combat.RangedFalloffMinScale"),
+	1.f,
+	TEXT("Fraction of ranged damage left at Rebellion.Combat.RangedFalloffEnd and beyond. 1 turns falloff off."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarBlockAngle(
+	TEXT("Rebellion.Combat.BlockAngle"),
+	60.f,
+	TEXT("Half angle in degrees in front of a blocking character that its block covers."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarBlockDamageScale(
+	TEXT("Rebellion.Combat.BlockDamageScale"),
+	1.f,
+	TEXT("Fraction of damage a blocked hit still does. 1 leaves blocked hits at full damage, they still don't knock back."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarKnockbackDamage(
+	TEXT("Rebellion.Combat.KnockbackDamage"),
+	0.f,
+	TEXT("Hits doing at least this much damage knock their target back, lighter ones only flinch it. 0 knocks back on every hit, as before reactions existed."),
+	ECVF_Default);
+
+FCombatHitRules FCombatHitRules::FromConsoleVariables()
+{
+	FCombatHitRules rules;
+	rules.rangedFalloffStart = CVarRangedFalloffStart.GetValueOnGameThread();
+	rules.rangedFalloffEnd = CVarRangedFalloffEnd.GetValueOnGameThread();
+	rules.rangedFalloffMinScale = CVarRangedFalloffMinScale.GetValueOnGameThread();
+	rules.blockCosine = FMath::Cos(FMath::DegreesToRadians(CVarBlockAngle.GetValueOnGameThread()));
+	rules.blockDamageScale = CVarBlockDamageScale.GetValueOnGameThread();
+	rules.knockbackDamage = CVarKnockbackDamage.GetValueOnGameThread();
+	return rules;
+}
+
+void FCombatDamageTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (combat)
+	{
+		combat->ResolveQueuedHits();
+	}
+}
+
+const FName UCombatSubsystem::hittableTag(TEXT("CombatHittable"));
+
+void UCombatSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (UWorld* world = GetWorld())
+	{
+		actorSpawnedHandle = world->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UCombatSubsystem::OnActorSpawned));
+	}
+	levelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UCombatSubsystem::OnLevelAddedToWorld);
+}
+
+void UCombatSubsystem::Deinitialize()
+{
+	if (damageTick.IsTickFunctionRegistered())
+	{
+		damageTick.UnRegisterTickFunction();
+	}
+	if (UWorld* world = GetWorld())
+	{
+		world->RemoveOnActorSpawnedHandler(actorSpawnedHandle);
+	}
+	FWorldDelegates::LevelAddedToWorld.Remove(levelAddedHandle);
+	queuedHits.Empty();
+	hitResults.Empty();
+	OnKill.Clear();
+	ResetInputLatency();
+	attackWindows.Empty();
+	pendingSweeps.Empty();
+	inFlightSweeps.Empty();
+	trackedPawns.Empty();
+	trackedHittables.Empty();
+	bHittablesTracked = false;
+	targetHash.Empty();
+	sortKeys.Empty();
+	projectileManager = nullptr;
+
+	Super::Deinitialize();
+}
+
+AProjectileManager* UCombatSubsystem::GetProjectileManager()
+{
+	if (!IsValid(projectileManager))
+	{
+		FActorSpawnParameters spawnParams;
+		spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		spawnParams.ObjectFlags |= RF_Transient;
+		projectileManager = GetWorld()->SpawnActor<AProjectileManager>(spawnParams);
+	}
+	return projectileManager;
+}
+
+TStatId UCombatSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatSubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType UCombatSubsystem::GetTickableTickType() const
+{
+	//The class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+void UCombatSubsystem::Tick(float DeltaTime)
+{
+	REBELLION_SCOPE(CombatTick);
+
+	if (!damageTick.IsTickFunctionRegistered())
+	{
+		RegisterDamageTick();
+	}
+
+	currentFrameStats = FCombatTraceFrameStats();
+
+	//Last frame's traces have finished by the time tickable objects run
+	DispatchCompletedSweeps();
+	SweepAttackWindows();
+	if (!bHittablesTracked)
+	{
+		bHittablesTracked = true;
+		for (const ULevel* level : GetWorld()->GetLevels())
+		{
+			TrackHittables(level);
+		}
+	}
+	UpdatePawnTargets();
+	UpdateHittableTargets();
+	CullPendingSweeps();
+	IssuePendingSweeps();
+
+	lastFrameStats = currentFrameStats;
+}
+
+void UCombatSubsystem::RecordInputLatency(ECombatInputLatency kind, float milliseconds)
+{
+	TArray<float>& samples = inputLatencySamples[(int32)kind];
+	if (samples.Num() < maxInputLatencySamples)
+	{
+		samples.Add(milliseconds);
+	}
+	else
+	{
+		int32& next = nextInputLatencySample[(int32)kind];
+		samples[next] = milliseconds;
+		next = (next + 1) % maxInputLatencySamples;
+	}
+
+	if (kind == ECombatInputLatency::INPUT_TO_MONTAGE)
+	{
+		CSV_CUSTOM_STAT(Rebellion, InputToMontageMs, milliseconds, ECsvCustomStatOp::Max);
+	}
+	else
+	{
+		CSV_CUSTOM_STAT(Rebellion, InputToFirstHitMs, milliseconds, ECsvCustomStatOp::Max);
+	}
+}
+
+void UCombatSubsystem::ResetInputLatency()
+{
+	for (int32 kind = 0; kind < (int32)ECombatInputLatency::COUNT; kind++)
+	{
+		inputLatencySamples[kind].Reset();
+		nextInputLatencySample[kind] = 0;
+	}
+}
+
+void UCombatSubsystem::AddAttackWindow(ARebellionCharacter* attacker)
+{
+	attackWindows.AddUnique(attacker);
+}
+
+void UCombatSubsystem::RemoveAttackWindow(ARebellionCharacter* attacker)
+{
+	attackWindows.RemoveSingleSwap(attacker);
+}
+
+void UCombatSubsystem::SweepAttackWindows()
+{
+	//Poses are final for this frame, which is where the notify used to sample from
+	for (int32 index = attackWindows.Num() - 1; index >= 0; index--)
+	{
+		ARebellionCharacter* attacker = attackWindows[index].Get();
+		if (!attacker)
+		{
+			attackWindows.RemoveAtSwap(index);
+			continue;
+		}
+		attacker->SweepWeapon();
+	}
+}
+
+void UCombatSubsystem::QueueWeaponSweep(ARebellionCharacter* attacker, const FVector& start, const FVector& end, const FQuat& rotation, const FVector& halfExtent)
+{
+	FWeaponSweepRequest& request = pendingSweeps.AddDefaulted_GetRef();
+	request.attacker = attacker;
+	request.attackSerial = attacker ? attacker->GetAttackSerial() : 0;
+	request.start = start;
+	request.end = end;
+	request.rotation = rotation;
+	request.halfExtent = halfExtent;
+}
+
+void UCombatSubsystem::RegisterDamageTick()
+{
+	UWorld* world = GetWorld();
+	if (!world || !world->PersistentLevel)
+	{
+		return;
+	}
+
+	//After physics so this frame's movement, root motion and knockback are settled
+	damageTick.combat = this;
+	damageTick.TickGroup = TG_PostPhysics;
+	damageTick.EndTickGroup = TG_PostPhysics;
+	damageTick.bCanEverTick = true;
+	damageTick.bStartWithTickEnabled = true;
+	damageTick.bTickEvenWhenPaused = false;
+	damageTick.RegisterTickFunction(world->PersistentLevel);
+}
+
+void UCombatSubsystem::QueueHit(AActor* attacker, AActor* target, int32 targetSubIndex, EAttackType attackType, float damage, const FVector& hitLocation, const FVector& hitDirection)
+{
+	FCombatHitRecord& record = queuedHits.AddDefaulted_GetRef();
+	record.attacker = attacker;
+	record.target = target;
+	record.targetSubIndex = targetSubIndex;
+	record.attackType = attackType;
+	record.damage = damage;
+	record.hitLocation = hitLocation;
+	record.hitDirection = hitDirection;
+	record.timestamp = GetWorld()->GetTimeSeconds();
+	record.sequence = nextHitSequence++;
+	record.attackerKey = GetSortKey(attacker);
+	record.targetKey = GetSortKey(target);
+
+	const ARebellionCharacter* targetCharacter = targetSubIndex == INDEX_NONE ? Cast<ARebellionCharacter>(target) : nullptr;
+	record.attackerLocation = IsValid(attacker) ? attacker->GetActorLocation() : hitLocation;
+	record.targetForward = targetSubIndex == INDEX_NONE && IsValid(target) ? target->GetActorForwardVector().GetSafeNormal2D() : FVector::ZeroVector;
+	record.bTargetBlocking = targetCharacter && targetCharacter->IsBlocking();
+}
+
+//Only our own characters track health, anything else just receives TakeDamage
+static bool IsKilled(const AActor* target)
+{
+	if (const ARebellionCharacter* melee = Cast<ARebellionCharacter>(target))
+	{
+		return melee->IsDead();
+	}
+	if (const ARangedCharacter* ranged = Cast<ARangedCharacter>(target))
+	{
+		return ranged->IsDead();
+	}
+	return false;
+}
+
+void UCombatSubsystem::ResolveQueuedHits()
+{
+	REBELLION_SCOPE(DamageResolve);
+
+	FCombatDamageFrameStats stats;
+	if (queuedHits.Num() == 0)
+	{
+		lastDamageStats = stats;
+		return;
+	}
+
+	uint64 startCycles = FPlatformTime::Cycles64();
+	//Detection order depends on physics and async trace completion, this order only on the hits themselves
+	queuedHits.Sort([](const FCombatHitRecord& a, const FCombatHitRecord& b)
+	{
+		if (a.timestamp != b.timestamp)
+		{
+			return a.timestamp < b.timestamp;
+		}
+		if (a.attackerKey != b.attackerKey)
+		{
+			return a.attackerKey < b.attackerKey;
+		}
+		if (a.targetKey != b.targetKey)
+		{
+			return a.targetKey < b.targetKey;
+		}
+		if (a.targetSubIndex != b.targetSubIndex)
+		{
+			return a.targetSubIndex < b.targetSubIndex;
+		}
+		return a.sequence < b.sequence;
+	});
+	stats.sortCycles = FPlatformTime::Cycles64() - startCycles;
+
+	startCycles = FPlatformTime::Cycles64();
+	stats.computeTasks = queuedHits.Num() >= CVarParallelHitThreshold.GetValueOnGameThread() ? GetHitResolveTaskCount() : 1;
+	ComputeHitResults(queuedHits, hitResults, FCombatHitRules::FromConsoleVariables(), stats.computeTasks, CVarHitChunkSize.GetValueOnGameThread());
+	stats.computeCycles = FPlatformTime::Cycles64() - startCycles;
+
+	URebellionSignificanceSubsystem* significance = GetWorld()->GetSubsystem<URebellionSignificanceSubsystem>();
+
+	//Everything that touches an actor, in sorted order
+	startCycles = FPlatformTime::Cycles64();
+	const int32 hitCount = queuedHits.Num();
+	for (int32 index = 0; index < hitCount; index++)
+	{
+		const FCombatHitRecord& record = queuedHits[index];
+		const FCombatHitResult& result = hitResults[index];
+
+		//Queued last frame, either side may have been destroyed or collected since the hit
+		AActor* target = record.target.Get();
+		if (!IsValid(target))
+		{
+			continue;
+		}
+		AActor* attacker = record.attacker.Get();
+		stats.hitsResolved++;
+		stats.blocked += result.reaction == ECombatHitReaction::BLOCKED ? 1 : 0;
+
+		//Both sides of a fight stay at full update rate for a while
+		if (significance)
+		{
+			significance->NotifyCombat(attacker);
+			significance->NotifyCombat(target);
+		}
+
+		bool bKilled = false;
+		if (AEnemyCrowdManager* crowd = Cast<AEnemyCrowdManager>(target))
+		{
+			bKilled = crowd->ApplyMeleeHit(record.targetSubIndex, result.damage, result.knockback);
+		}
+		else
+		{
+			//Point damage hands the reaction's direction to the target's ReceivePointDamage
+			FHitResult hitInfo;
+			hitInfo.Location = record.hitLocation;
+			hitInfo.ImpactPoint = record.hitLocation;
+			const FPointDamageEvent damageEvent(result.damage, hitInfo, result.knockback, nullptr);
+			APawn* attackerPawn = Cast<APawn>(IsValid(attacker) ? attacker : nullptr);
+			const float applied = target->TakeDamage(result.damage, damageEvent, attackerPawn ? attackerPawn->GetController() : nullptr, attackerPawn);
+			bKilled = applied > 0.f && IsKilled(target);
+		}
+
+		if (bKilled)
+		{
+			stats.kills++;
+			REB_LOG(INFO, "%s killed %s %d", *GetNameSafe(attacker), *GetNameSafe(target), record.targetSubIndex);
+			OnKill.Broadcast(attacker, target, record.targetSubIndex);
+		}
+	}
+	queuedHits.Reset();
+	stats.resolveCycles = FPlatformTime::Cycles64() - startCycles;
+
+	INC_DWORD_STAT_BY(STAT_Rebellion_HitsResolved, stats.hitsResolved);
+	INC_DWORD_STAT_BY(STAT_Rebellion_HitsBlocked, stats.blocked);
+	lastDamageStats = stats;
+}
+
+int32 UCombatSubsystem::GetHitResolveTaskCount()
+{
+	const int32 taskCount = CVarHitResolveTasks.GetValueOnGameThread();
+	return taskCount > 0 ? taskCount : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+}
+
+void UCombatSubsystem::ComputeHitResults(const TArray<FCombatHitRecord>& records, TArray<FCombatHitResult>& results, const FCombatHitRules& rules, int32 taskCount, int32 chunkSize)
+{
+	REBELLION_SCOPE(HitCompute);
+
+	results.SetNumUninitialized(records.Num(), false);
+	chunkSize = FMath::Max(chunkSize, 1);
+	const int32 chunkCount = FMath::DivideAndRoundUp(records.Num(), chunkSize);
+	const int32 lanes = FMath::Clamp(taskCount, 1, FMath::Max(chunkCount, 1));
+
+	//Every lane claims the next chunk until none are left, each one reads and writes a contiguous run
+	FThreadSafeCounter nextChunk;
+	ParallelFor(lanes, [&records, &results, &rules, &nextChunk, chunkSize, chunkCount](int32 lane)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(Rebellion_HitComputeLane);
+		for (int32 chunk = nextChunk.Increment() - 1; chunk < chunkCount; chunk = nextChunk.Increment() - 1)
+		{
+			const int32 end = FMath::Min((chunk + 1) * chunkSize, records.Num());
+			for (int32 index = chunk * chunkSize; index < end; index++)
+			{
+				results[index] = ComputeHitResult(records[index], rules);
+			}
+		}
+	}, lanes == 1);
+}
+
+FCombatHitResult UCombatSubsystem::ComputeHitResult(const FCombatHitRecord& record, const FCombatHitRules& rules)
+{
+	FCombatHitResult result;
+	result.damage = record.damage;
+
+	//Linear drop off over the distance the shot covered
+	if (record.attackType == EAttackType::RANGED && rules.rangedFalloffEnd > rules.rangedFalloffStart)
+	{
+		const float distance = FVector::Dist(record.attackerLocation, record.hitLocation);
+		const float alpha = FMath::Clamp((distance - rules.rangedFalloffStart) / (rules.rangedFalloffEnd - rules.rangedFalloffStart), 0.f, 1.f);
+		result.damage *= FMath::Lerp(1.f, rules.rangedFalloffMinScale, alpha);
+	}
+
+	//The hit direction points away from the attacker, a block covers what comes at the target's front
+	const FVector direction = record.hitDirection.GetSafeNormal2D();
+	if (record.bTargetBlocking && FVector::DotProduct(-direction, record.targetForward) >= rules.blockCosine)
+	{
+		result.damage *= rules.blockDamageScale;
+		result.knockback = FVector::ZeroVector;
+		result.reaction = ECombatHitReaction::BLOCKED;
+		return result;
+	}
+
+	const bool bKnockback = result.damage >= rules.knockbackDamage;
+	result.knockback = bKnockback ? direction : FVector::ZeroVector;
+	result.reaction = bKnockback ? ECombatHitReaction::KNOCKBACK : ECombatHitReaction::FLINCH;
+	return result;
+}
+
+void UCombatSubsystem::RegisterPawn(APawn* pawn)
+{
+	//Capsule half height covers the whole body from its center
+	const UCapsuleComponent* capsule = Cast<UCapsuleComponent>(pawn->GetRootComponent());
+	const float radius = capsule ? capsule->GetScaledCapsuleHalfHeight() : pawn->GetSimpleCollisionRadius();
+
+	FTrackedPawn& tracked = trackedPawns.AddDefaulted_GetRef();
+	tracked.pawn = pawn;
+	tracked.targetId = targetHash.Add(pawn, pawn->GetActorLocation(), radius);
+	AssignSortKey(pawn);
+}
+
+void UCombatSubsystem::UnregisterPawn(APawn* pawn)
+{
+	const int32 index = trackedPawns.IndexOfByPredicate([pawn](const FTrackedPawn& tracked) { return tracked.pawn == pawn; });
+	if (index != INDEX_NONE)
+	{
+		targetHash.Remove(trackedPawns[index].targetId);
+		trackedPawns.RemoveAtSwap(index);
+	}
+	sortKeys.Remove(pawn);
+}
+
+int32 UCombatSubsystem::RegisterTarget(AActor* actor, const FVector& position, float radius, int32 subIndex)
+{
+	//Crowd managers register every enemy, they keep the key of the first
+	AssignSortKey(actor);
+	return targetHash.Add(actor, position, radius, subIndex);
+}
+
+void UCombatSubsystem::UnregisterTarget(int32 targetId)
+{
+	targetHash.Remove(targetId);
+}
+
+void UCombatSubsystem::AssignSortKey(const AActor* actor)
+{
+	if (actor && !sortKeys.Contains(actor))
+	{
+		sortKeys.Add(actor, nextSortKey++);
+	}
+}
+
+uint32 UCombatSubsystem::GetSortKey(const AActor* actor) const
+{
+	if (!actor)
+	{
+		return 0;
+	}
+	if (const uint32* key = sortKeys.Find(actor))
+	{
+		return *key;
+	}
+	return FCrc::StrCrc32(*actor->GetName()) | 0x80000000u;
+}
+
+void UCombatSubsystem::UpdatePawnTargets()
+{
+	for (int32 index = trackedPawns.Num() - 1; index >= 0; index--)
+	{
+		const APawn* pawn = trackedPawns[index].pawn.Get();
+		if (!pawn)
+		{
+			targetHash.Remove(trackedPawns[index].targetId);
+			trackedPawns.RemoveAtSwap(index);
+			continue;
+		}
+		targetHash.Update(trackedPawns[index].targetId, pawn->GetActorLocation());
+	}
+}
+
+//Damage only does something to these, and a weapon sweep can touch them
+static bool IsDamageableProp(AActor* actor)
+{
+	if (!actor || actor->IsA<APawn>() || actor->IsA<AEnemyCrowdManager>() || !actor->CanBeDamaged())
+	{
+		return false;
+	}
+
+	const UClass* actorClass = actor->GetClass();
+	const bool bReactsToDamage = actor->ActorHasTag(UCombatSubsystem::hittableTag)
+		|| actor->OnTakeAnyDamage.IsBound()
+		|| actor->OnTakePointDamage.IsBound()
+		|| actorClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AActor, ReceiveAnyDamage))
+		|| actorClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AActor, ReceivePointDamage));
+	if (!bReactsToDamage)
+	{
+		return false;
+	}
+
+	TInlineComponentArray<UPrimitiveComponent*> primitives(actor);
+	for (const UPrimitiveComponent* primitive : primitives)
+	{
+		if (primitive->IsQueryCollisionEnabled() && primitive->GetCollisionResponseToChannel(ECC_Weapon) != ECR_Ignore)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UCombatSubsystem::OnActorSpawned(AActor* actor)
+{
+	//Before the first tick the level search picks it up after BeginPlay
+	if (bHittablesTracked)
+	{
+		TrackHittable(actor);
+	}
+}
+
+void UCombatSubsystem::OnLevelAddedToWorld(ULevel* level, UWorld* world)
+{
+	if (bHittablesTracked && world == GetWorld())
+	{
+		TrackHittables(level);
+	}
+}
+
+void UCombatSubsystem::TrackHittables(const ULevel* level)
+{
+	if (!level)
+	{
+		return;
+	}
+	for (AActor* actor : level->Actors)
+	{
+		TrackHittable(actor);
+	}
+}
+
+void UCombatSubsystem::TrackHittable(AActor* actor)
+{
+	if (!IsDamageableProp(actor) || trackedHittables.Contains(actor))
+	{
+		return;
+	}
+
+	//Hash targets are spheres around the actor location, the bounds may be off center
+	FVector boundsOrigin;
+	FVector boundsExtent;
+	actor->GetActorBounds(true, boundsOrigin, boundsExtent);
+	const FVector location = actor->GetActorLocation();
+	const float radius = boundsExtent.Size() + FVector::Dist(boundsOrigin, location);
+
+	trackedHittables.Add(actor, targetHash.Add(actor, location, radius));
+	AssignSortKey(actor);
+}
+
+void UCombatSubsystem::UpdateHittableTargets()
+{
+	for (auto hittable = trackedHittables.CreateIterator(); hittable; ++hittable)
+	{
+		const AActor* actor = hittable.Key().ResolveObjectPtr();
+		if (!actor)
+		{
+			targetHash.Remove(hittable.Value());
+			sortKeys.Remove(hittable.Key());
+			hittable.RemoveCurrent();
+			continue;
+		}
+		if (actor->IsRootComponentMovable())
+		{
+			targetHash.Update(hittable.Value(), actor->GetActorLocation());
+		}
+	}
+}
+
+void UCombatSubsystem::CullPendingSweeps()
+{
+	const bool bCullSweeps = CVarCullWeaponSweeps.GetValueOnGameThread() != 0;
+
+	for (int32 index = pendingSweeps.Num() - 1; index >= 0; index--)
+	{
+		const FWeaponSweepRequest& request = pendingSweeps[index];
+		//Synthetic sweeps have nobody to credit hits to and always go to physics
+		ARebellionCharacter* attacker = request.attacker.Get();
+		if (!attacker)
+		{
+			continue;
+		}
+
+		//The box's bounding sphere, a little generous on the corners
+		const float sweepRadius = request.halfExtent.Size();
+		candidateScratch.Reset();
+		targetHash.QuerySegment(request.start, request.end, sweepRadius, candidateScratch);
+
+		//Pawns and damageable props are only hit through physics, crowd enemies only here
+		bool bPhysicsTargetNearby = false;
+		for (int32 targetId : candidateScratch)
+		{
+			const FCombatTarget& target = targetHash.GetTarget(targetId);
+			AActor* targetActor = target.actor.Get();
+			if (!targetActor || targetActor == attacker)
+			{
+				continue;
+			}
+
+			if (target.subIndex == INDEX_NONE)
+			{
+				bPhysicsTargetNearby = true;
+			}
+			else if (AEnemyCrowdManager* crowd = Cast<AEnemyCrowdManager>(targetActor))
+			{
+				if (crowd->IsEnemyInSweep(target.subIndex, request.start, request.end, sweepRadius))
+				{
+					currentFrameStats.crowdHits++;
+					attacker->ReceiveCrowdHit(crowd, target.subIndex);
+				}
+			}
+		}
+
+		if (bCullSweeps && !bPhysicsTargetNearby)
+		{
+			currentFrameStats.sweepsCulled++;
+			pendingSweeps.RemoveAtSwap(index, 1, false);
+		}
+	}
+	INC_DWORD_STAT_BY(STAT_Rebellion_WeaponSweepsCulled, currentFrameStats.sweepsCulled);
+}
+
+void UCombatSubsystem::DispatchCompletedSweeps()
+{
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	UWorld* world = GetWorld();
+
+	FTraceDatum traceData;
+	for (const FInFlightSweep& sweep : inFlightSweeps)
+	{
+		if (!world->QueryTraceData(sweep.handle, traceData))
+		{
+			continue;
+		}
+
+		currentFrameStats.sweepsDispatched++;
+		currentFrameStats.hitsDispatched += traceData.OutHits.Num();
+
+		//Results are a frame late, a sweep from a swing's last frame must not be credited to the next swing
+		ARebellionCharacter* attacker = sweep.attacker.Get();
+		if (attacker && (attacker->GetAttackSerial() != sweep.attackSerial || attacker->GetAttackWindowState() != EAttackWindowState::ACTIVE))
+		{
+			currentFrameStats.sweepsStale++;
+			continue;
+		}
+		if (attacker && traceData.OutHits.Num() > 0)
+		{
+			attacker->ReceiveWeaponHits(traceData.OutHits);
+		}
+	}
+	inFlightSweeps.Reset();
+
+	currentFrameStats.dispatchCycles = FPlatformTime::Cycles64() - startCycles;
+}
+
+void UCombatSubsystem::IssuePendingSweeps()
+{
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	UWorld* world = GetWorld();
+
+	inFlightSweeps.Reserve(pendingSweeps.Num());
+	for (const FWeaponSweepRequest& request : pendingSweeps)
+	{
+		FCollisionQueryParams queryParams(SCENE_QUERY_STAT(WeaponSweep), false, request.attacker.Get());
+
+		FInFlightSweep& sweep = inFlightSweeps.AddDefaulted_GetRef();
+		sweep.attacker = request.attacker;
+		sweep.attackSerial = request.attackSerial;
+		sweep.handle = world->AsyncSweepByChannel(EAsyncTraceType::Multi, request.start, request.end, request.rotation, ECC_Weapon, FCollisionShape::MakeBox(request.halfExtent), queryParams);
+	}
+	currentFrameStats.sweepsIssued = pendingSweeps.Num();
+	INC_DWORD_STAT_BY(STAT_Rebellion_WeaponSweeps, pendingSweeps.Num());
+	pendingSweeps.Reset();
+
+	currentFrameStats.issueCycles = FPlatformTime::Cycles64() - startCycles;
+}
+
+namespace CombatLatencyReport
+{
+	static void WriteReport(const TArray<FString>& args, UWorld* world)
+	{
+		UCombatSubsystem* combat = world ? world->GetSubsystem<UCombatSubsystem>() : nullptr;
+		if (!combat)
+		{
+			return;
+		}
+
+		if (args.Contains(TEXT("reset")))
+		{
+			combat->ResetInputLatency();
+			UE_LOG(LogRebellion, Display, TEXT("Input latency samples reset"));
+			return;
+		}
+
+		const TArray<float>& montageSamples = combat->GetInputLatencySamples(ECombatInputLatency::INPUT_TO_MONTAGE);
+		const TArray<float>& hitSamples = combat->GetInputLatencySamples(ECombatInputLatency::INPUT_TO_FIRST_HIT);
+
+		TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+		report->SetStringField(TEXT("map"), world->GetMapName());
+		report->SetNumberField(TEXT("attacks"), montageSamples.Num());
+		report->SetNumberField(TEXT("attacksThatHit"), hitSamples.Num());
+		report->SetObjectField(TEXT("inputToMontageMs"), URebellionBenchmarkSubsystem::MakePercentiles(montageSamples));
+		report->SetObjectField(TEXT("inputToFirstHitMs"), URebellionBenchmarkSubsystem::MakePercentiles(hitSamples));
+
+		URebellionBenchmarkSubsystem::SaveReport(report, TEXT("InputLatency"), true);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs latencyReportCommand(
+		TEXT("Rebellion.Combat.LatencyReport"),
+		TEXT("Writes input to montage start and input to first hit latency percentiles as JSON to Saved/Profiling/Rebellion. Args: [reset]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&WriteReport));
+}
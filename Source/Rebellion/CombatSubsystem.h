@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/EngineBaseTypes.h"
+#include "WorldCollision.h"
+#include "CombatSpatialHash.h"
+#include "UObject/ObjectKey.h"
+#include "CombatSubsystem.generated.h"
+
+class ARebellionCharacter;
+class AEnemyCrowdManager;
+class AProjectileManager;
+class APawn;
+class UCombatSubsystem;
+enum class EAttackType : uint8;
+
+/** A confirmed hit waiting for the damage pass. Plain data, copied around and sorted in bulk */
+struct FCombatHitRecord
+{
+	//Weak, a garbage collection can run between queueing the hit and the damage pass
+	TWeakObjectPtr<AActor> attacker;
+	//A pawn, a prop or a crowd manager with the enemy in targetSubIndex
+	TWeakObjectPtr<AActor> target;
+	int32 targetSubIndex;
+	EAttackType attackType;
+	float damage;
+	FVector hitLocation;
+	FVector hitDirection;
+	//World time the hit was detected
+	float timestamp;
+	//Queue order, last tie breaker
+	uint32 sequence;
+	//Reproducible order of attacker and target, see UCombatSubsystem::GetSortKey
+	uint32 attackerKey;
+	uint32 targetKey;
+	//Taken at QueueHit so the compute stage never reads an actor
+	FVector attackerLocation;
+	//Flat facing of a pawn target, zero for crowd enemies
+	FVector targetForward;
+	bool bTargetBlocking;
+};
+
+/** How a hit lands, picked by the compute stage and acted on by the apply stage */
+enum class ECombatHitReaction : uint8
+{
+	//Frontal hit on a blocking target, reduced damage and no knockback
+	BLOCKED,
+	//Damage below Rebellion.Combat.KnockbackDamage, no knockback
+	FLINCH,
+	KNOCKBACK
+};
+
+/** Damage pass tuning, read from the console variables once per pass so workers never touch them */
+struct FCombatHitRules
+{
+	//Ranged damage scales from 1 at falloffStart down to falloffMinScale at falloffEnd, off by default
+	float rangedFalloffStart = 1500.f;
+	float rangedFalloffEnd = 4000.f;
+	float rangedFalloffMinScale = 1.f;
+	//Cosine of the half angle in front of a blocking target that it blocks
+	float blockCosine = 0.5f;
+	float blockDamageScale = 1.f;
+	//0 knocks back on every hit, FLINCH only happens once this is raised
+	float knockbackDamage = 0.f;
+
+	static FCombatHitRules FromConsoleVariables();
+};
+
+/** What the compute stage worked out for a hit, index aligned with the sorted hit records */
+struct FCombatHitResult
+{
+	float damage;
+	//Flat unit direction, zero unless the reaction is KNOCKBACK
+	FVector knockback;
+	ECombatHitReaction reaction;
+};
+
+/** Resolves the queued hits once per frame at a fixed point in the frame */
+struct FCombatDamageTickFunction : public FTickFunction
+{
+	UCombatSubsystem* combat = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override { return TEXT("CombatDamageTick"); }
+};
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnCombatKill, AActor* /*attacker*/, AActor* /*target*/, int32 /*targetSubIndex*/);
+
+/** One weapon sweep segment queued by an attack window */
+struct FWeaponSweepRequest
+{
+	//Null for synthetic load (benchmarks), results are counted but not dispatched
+	TWeakObjectPtr<ARebellionCharacter> attacker;
+	//Swing the sweep belongs to, results that come back after it ended are dropped
+	uint32 attackSerial = 0;
+	FVector start;
+	FVector end;
+	FQuat rotation;
+	FVector halfExtent;
+};
+
+/** Per frame numbers for the weapon trace batch */
+struct FCombatTraceFrameStats
+{
+	int32 sweepsIssued = 0;
+	int32 sweepsDispatched = 0;
+	int32 hitsDispatched = 0;
+	int32 sweepsCulled = 0;
+	//Results that came back after their swing's window closed or another swing started
+	int32 sweepsStale = 0;
+	int32 crowdHits = 0;
+	uint64 issueCycles = 0;
+	uint64 dispatchCycles = 0;
+};
+
+/** Attack responsiveness measurements, all from the press's FPlatformTime stamp */
+enum class ECombatInputLatency : uint8
+{
+	INPUT_TO_MONTAGE,
+	INPUT_TO_FIRST_HIT,
+	COUNT
+};
+
+/** Numbers for the last damage pass */
+struct FCombatDamageFrameStats
+{
+	int32 hitsResolved = 0;
+	int32 kills = 0;
+	int32 blocked = 0;
+	//Tasks the compute stage ran on, 1 when it ran inline
+	int32 computeTasks = 0;
+	uint64 sortCycles = 0;
+	uint64 computeCycles = 0;
+	//Serial apply stage on the game thread
+	uint64 resolveCycles = 0;
+};
+
+/**
+ * Batches every active attack window's weapon sweeps into one set of async traces per frame.
+ * Characters are added when their window opens and removed when it closes; the subsystem samples
+ * their weapons once per frame after the world tick, so animation notifies do no per frame work.
+ * Sweeps queued during frame N are issued at the end of frame N and their hits are dispatched to
+ * the attackers on frame N+1, once the async trace buffers have been swapped.
+ * Every pawn, damageable prop and crowd enemy is kept in a spatial hash. A sweep is tested against crowd
+ * enemies directly and only becomes a physics sweep when a pawn or prop other than the attacker is near its path.
+ * Detected hits are only queued; damage, hit reactions and kills are applied together in TG_PostPhysics.
+ * That pass sorts the hits, computes falloff, blocking and reactions from plain data in parallel and
+ * then applies the results to actors serially on the game thread.
+ */
+UCLASS()
+class REBELLION_API UCombatSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	/** Characters whose weapon is swept every frame, between their attack window's begin and end */
+	void AddAttackWindow(ARebellionCharacter* attacker);
+	void RemoveAttackWindow(ARebellionCharacter* attacker);
+
+	/** Queues a weapon box sweep, issued with the rest of this frame's batch */
+	void QueueWeaponSweep(ARebellionCharacter* attacker, const FVector& start, const FVector& end, const FQuat& rotation, const FVector& halfExtent);
+
+	/** Pawns are tracked in the target hash between these calls, their positions refreshed every frame */
+	void RegisterPawn(APawn* pawn);
+	void UnregisterPawn(APawn* pawn);
+
+	/**
+	 * Props that react to damage are tracked in the target hash automatically, so weapon sweeps near them
+	 * aren't culled: anything not a pawn that can be damaged, doesn't ignore the weapon channel and binds
+	 * OnTakeAnyDamage/OnTakePointDamage, implements AnyDamage/PointDamage or has this actor tag.
+	 */
+	static const FName hittableTag;
+
+	/** Targets whose owner moves them itself, crowd enemies pass their index as subIndex */
+	int32 RegisterTarget(AActor* actor, const FVector& position, float radius, int32 subIndex = INDEX_NONE);
+	void UnregisterTarget(int32 targetId);
+	void UpdateTarget(int32 targetId, const FVector& position) { targetHash.Update(targetId, position); }
+
+	/** Candidate target queries for attacks, see FCombatSpatialHash */
+	const FCombatSpatialHash& GetTargetHash() const { return targetHash; }
+
+	/** Queues a hit for the next damage pass, hits are never applied where they are detected */
+	void QueueHit(AActor* attacker, AActor* target, int32 targetSubIndex, EAttackType attackType, float damage, const FVector& hitLocation, const FVector& hitDirection);
+
+	/** The world's projectiles, spawned on first use */
+	AProjectileManager* GetProjectileManager();
+
+	/** Sorts and applies every queued hit, run by damageTick */
+	void ResolveQueuedHits();
+
+	/**
+	 * Compute stage of the damage pass, results[i] for records[i]. Reads nothing but its arguments, so it
+	 * runs contiguous chunks of chunkSize records on up to taskCount task graph threads; 1 runs inline.
+	 */
+	static void ComputeHitResults(const TArray<FCombatHitRecord>& records, TArray<FCombatHitResult>& results, const FCombatHitRules& rules, int32 taskCount, int32 chunkSize);
+	static FCombatHitResult ComputeHitResult(const FCombatHitRecord& record, const FCombatHitRules& rules);
+	/** Rebellion.Combat.HitResolveTasks, or every worker plus the game thread */
+	static int32 GetHitResolveTaskCount();
+
+	/** Broadcast from the damage pass for each pawn or crowd enemy killed */
+	FOnCombatKill OnKill;
+
+	/**
+	 * Latency samples in milliseconds, every character in the world together. The newest
+	 * maxInputLatencySamples are kept; Rebellion.Combat.LatencyReport writes their percentiles.
+	 */
+	void RecordInputLatency(ECombatInputLatency kind, float milliseconds);
+	const TArray<float>& GetInputLatencySamples(ECombatInputLatency kind) const { return inputLatencySamples[(int32)kind]; }
+	void ResetInputLatency();
+
+	/** Numbers for the last completed frame */
+	const FCombatTraceFrameStats& GetLastFrameStats() const { return lastFrameStats; }
+	const FCombatDamageFrameStats& GetLastDamageStats() const { return lastDamageStats; }
+
+private:
+
+	struct FInFlightSweep
+	{
+		TWeakObjectPtr<ARebellionCharacter> attacker;
+		uint32 attackSerial;
+		FTraceHandle handle;
+	};
+
+	void DispatchCompletedSweeps();
+	void SweepAttackWindows();
+	void IssuePendingSweeps();
+	void RegisterDamageTick();
+	void UpdatePawnTargets();
+	//Hits crowd enemies and drops sweeps with no pawn or prop near them before anything reaches physics
+	void CullPendingSweeps();
+
+	//Damageable props, see hittableTag
+	void OnActorSpawned(AActor* actor);
+	void OnLevelAddedToWorld(ULevel* level, UWorld* world);
+	void TrackHittables(const ULevel* level);
+	void TrackHittable(AActor* actor);
+	void UpdateHittableTargets();
+
+	TArray<TWeakObjectPtr<ARebellionCharacter>> attackWindows;
+	TArray<FWeaponSweepRequest> pendingSweeps;
+	TArray<FInFlightSweep> inFlightSweeps;
+
+	struct FTrackedPawn
+	{
+		TWeakObjectPtr<APawn> pawn;
+		int32 targetId;
+	};
+
+	FCombatSpatialHash targetHash;
+	TArray<FTrackedPawn> trackedPawns;
+	//Target id of each damageable prop
+	TMap<TObjectKey<AActor>, int32> trackedHittables;
+	//Levels loaded before the first tick are searched then, their actors' BeginPlay binds damage events
+	bool bHittablesTracked = false;
+	FDelegateHandle actorSpawnedHandle;
+	FDelegateHandle levelAddedHandle;
+
+	//Hit sort keys in registration order, the same for the same spawn order unlike object ids
+	void AssignSortKey(const AActor* actor);
+	//Unregistered actors sort after registered ones by a hash of their name
+	uint32 GetSortKey(const AActor* actor) const;
+	TMap<TObjectKey<AActor>, uint32> sortKeys;
+	uint32 nextSortKey = 1;
+	//Scratch for sweep candidate queries
+	TArray<int32> candidateScratch;
+
+	TArray<FCombatHitRecord> queuedHits;
+	TArray<FCombatHitResult> hitResults;
+	uint32 nextHitSequence = 0;
+	FCombatDamageTickFunction damageTick;
+
+	static constexpr int32 maxInputLatencySamples = 8192;
+	TArray<float> inputLatencySamples[(int32)ECombatInputLatency::COUNT];
+	//Oldest sample, overwritten once a kind is full
+	int32 nextInputLatencySample[(int32)ECombatInputLatency::COUNT] = {};
+
+	FCombatTraceFrameStats currentFrameStats;
+	FCombatTraceFrameStats lastFrameStats;
+	FCombatDamageFrameStats lastDamageStats;
+
+	UPROPERTY(Transient)
+		AProjectileManager* projectileManager;
+};
@@ -0,0 +1,295 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyCrowdManager.h"
+#include "CombatSubsystem.h"
+#include "RebellionLog.h"
+#include "RebellionStats.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "Kismet/GameplayStatics.h"
+#include "UObject/ConstructorHelpers.h"
+
+AEnemyCrowdManager::AEnemyCrowdManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	initialEnemyCount = 200;
+	spawnRadius = 2500.f;
+	maxHealth = 100.f;
+	moveSpeed = 250.f;
+	engageDistance = 150.f;
+	hitReactionTime = 0.4f;
+	knockbackSpeed = 600.f;
+	enemyRadius = 40.f;
+	enemyHalfHeight = 90.f;
+
+	numAlive = 0;
+	lastUpdateMs = 0.0;
+	lastInstanceUploadMs = 0.0;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	enemyMeshes = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("EnemyMeshes"));
+	enemyMeshes->SetupAttachment(RootComponent);
+	//Instance transforms are written in world space, pinning the component to the world origin makes them local too
+	enemyMeshes->SetUsingAbsoluteLocation(true);
+	enemyMeshes->SetUsingAbsoluteRotation(true);
+	enemyMeshes->SetUsingAbsoluteScale(true);
+	//Weapon sweeps test the SoA positions, thousands of per instance bodies would only cost physics time
+	enemyMeshes->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	enemyMeshes->SetGenerateOverlapEvents(false);
+	enemyMeshes->SetCanEverAffectNavigation(false);
+	enemyMeshes->SetMobility(EComponentMobility::Movable);
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> enemyMeshObject(TEXT("StaticMesh'/Engine/BasicShapes/Cylinder.Cylinder'"));
+	if (enemyMeshObject.Succeeded())
+	{
+		enemyMeshes->SetStaticMesh(enemyMeshObject.Object);
+	}
+}
+
+void AEnemyCrowdManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+
+	if (initialEnemyCount > 0)
+	{
+		SpawnEnemies(initialEnemyCount, GetActorLocation(), spawnRadius);
+	}
+}
+
+void AEnemyCrowdManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClearEnemies();
+	combat = nullptr;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AEnemyCrowdManager::SpawnEnemies(int32 count, const FVector& center, float radius)
+{
+	const int32 firstEnemy = positions.Num();
+	const int32 newNum = firstEnemy + count;
+	positions.Reserve(newNum);
+	velocities.Reserve(newNum);
+	health.Reserve(newNum);
+	hitReactionTimers.Reserve(newNum);
+	states.Reserve(newNum);
+	targetIds.Reserve(newNum);
+
+	//Fixed seed so benchmark runs place the same crowd every time
+	FRandomStream random(firstEnemy + 1);
+	for (int32 enemy = 0; enemy < count; enemy++)
+	{
+		const FVector2D offset = FVector2D(random.FRandRange(-1.f, 1.f), random.FRandRange(-1.f, 1.f)) * radius;
+		positions.Add(center + FVector(offset, 0.f));
+		velocities.Add(FVector::ZeroVector);
+		health.Add(maxHealth);
+		hitReactionTimers.Add(0.f);
+		states.Add(ECrowdEnemyState::CHASING);
+		targetIds.Add(combat ? combat->RegisterTarget(this, positions.Last(), enemyHalfHeight, firstEnemy + enemy) : INDEX_NONE);
+	}
+	numAlive += count;
+	INC_DWORD_STAT_BY(STAT_Rebellion_CrowdEnemies, count);
+
+	//Engine cylinder is 100 units wide and tall with its pivot in the middle
+	const FVector scale(enemyRadius / 50.f, enemyRadius / 50.f, enemyHalfHeight / 50.f);
+	instanceTransforms.SetNum(newNum);
+	for (int32 enemy = firstEnemy; enemy < newNum; enemy++)
+	{
+		instanceTransforms[enemy] = FTransform(FQuat::Identity, positions[enemy], scale);
+		enemyMeshes->AddInstance(instanceTransforms[enemy]);
+	}
+}
+
+void AEnemyCrowdManager::ClearEnemies()
+{
+	DEC_DWORD_STAT_BY(STAT_Rebellion_CrowdEnemies, numAlive);
+
+	if (combat)
+	{
+		for (int32 targetId : targetIds)
+		{
+			if (targetId != INDEX_NONE)
+			{
+				combat->UnregisterTarget(targetId);
+			}
+		}
+	}
+
+	positions.Reset();
+	velocities.Reset();
+	health.Reset();
+	hitReactionTimers.Reset();
+	states.Reset();
+	targetIds.Reset();
+	instanceTransforms.Reset();
+	numAlive = 0;
+
+	enemyMeshes->ClearInstances();
+}
+
+void AEnemyCrowdManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const APawn* player = UGameplayStatics::GetPlayerPawn(this, 0);
+	const FVector targetLocation = player ? player->GetActorLocation() : GetActorLocation();
+
+	uint64 startCycles = FPlatformTime::Cycles64();
+	UpdateCrowd(DeltaTime, targetLocation);
+	UpdateTargets();
+	lastUpdateMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+	startCycles = FPlatformTime::Cycles64();
+	UploadInstanceTransforms();
+	lastInstanceUploadMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+}
+
+void AEnemyCrowdManager::UpdateCrowd(float DeltaTime, const FVector& targetLocation)
+{
+	REBELLION_SCOPE(CrowdUpdate);
+
+	const int32 numEnemies = positions.Num();
+	FVector* RESTRICT position = positions.GetData();
+	FVector* RESTRICT velocity = velocities.GetData();
+	float* RESTRICT reactionTimer = hitReactionTimers.GetData();
+	ECrowdEnemyState* RESTRICT state = states.GetData();
+
+	const float engageDistanceSquared = FMath::Square(engageDistance);
+	//Knockback bleeds off over the reaction
+	const float knockbackDamping = FMath::Clamp(1.f - DeltaTime * 8.f, 0.f, 1.f);
+
+	for (int32 enemy = 0; enemy < numEnemies; enemy++)
+	{
+		switch (state[enemy])
+		{
+		case ECrowdEnemyState::DEAD:
+			continue;
+
+		case ECrowdEnemyState::HIT_REACT:
+			reactionTimer[enemy] -= DeltaTime;
+			velocity[enemy] *= knockbackDamping;
+			if (reactionTimer[enemy] <= 0.f)
+			{
+				state[enemy] = ECrowdEnemyState::CHASING;
+			}
+			break;
+
+		case ECrowdEnemyState::IDLE:
+		case ECrowdEnemyState::CHASING:
+		{
+			const FVector toTarget(targetLocation.X - position[enemy].X, targetLocation.Y - position[enemy].Y, 0.f);
+			const float distanceSquared = toTarget.SizeSquared();
+			if (distanceSquared > engageDistanceSquared)
+			{
+				state[enemy] = ECrowdEnemyState::CHASING;
+				velocity[enemy] = toTarget * (moveSpeed * FMath::InvSqrt(distanceSquared));
+			}
+			else
+			{
+				state[enemy] = ECrowdEnemyState::IDLE;
+				velocity[enemy] = FVector::ZeroVector;
+			}
+			break;
+		}
+		}
+
+		position[enemy] += velocity[enemy] * DeltaTime;
+	}
+}
+
+void AEnemyCrowdManager::UploadInstanceTransforms()
+{
+	REBELLION_SCOPE(CrowdInstanceUpload);
+
+	const int32 numEnemies = positions.Num();
+	if (numEnemies == 0)
+	{
+		return;
+	}
+
+	for (int32 enemy = 0; enemy < numEnemies; enemy++)
+	{
+		//Dead enemies keep their instance slot so indices stay stable, they are just scaled away
+		if (states[enemy] == ECrowdEnemyState::DEAD)
+		{
+			instanceTransforms[enemy].SetScale3D(FVector::ZeroVector);
+		}
+		instanceTransforms[enemy].SetTranslation(positions[enemy]);
+	}
+
+	//One render state update for the whole crowd
+	enemyMeshes->BatchUpdateInstancesTransforms(0, instanceTransforms, false, true, true);
+}
+
+void AEnemyCrowdManager::UpdateTargets()
+{
+	if (!combat)
+	{
+		return;
+	}
+
+	//Only enemies crossing a cell edge touch the hash buckets
+	const int32 numEnemies = positions.Num();
+	for (int32 enemy = 0; enemy < numEnemies; enemy++)
+	{
+		if (targetIds[enemy] != INDEX_NONE)
+		{
+			combat->UpdateTarget(targetIds[enemy], positions[enemy]);
+		}
+	}
+}
+
+bool AEnemyCrowdManager::IsEnemyInSweep(int32 enemyIndex, const FVector& start, const FVector& end, float sweepRadius) const
+{
+	if (!states.IsValidIndex(enemyIndex) || states[enemyIndex] == ECrowdEnemyState::DEAD)
+	{
+		return false;
+	}
+
+	//Capsule axis between the centers of its two end spheres
+	const FVector& position = positions[enemyIndex];
+	const FVector axisOffset(0.f, 0.f, FMath::Max(enemyHalfHeight - enemyRadius, 0.f));
+
+	FVector closestOnSweep;
+	FVector closestOnEnemy;
+	FMath::SegmentDistToSegmentSafe(start, end, position - axisOffset, position + axisOffset, closestOnSweep, closestOnEnemy);
+	return FVector::DistSquared(closestOnSweep, closestOnEnemy) <= FMath::Square(sweepRadius + enemyRadius);
+}
+
+bool AEnemyCrowdManager::ApplyMeleeHit(int32 enemyIndex, float damage, const FVector& hitDirection)
+{
+	if (!states.IsValidIndex(enemyIndex) || states[enemyIndex] == ECrowdEnemyState::DEAD)
+	{
+		return false;
+	}
+
+	health[enemyIndex] -= damage;
+	if (health[enemyIndex] <= 0.f)
+	{
+		health[enemyIndex] = 0.f;
+		states[enemyIndex] = ECrowdEnemyState::DEAD;
+		velocities[enemyIndex] = FVector::ZeroVector;
+		if (combat && targetIds[enemyIndex] != INDEX_NONE)
+		{
+			combat->UnregisterTarget(targetIds[enemyIndex]);
+			targetIds[enemyIndex] = INDEX_NONE;
+		}
+		numAlive--;
+		DEC_DWORD_STAT(STAT_Rebellion_CrowdEnemies);
+		REB_LOG(DEBUG, "Crowd enemy %d killed, %d left", enemyIndex, numAlive);
+		return true;
+	}
+
+	states[enemyIndex] = ECrowdEnemyState::HIT_REACT;
+	hitReactionTimers[enemyIndex] = hitReactionTime;
+	velocities[enemyIndex] = hitDirection.GetSafeNormal2D() * knockbackSpeed;
+	return false;
+}
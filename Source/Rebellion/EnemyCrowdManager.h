@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "EnemyCrowdManager.generated.h"
+
+class UInstancedStaticMeshComponent;
+
+UENUM(BlueprintType)
+enum class ECrowdEnemyState : uint8
+{
+	IDLE			UMETA(DisplayName = "Idle"),
+	CHASING			UMETA(DisplayName = "Chasing"),
+	HIT_REACT		UMETA(DisplayName = "Hit reaction"),
+	DEAD			UMETA(DisplayName = "Dead")
+};
+
+/**
+ * Lightweight enemies without an actor each. State lives in parallel arrays (structure of arrays)
+ * updated in one pass per frame, and every enemy is one instance of enemyMeshes.
+ * The instances have no collision: every live enemy is a target in UCombatSubsystem's spatial hash,
+ * weapon sweeps near one are tested against its capsule and resolve into ApplyMeleeHit.
+ */
+UCLASS()
+class REBELLION_API AEnemyCrowdManager : public AActor
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Crowd, meta = (AllowPrivateAccess = "true"))
+		UInstancedStaticMeshComponent* enemyMeshes;
+
+public:
+	AEnemyCrowdManager();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaTime) override;
+
+	/** Enemies spawned around the manager on BeginPlay */
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		int32 initialEnemyCount;
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float spawnRadius;
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float maxHealth;
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float moveSpeed;
+	/** Enemies stop chasing inside this distance of the player */
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float engageDistance;
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float hitReactionTime;
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float knockbackSpeed;
+	/** Collision capsule used for weapon sweeps */
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float enemyRadius;
+	UPROPERTY(EditAnywhere, Category = Crowd)
+		float enemyHalfHeight;
+
+	/** Adds count enemies scattered within radius of center */
+	void SpawnEnemies(int32 count, const FVector& center, float radius);
+
+	/** Removes every enemy and its instance */
+	void ClearEnemies();
+
+	/** True if the enemy is alive and the swept sphere from start to end touches its capsule */
+	bool IsEnemyInSweep(int32 enemyIndex, const FVector& start, const FVector& end, float sweepRadius) const;
+
+	/** Damages an enemy and starts its hit reaction, pushing it along hitDirection. True if this hit killed it */
+	bool ApplyMeleeHit(int32 enemyIndex, float damage, const FVector& hitDirection);
+
+	int32 GetNumEnemies() const { return positions.Num(); }
+	int32 GetNumAlive() const { return numAlive; }
+	const FVector& GetEnemyPosition(int32 enemyIndex) const { return positions[enemyIndex]; }
+
+	/** Cost of last frame's simulation pass and instance upload */
+	double GetLastUpdateMs() const { return lastUpdateMs; }
+	double GetLastInstanceUploadMs() const { return lastInstanceUploadMs; }
+
+private:
+
+	void UpdateCrowd(float DeltaTime, const FVector& targetLocation);
+	void UploadInstanceTransforms();
+	void UpdateTargets();
+
+	//Structure of arrays, one element per enemy
+	TArray<FVector> positions;
+	TArray<FVector> velocities;
+	TArray<float> health;
+	TArray<float> hitReactionTimers;
+	TArray<ECrowdEnemyState> states;
+	//UCombatSubsystem target hash ids, INDEX_NONE once dead
+	TArray<int32> targetIds;
+
+	//Scratch for the instance upload
+	TArray<FTransform> instanceTransforms;
+
+	int32 numAlive;
+	double lastUpdateMs;
+	double lastInstanceUploadMs;
+
+	UPROPERTY(Transient)
+		class UCombatSubsystem* combat;
+};
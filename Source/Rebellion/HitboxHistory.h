@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** A character's hit shapes at one moment, in world space */
+struct FHitboxFrame
+{
+	//Server world time the frame was recorded at
+	float time;
+	FVector capsuleCenter;
+	float capsuleRadius;
+	float capsuleHalfHeight;
+	//Weapon socket box, zero extent for characters without one
+	FVector weaponLocation;
+	FQuat weaponRotation;
+	FVector weaponHalfExtent;
+
+	bool HasWeapon() const { return !weaponHalfExtent.IsZero(); }
+
+	static FHitboxFrame Lerp(const FHitboxFrame& from, const FHitboxFrame& to, float alpha)
+	{
+		FHitboxFrame frame = to;
+		frame.time = FMath::Lerp(from.time, to.time, alpha);
+		frame.capsuleCenter = FMath::Lerp(from.capsuleCenter, to.capsuleCenter, alpha);
+		frame.weaponLocation = FMath::Lerp(from.weaponLocation, to.weaponLocation, alpha);
+		frame.weaponRotation = FQuat::Slerp(from.weaponRotation, to.weaponRotation, alpha);
+		return frame;
+	}
+};
+
+/**
+ * Fixed size ring of hitbox frames sampled at SampleRate. The slot for a time is computed from
+ * the time itself, so recording and rewinding are O(1) however long the history is and memory
+ * never grows. Frames recorded within one sample period overwrite each other, a long frame fills
+ * every sample it covered with its own frame.
+ */
+struct FHitboxHistory
+{
+	static constexpr int32 Capacity = 64;
+	static constexpr float SampleRate = 60.f;
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	FHitboxHistory() { Reset(); }
+
+	/** Seconds of history kept, rewinds further back than this fail */
+	static constexpr float GetDuration() { return (Capacity - 1) / SampleRate; }
+
+	void Record(const FHitboxFrame& frame)
+	{
+		const int32 sample = FMath::FloorToInt(frame.time * SampleRate);
+		const int32 firstSample = FMath::Max(newestSample == INDEX_NONE ? sample : newestSample + 1, sample - Capacity + 1);
+		for (int32 fill = FMath::Min(firstSample, sample); fill <= sample; fill++)
+		{
+			frames[fill & (Capacity - 1)] = frame;
+			samples[fill & (Capacity - 1)] = fill;
+		}
+		newestSample = FMath::Max(newestSample, sample);
+	}
+
+	/** Frame at time, interpolated between the samples either side. False if time is outside the history */
+	bool Rewind(float time, FHitboxFrame& outFrame) const
+	{
+		const int32 sample = FMath::FloorToInt(time * SampleRate);
+		if (newestSample == INDEX_NONE || sample > newestSample || sample <= newestSample - Capacity || samples[sample & (Capacity - 1)] != sample)
+		{
+			return false;
+		}
+
+		const FHitboxFrame& from = frames[sample & (Capacity - 1)];
+		const int32 nextSample = sample + 1;
+		if (nextSample > newestSample || samples[nextSample & (Capacity - 1)] != nextSample)
+		{
+			outFrame = from;
+			return true;
+		}
+
+		const FHitboxFrame& to = frames[nextSample & (Capacity - 1)];
+		const float span = to.time - from.time;
+		outFrame = span > KINDA_SMALL_NUMBER ? FHitboxFrame::Lerp(from, to, FMath::Clamp((time - from.time) / span, 0.f, 1.f)) : from;
+		return true;
+	}
+
+	/** Raw frame of one sample, for validating a swept shape against both ends */
+	const FHitboxFrame* GetSample(int32 sample) const
+	{
+		return sample <= newestSample && samples[sample & (Capacity - 1)] == sample ? &frames[sample & (Capacity - 1)] : nullptr;
+	}
+
+	void Reset()
+	{
+		newestSample = INDEX_NONE;
+		for (int32& sample : samples)
+		{
+			sample = INDEX_NONE;
+		}
+	}
+
+private:
+
+	FHitboxFrame frames[Capacity];
+	//Sample each slot holds, slots are reused once the ring wraps
+	int32 samples[Capacity];
+	int32 newestSample;
+};
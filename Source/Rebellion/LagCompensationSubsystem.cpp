@@ -0,0 +1,298 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+#include "RebellionLog.h"
+#include "RebellionStats.h"
+#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/GameStateBase.h"
+
+static TAutoConsoleVariable<int32> CVarLagCompEnabled(
+	TEXT("Rebellion.LagComp.Enabled"),
+	1,
+	TEXT("Rewind hitboxes to the client's time when validating hit claims. 0 validates against current positions."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarLagCompMaxRewindMs(
+	TEXT("Rebellion.LagComp.MaxRewindMs"),
+	400.f,
+	TEXT("Furthest back a claim may rewind, older claims are validated at this age. Capped by the hitbox history length."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarLagCompTolerance(
+	TEXT("Rebellion.LagComp.Tolerance"),
+	40.f,
+	TEXT("Slack in cm around rewound shapes, covers quantised hit locations and proxy smoothing."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarLagCompDraw(
+	TEXT("Rebellion.LagComp.Draw"),
+	0,
+	TEXT("Draw the rewound target capsule and weapon box of every claim on the server, green confirmed and red rejected."),
+	ECVF_Cheat);
+
+//Distance from location to an oriented box, zero inside it
+static float DistanceToBox(const FVector& location, const FVector& boxCenter, const FQuat& boxRotation, const FVector& halfExtent)
+{
+	const FVector local = boxRotation.UnrotateVector(location - boxCenter).GetAbs();
+	return (local - halfExtent).ComponentMax(FVector::ZeroVector).Size();
+}
+
+//Distance from location to an upright capsule, zero inside it
+static float DistanceToCapsule(const FVector& location, const FHitboxFrame& frame)
+{
+	const FVector axis(0.f, 0.f, FMath::Max(frame.capsuleHalfHeight - frame.capsuleRadius, 0.f));
+	const float axisDistance = FMath::PointDistToSegment(location, frame.capsuleCenter - axis, frame.capsuleCenter + axis);
+	return FMath::Max(axisDistance - frame.capsuleRadius, 0.f);
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	trackedCharacters.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType ULagCompensationSubsystem::GetTickableTickType() const
+{
+	//The class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+bool ULagCompensationSubsystem::IsRecording() const
+{
+	const ENetMode netMode = GetWorld()->GetNetMode();
+	return netMode == NM_ListenServer || netMode == NM_DedicatedServer;
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	REBELLION_SCOPE(LagCompRecord);
+
+	//Runs after the world tick, so these are the transforms this frame replicates
+	const float time = GetNetworkTime(GetWorld());
+	for (TPair<const AActor*, FTrackedCharacter>& pair : trackedCharacters)
+	{
+		FTrackedCharacter& tracked = pair.Value;
+		if (!tracked.character.IsValid())
+		{
+			continue;
+		}
+		if (!tracked.history)
+		{
+			tracked.history = MakeUnique<FHitboxHistory>();
+		}
+		tracked.history->Record(CaptureFrame(tracked, time));
+	}
+}
+
+void ULagCompensationSubsystem::RegisterCharacter(ACharacter* character, const UBoxComponent* weaponBox, FName weaponSocket)
+{
+	FTrackedCharacter& tracked = trackedCharacters.Add(character);
+	tracked.character = character;
+	tracked.weaponBox = weaponBox;
+	tracked.weaponSocket = weaponSocket;
+
+	//The weapon socket is sampled from the pose, a server that skipped evaluating it would record stale swings
+	USkeletalMeshComponent* mesh = character->GetMesh();
+	if (mesh && IsRecording())
+	{
+		mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	}
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter(ACharacter* character)
+{
+	trackedCharacters.Remove(character);
+}
+
+bool ULagCompensationSubsystem::RecordsHitboxes(const AActor* character) const
+{
+	return IsRecording() && trackedCharacters.Contains(character);
+}
+
+float ULagCompensationSubsystem::GetNetworkTime(const UWorld* world)
+{
+	const AGameStateBase* gameState = world->GetGameState();
+	return gameState ? gameState->GetServerWorldTimeSeconds() : world->GetTimeSeconds();
+}
+
+FHitboxFrame ULagCompensationSubsystem::CaptureFrame(const FTrackedCharacter& tracked, float time) const
+{
+	const ACharacter* character = tracked.character.Get();
+	const UCapsuleComponent* capsule = character->GetCapsuleComponent();
+
+	FHitboxFrame frame;
+	frame.time = time;
+	frame.capsuleCenter = capsule->GetComponentLocation();
+	frame.capsuleRadius = capsule->GetScaledCapsuleRadius();
+	frame.capsuleHalfHeight = capsule->GetScaledCapsuleHalfHeight();
+
+	//Sampled at the socket like the weapon sweeps, the box only supplies the extent
+	const UBoxComponent* weaponBox = tracked.weaponBox.Get();
+	if (weaponBox && character->GetMesh())
+	{
+		const FTransform weaponTransform = character->GetMesh()->GetSocketTransform(tracked.weaponSocket);
+		frame.weaponLocation = weaponTransform.GetLocation();
+		frame.weaponRotation = weaponTransform.GetRotation();
+		frame.weaponHalfExtent = weaponBox->GetScaledBoxExtent();
+	}
+	else
+	{
+		frame.weaponLocation = FVector::ZeroVector;
+		frame.weaponRotation = FQuat::Identity;
+		frame.weaponHalfExtent = FVector::ZeroVector;
+	}
+	return frame;
+}
+
+const ULagCompensationSubsystem::FTrackedCharacter* ULagCompensationSubsystem::FindTracked(const AActor* actor) const
+{
+	const FTrackedCharacter* tracked = trackedCharacters.Find(actor);
+	return tracked && tracked->character.IsValid() ? tracked : nullptr;
+}
+
+bool ULagCompensationSubsystem::RewindCharacter(const FTrackedCharacter& tracked, float clientTime, FHitboxFrame& outFrame) const
+{
+	const float now = GetNetworkTime(GetWorld());
+	if (!tracked.history || CVarLagCompEnabled.GetValueOnGameThread() == 0)
+	{
+		outFrame = CaptureFrame(tracked, now);
+		return true;
+	}
+
+	//Claims from the future are treated as now, ones older than the limit as the limit
+	const float maxRewind = FMath::Min(CVarLagCompMaxRewindMs.GetValueOnGameThread() / 1000.f, FHitboxHistory::GetDuration());
+	const float rewindTime = FMath::Clamp(clientTime, now - maxRewind, now);
+	return tracked.history->Rewind(rewindTime, outFrame);
+}
+
+bool ULagCompensationSubsystem::IsOnTarget(const AActor* target, float clientTime, const FVector& hitLocation) const
+{
+	const float tolerance = CVarLagCompTolerance.GetValueOnGameThread();
+
+	const FTrackedCharacter* tracked = FindTracked(target);
+	if (!tracked)
+	{
+		//Anything else is assumed not to have moved
+		const FBox bounds = target->GetComponentsBoundingBox().ExpandBy(tolerance);
+		return bounds.IsInsideOrOn(hitLocation);
+	}
+
+	FHitboxFrame frame;
+	if (!RewindCharacter(*tracked, clientTime, frame))
+	{
+		return false;
+	}
+
+	const bool bOnTarget = DistanceToCapsule(hitLocation, frame) <= tolerance;
+#if ENABLE_DRAW_DEBUG
+	if (CVarLagCompDraw.GetValueOnGameThread() != 0)
+	{
+		DrawDebugCapsule(GetWorld(), frame.capsuleCenter, frame.capsuleHalfHeight, frame.capsuleRadius, FQuat::Identity, bOnTarget ? FColor::Green : FColor::Red, false, 2.f);
+		DrawDebugPoint(GetWorld(), hitLocation, 12.f, FColor::Yellow, false, 2.f);
+	}
+#endif
+	return bOnTarget;
+}
+
+bool ULagCompensationSubsystem::ConfirmWeaponHit(const ACharacter* attacker, const AActor* target, float clientTime, const FVector& hitLocation)
+{
+	const FTrackedCharacter* tracked = FindTracked(attacker);
+	if (!tracked || !target)
+	{
+		return Resolve(false, attacker, target, TEXT("untracked attacker"));
+	}
+
+	FHitboxFrame frame;
+	if (!RewindCharacter(*tracked, clientTime, frame) || !frame.HasWeapon())
+	{
+		return Resolve(false, attacker, target, TEXT("no weapon history"));
+	}
+
+	//The sweep that found the hit ran between two frames, so either end of the surrounding samples counts
+	const float tolerance = CVarLagCompTolerance.GetValueOnGameThread();
+	bool bInWeapon = DistanceToBox(hitLocation, frame.weaponLocation, frame.weaponRotation, frame.weaponHalfExtent) <= tolerance;
+	if (tracked->history)
+	{
+		const int32 sample = FMath::FloorToInt(frame.time * FHitboxHistory::SampleRate);
+		for (int32 neighbour = sample - 1; neighbour <= sample + 1 && !bInWeapon; neighbour++)
+		{
+			const FHitboxFrame* neighbourFrame = tracked->history->GetSample(neighbour);
+			bInWeapon = neighbourFrame && DistanceToBox(hitLocation, neighbourFrame->weaponLocation, neighbourFrame->weaponRotation, neighbourFrame->weaponHalfExtent) <= tolerance;
+		}
+	}
+
+#if ENABLE_DRAW_DEBUG
+	if (CVarLagCompDraw.GetValueOnGameThread() != 0)
+	{
+		DrawDebugBox(GetWorld(), frame.weaponLocation, frame.weaponHalfExtent, frame.weaponRotation, bInWeapon ? FColor::Green : FColor::Red, false, 2.f);
+	}
+#endif
+
+	if (!bInWeapon)
+	{
+		return Resolve(false, attacker, target, TEXT("hit outside rewound weapon"));
+	}
+	if (!IsOnTarget(target, clientTime, hitLocation))
+	{
+		return Resolve(false, attacker, target, TEXT("hit outside rewound target"));
+	}
+	return Resolve(true, attacker, target, TEXT("weapon"));
+}
+
+bool ULagCompensationSubsystem::ConfirmShotHit(const ACharacter* attacker, const AActor* target, float clientTime, const FVector& hitLocation, float maxRange)
+{
+	const FTrackedCharacter* tracked = FindTracked(attacker);
+	if (!tracked || !target)
+	{
+		return Resolve(false, attacker, target, TEXT("untracked attacker"));
+	}
+
+	FHitboxFrame frame;
+	if (!RewindCharacter(*tracked, clientTime, frame))
+	{
+		return Resolve(false, attacker, target, TEXT("no shooter history"));
+	}
+	if (FVector::Dist(frame.capsuleCenter, hitLocation) > maxRange + CVarLagCompTolerance.GetValueOnGameThread())
+	{
+		return Resolve(false, attacker, target, TEXT("out of range"));
+	}
+	if (!IsOnTarget(target, clientTime, hitLocation))
+	{
+		return Resolve(false, attacker, target, TEXT("hit outside rewound target"));
+	}
+	return Resolve(true, attacker, target, TEXT("shot"));
+}
+
+bool ULagCompensationSubsystem::Resolve(bool bConfirmed, const ACharacter* attacker, const AActor* target, const TCHAR* reason)
+{
+	if (bConfirmed)
+	{
+		confirmedCount++;
+		INC_DWORD_STAT(STAT_Rebellion_LagCompConfirmed);
+		REB_LOG(TRACE, "Confirmed %s hit by %s on %s", reason, *GetNameSafe(attacker), *GetNameSafe(target));
+	}
+	else
+	{
+		rejectedCount++;
+		INC_DWORD_STAT(STAT_Rebellion_LagCompRejected);
+		REB_LOG(DEBUG, "Rejected hit by %s on %s, %s", *GetNameSafe(attacker), *GetNameSafe(target), reason);
+	}
+	return bConfirmed;
+}
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "HitboxHistory.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class ACharacter;
+class UBoxComponent;
+
+/**
+ * Server side hit validation. On a listen or dedicated server every registered character's capsule,
+ * and weapon box if it has one, is recorded into an FHitboxHistory after each world tick. A client
+ * claiming a hit sends the time it saw it (GetNetworkTime); the server rewinds the attacker and target
+ * to that time and only accepts the hit if the shapes were where the client says.
+ * Nothing is recorded in standalone or on clients, where hits are applied directly.
+ * Rebellion.LagComp.Enabled 0 validates against current positions instead, Rebellion.LagComp.Draw 1
+ * draws the rewound shapes of every claim on the server.
+ */
+UCLASS()
+class REBELLION_API ULagCompensationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	/** Characters are recorded between these calls, weaponBox is sampled at weaponSocket of the character's mesh */
+	void RegisterCharacter(ACharacter* character, const UBoxComponent* weaponBox = nullptr, FName weaponSocket = NAME_None);
+	void UnregisterCharacter(ACharacter* character);
+
+	/** Whether character's hitboxes are recorded here, its pose then has to be evaluated every server frame */
+	bool RecordsHitboxes(const AActor* character) const;
+
+	/**
+	 * Server world time as this machine knows it, what clients stamp hit claims with.
+	 * A client's copy trails the server by about half its round trip, as do the proxies it is hitting.
+	 */
+	static float GetNetworkTime(const UWorld* world);
+
+	/** Melee claim: at clientTime hitLocation was on target and inside attacker's weapon box */
+	bool ConfirmWeaponHit(const ACharacter* attacker, const AActor* target, float clientTime, const FVector& hitLocation);
+
+	/** Ranged claim: at clientTime hitLocation was on target and within maxRange of attacker */
+	bool ConfirmShotHit(const ACharacter* attacker, const AActor* target, float clientTime, const FVector& hitLocation, float maxRange);
+
+	/** Claims since the world started */
+	int32 GetConfirmedCount() const { return confirmedCount; }
+	int32 GetRejectedCount() const { return rejectedCount; }
+
+private:
+
+	struct FTrackedCharacter
+	{
+		TWeakObjectPtr<ACharacter> character;
+		TWeakObjectPtr<const UBoxComponent> weaponBox;
+		FName weaponSocket;
+		TUniquePtr<FHitboxHistory> history;
+	};
+
+	bool IsRecording() const;
+	FHitboxFrame CaptureFrame(const FTrackedCharacter& tracked, float time) const;
+	const FTrackedCharacter* FindTracked(const AActor* actor) const;
+
+	/** Clamps clientTime into the allowed rewind and fetches actor's frame there */
+	bool RewindCharacter(const FTrackedCharacter& tracked, float clientTime, FHitboxFrame& outFrame) const;
+	/** hitLocation touches target's rewound capsule, or its current bounds if target isn't a tracked character */
+	bool IsOnTarget(const AActor* target, float clientTime, const FVector& hitLocation) const;
+	bool Resolve(bool bConfirmed, const ACharacter* attacker, const AActor* target, const TCHAR* reason);
+
+	//Keyed by the character so a claim finds both histories without a search
+	TMap<const AActor*, FTrackedCharacter> trackedCharacters;
+	int32 confirmedCount = 0;
+	int32 rejectedCount = 0;
+};
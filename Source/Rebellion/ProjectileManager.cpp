@@ -0,0 +1,388 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileManager.h"
+#include "CombatAudioSubsystem.h"
+#include "CombatSpatialHash.h"
+#include "CombatSubsystem.h"
+#include "EnemyCrowdManager.h"
+#include "RangedCharacter.h"
+#include "RebellionCharacter.h"
+#include "RebellionStats.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "UObject/ConstructorHelpers.h"
+
+static TAutoConsoleVariable<int32> CVarProjectileWorldTraces(
+	TEXT("Rebellion.Projectiles.WorldTraces"),
+	1,
+	TEXT("Stop projectiles on world geometry with one async line trace per projectile per frame. 0 only hits targets."),
+	ECVF_Default);
+
+AProjectileManager::AProjectileManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	maxProjectiles = 16384;
+	projectileRadius = 8.f;
+	gravityScale = 0.f;
+	impactEffect = nullptr;
+	impactSound = nullptr;
+
+	numLive = 0;
+	nextSerial = 1;
+	numUploadedLive = 0;
+	lastIntegrateMs = 0.0;
+	lastCollideMs = 0.0;
+	lastInstanceUploadMs = 0.0;
+	lastWorldTraceCount = 0;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	projectileMeshes = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("ProjectileMeshes"));
+	projectileMeshes->SetupAttachment(RootComponent);
+	//Instance transforms are written in world space, pinning the component to the world origin makes them local too
+	projectileMeshes->SetUsingAbsoluteLocation(true);
+	projectileMeshes->SetUsingAbsoluteRotation(true);
+	projectileMeshes->SetUsingAbsoluteScale(true);
+	projectileMeshes->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	projectileMeshes->SetGenerateOverlapEvents(false);
+	projectileMeshes->SetCanEverAffectNavigation(false);
+	projectileMeshes->SetMobility(EComponentMobility::Movable);
+	projectileMeshes->SetCastShadow(false);
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> projectileMeshObject(TEXT("StaticMesh'/Engine/BasicShapes/Sphere.Sphere'"));
+	if (projectileMeshObject.Succeeded())
+	{
+		projectileMeshes->SetStaticMesh(projectileMeshObject.Object);
+	}
+}
+
+void AProjectileManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	Allocate();
+}
+
+void AProjectileManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT_BY(STAT_Rebellion_LiveProjectiles, numLive);
+	numLive = 0;
+	worldTraces.Reset();
+	combat = nullptr;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AProjectileManager::Allocate()
+{
+	//Sized once, firing never allocates
+	const int32 capacity = FMath::Max(maxProjectiles, 1);
+	for (TArray<float>* values : { &positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ, &velocityX, &velocityY, &velocityZ, &lifetimes, &damages })
+	{
+		values->SetNumZeroed(capacity);
+	}
+	owners.SetNum(capacity);
+	shotIds.SetNumZeroed(capacity);
+	serials.SetNumZeroed(capacity);
+	dead.SetNumZeroed(capacity);
+	worldTraces.Reserve(capacity);
+	queryScratch.Reserve(capacity);
+}
+
+bool AProjectileManager::Fire(AActor* owner, const FVector& origin, const FVector& velocity, float damage, float lifetime, uint16 shotId)
+{
+	if (numLive >= positionX.Num())
+	{
+		return false;
+	}
+
+	const int32 projectile = numLive++;
+	positionX[projectile] = previousX[projectile] = origin.X;
+	positionY[projectile] = previousY[projectile] = origin.Y;
+	positionZ[projectile] = previousZ[projectile] = origin.Z;
+	velocityX[projectile] = velocity.X;
+	velocityY[projectile] = velocity.Y;
+	velocityZ[projectile] = velocity.Z;
+	lifetimes[projectile] = lifetime;
+	damages[projectile] = damage;
+	owners[projectile] = owner;
+	shotIds[projectile] = shotId;
+	serials[projectile] = nextSerial++;
+	dead[projectile] = false;
+
+	INC_DWORD_STAT(STAT_Rebellion_LiveProjectiles);
+	return true;
+}
+
+void AProjectileManager::ClearProjectiles()
+{
+	DEC_DWORD_STAT_BY(STAT_Rebellion_LiveProjectiles, numLive);
+	numLive = 0;
+	worldTraces.Reset();
+	UploadInstanceTransforms();
+}
+
+void AProjectileManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	uint64 startCycles = FPlatformTime::Cycles64();
+	//Walls found by last frame's traces stop their projectiles before they move on
+	CollectWorldTraces();
+	Integrate(DeltaTime);
+	lastIntegrateMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+	startCycles = FPlatformTime::Cycles64();
+	CollideTargets();
+	CompactDead();
+	IssueWorldTraces();
+	lastCollideMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+	startCycles = FPlatformTime::Cycles64();
+	UploadInstanceTransforms();
+	lastInstanceUploadMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+}
+
+void AProjectileManager::CollectWorldTraces()
+{
+	UWorld* world = GetWorld();
+	FTraceDatum traceData;
+	for (const FWorldTrace& trace : worldTraces)
+	{
+		if (!world->QueryTraceData(trace.handle, traceData) || traceData.OutHits.Num() == 0)
+		{
+			continue;
+		}
+		if (trace.projectile < numLive && serials[trace.projectile] == trace.serial && !dead[trace.projectile])
+		{
+			Hit(trace.projectile, traceData.OutHits[0].ImpactPoint);
+		}
+	}
+	worldTraces.Reset();
+}
+
+void AProjectileManager::Integrate(float DeltaTime)
+{
+	REBELLION_SCOPE(ProjectileIntegrate);
+
+	const float gravityStep = GetWorld()->GetGravityZ() * gravityScale * DeltaTime;
+
+	float* RESTRICT x = positionX.GetData();
+	float* RESTRICT y = positionY.GetData();
+	float* RESTRICT z = positionZ.GetData();
+	float* RESTRICT lastX = previousX.GetData();
+	float* RESTRICT lastY = previousY.GetData();
+	float* RESTRICT lastZ = previousZ.GetData();
+	const float* RESTRICT vx = velocityX.GetData();
+	const float* RESTRICT vy = velocityY.GetData();
+	float* RESTRICT vz = velocityZ.GetData();
+	float* RESTRICT lifetime = lifetimes.GetData();
+
+	//No branches or calls so the compiler can vectorise it
+	for (int32 projectile = 0; projectile < numLive; projectile++)
+	{
+		lastX[projectile] = x[projectile];
+		lastY[projectile] = y[projectile];
+		lastZ[projectile] = z[projectile];
+		vz[projectile] += gravityStep;
+		x[projectile] += vx[projectile] * DeltaTime;
+		y[projectile] += vy[projectile] * DeltaTime;
+		z[projectile] += vz[projectile] * DeltaTime;
+		lifetime[projectile] -= DeltaTime;
+	}
+
+	for (int32 projectile = 0; projectile < numLive; projectile++)
+	{
+		dead[projectile] = dead[projectile] || lifetime[projectile] <= 0.f;
+	}
+}
+
+void AProjectileManager::CollideTargets()
+{
+	REBELLION_SCOPE(ProjectileCollide);
+
+	if (!combat || numLive == 0)
+	{
+		return;
+	}
+
+	//One segment query per projectile, answered together
+	queryScratch.SetNum(numLive, false);
+	for (int32 projectile = 0; projectile < numLive; projectile++)
+	{
+		FCombatSpatialQuery& query = queryScratch[projectile];
+		query.type = ECombatSpatialQueryType::SEGMENT;
+		query.origin = FVector(previousX[projectile], previousY[projectile], previousZ[projectile]);
+		query.direction = FVector(positionX[projectile], positionY[projectile], positionZ[projectile]);
+		query.radius = projectileRadius;
+	}
+
+	const FCombatSpatialHash& targetHash = combat->GetTargetHash();
+	candidateScratch.Reset();
+	targetHash.QueryBatch(queryScratch, candidateScratch, candidateOffsetScratch);
+
+	for (int32 projectile = 0; projectile < numLive; projectile++)
+	{
+		const int32 firstCandidate = candidateOffsetScratch[projectile];
+		const int32 lastCandidate = candidateOffsetScratch[projectile + 1];
+		if (dead[projectile] || firstCandidate == lastCandidate)
+		{
+			continue;
+		}
+
+		const FCombatSpatialQuery& query = queryScratch[projectile];
+		const AActor* owner = owners[projectile].Get();
+		for (int32 candidate = firstCandidate; candidate < lastCandidate; candidate++)
+		{
+			const FCombatTarget& target = targetHash.GetTarget(candidateScratch[candidate]);
+			AActor* targetActor = target.actor.Get();
+			if (!targetActor || targetActor == owner)
+			{
+				continue;
+			}
+
+			//The hash already tested the target's bounding sphere, crowd enemies get their capsule
+			const AEnemyCrowdManager* crowd = target.subIndex != INDEX_NONE ? Cast<AEnemyCrowdManager>(targetActor) : nullptr;
+			if (crowd && !crowd->IsEnemyInSweep(target.subIndex, query.origin, query.direction, projectileRadius))
+			{
+				continue;
+			}
+
+			const FVector direction = FVector(velocityX[projectile], velocityY[projectile], velocityZ[projectile]).GetSafeNormal();
+			const FVector hitLocation = FMath::ClosestPointOnSegment(target.position, query.origin, query.direction);
+			//Shooters decide whether the hit is theirs to apply or has to be claimed from the server
+			if (ARangedCharacter* shooter = Cast<ARangedCharacter>(owners[projectile].Get()))
+			{
+				shooter->HandleProjectileHit(shotIds[projectile], targetActor, target.subIndex, damages[projectile], hitLocation, direction);
+			}
+			else
+			{
+				combat->QueueHit(owners[projectile].Get(), targetActor, target.subIndex, EAttackType::RANGED, damages[projectile], hitLocation, direction);
+			}
+			Hit(projectile, hitLocation);
+			break;
+		}
+	}
+}
+
+void AProjectileManager::Hit(int32 projectile, const FVector& location)
+{
+	dead[projectile] = true;
+
+	if (impactEffect)
+	{
+		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), impactEffect, location, FRotator::ZeroRotator, FVector::OneVector, true, EPSCPoolMethod::AutoRelease);
+	}
+	UCombatAudioSubsystem* audio = impactSound ? GetWorld()->GetSubsystem<UCombatAudioSubsystem>() : nullptr;
+	if (audio)
+	{
+		audio->PlaySound(ECombatSound::IMPACT, impactSound, location);
+	}
+}
+
+void AProjectileManager::CompactDead()
+{
+	//Swap the last live projectile into each dead slot, order doesn't matter
+	int32 projectile = 0;
+	while (projectile < numLive)
+	{
+		if (!dead[projectile])
+		{
+			projectile++;
+			continue;
+		}
+
+		const int32 last = --numLive;
+		DEC_DWORD_STAT(STAT_Rebellion_LiveProjectiles);
+		if (projectile != last)
+		{
+			positionX[projectile] = positionX[last];
+			positionY[projectile] = positionY[last];
+			positionZ[projectile] = positionZ[last];
+			previousX[projectile] = previousX[last];
+			previousY[projectile] = previousY[last];
+			previousZ[projectile] = previousZ[last];
+			velocityX[projectile] = velocityX[last];
+			velocityY[projectile] = velocityY[last];
+			velocityZ[projectile] = velocityZ[last];
+			lifetimes[projectile] = lifetimes[last];
+			damages[projectile] = damages[last];
+			owners[projectile] = owners[last];
+			shotIds[projectile] = shotIds[last];
+			serials[projectile] = serials[last];
+			dead[projectile] = dead[last];
+		}
+		owners[last].Reset();
+		dead[last] = false;
+	}
+}
+
+void AProjectileManager::IssueWorldTraces()
+{
+	lastWorldTraceCount = 0;
+	if (numLive == 0 || CVarProjectileWorldTraces.GetValueOnGameThread() == 0)
+	{
+		return;
+	}
+
+	//Pawns and crowd enemies come from the target hash, only geometry is traced
+	FCollisionObjectQueryParams worldObjects;
+	worldObjects.AddObjectTypesToQuery(ECC_WorldStatic);
+	worldObjects.AddObjectTypesToQuery(ECC_WorldDynamic);
+	const FCollisionQueryParams traceParams(SCENE_QUERY_STAT(ProjectileWorldTrace), false);
+
+	UWorld* world = GetWorld();
+	for (int32 projectile = 0; projectile < numLive; projectile++)
+	{
+		FWorldTrace& trace = worldTraces.AddDefaulted_GetRef();
+		trace.projectile = projectile;
+		trace.serial = serials[projectile];
+		trace.handle = world->AsyncLineTraceByObjectType(EAsyncTraceType::Single,
+			FVector(previousX[projectile], previousY[projectile], previousZ[projectile]),
+			FVector(positionX[projectile], positionY[projectile], positionZ[projectile]),
+			worldObjects, traceParams);
+	}
+	lastWorldTraceCount = numLive;
+}
+
+void AProjectileManager::UploadInstanceTransforms()
+{
+	REBELLION_SCOPE(ProjectileInstanceUpload);
+
+	//Instances grow to the high water mark and are never removed, unused ones are scaled away
+	const FTransform hiddenTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+	for (int32 instance = projectileMeshes->GetInstanceCount(); instance < numLive; instance++)
+	{
+		projectileMeshes->AddInstance(hiddenTransform);
+	}
+
+	//Live projectiles and the ones that died since the last upload
+	const int32 numToUpload = FMath::Max(numLive, numUploadedLive);
+	if (numToUpload == 0)
+	{
+		return;
+	}
+	instanceTransforms.SetNum(numToUpload, false);
+
+	//The engine sphere is 100 units across
+	const FVector scale(projectileRadius / 50.f);
+	for (int32 projectile = 0; projectile < numLive; projectile++)
+	{
+		instanceTransforms[projectile] = FTransform(FQuat::Identity, FVector(positionX[projectile], positionY[projectile], positionZ[projectile]), scale);
+	}
+	for (int32 projectile = numLive; projectile < numToUpload; projectile++)
+	{
+		instanceTransforms[projectile] = hiddenTransform;
+	}
+
+	//One render state update for all of them
+	projectileMeshes->BatchUpdateInstancesTransforms(0, instanceTransforms, false, true, true);
+	numUploadedLive = numLive;
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WorldCollision.h"
+#include "ProjectileManager.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UParticleSystem;
+class USoundBase;
+class UCombatSubsystem;
+
+/**
+ * Every projectile in the world, without an actor each. Live projectiles are packed at the front of
+ * preallocated parallel arrays (one float array per axis) and integrated in one pass per frame.
+ * Pawns and crowd enemies are hit through UCombatSubsystem's target hash with one batched segment query,
+ * world geometry through one async line trace per projectile whose results land on the next frame.
+ * Hits are queued with the combat subsystem like weapon hits. Each projectile is one instance of projectileMeshes.
+ * Spawned on demand by UCombatSubsystem::GetProjectileManager.
+ */
+UCLASS()
+class REBELLION_API AProjectileManager : public AActor
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Projectiles, meta = (AllowPrivateAccess = "true"))
+		UInstancedStaticMeshComponent* projectileMeshes;
+
+public:
+	AProjectileManager();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaTime) override;
+
+	/** Pool size, Fire fails once this many are live */
+	UPROPERTY(EditAnywhere, Category = Projectiles)
+		int32 maxProjectiles;
+	/** Swept sphere radius against targets, world traces are lines */
+	UPROPERTY(EditAnywhere, Category = Projectiles)
+		float projectileRadius;
+	/** Multiplier on world gravity, 0 flies straight */
+	UPROPERTY(EditAnywhere, Category = Projectiles)
+		float gravityScale;
+	/** Optional, spawned from the engine's particle component pool where a projectile hits */
+	UPROPERTY(EditAnywhere, Category = Projectiles)
+		UParticleSystem* impactEffect;
+	/** Optional, played through UCombatAudioSubsystem where a projectile hits */
+	UPROPERTY(EditAnywhere, Category = Projectiles)
+		USoundBase* impactSound;
+
+	/** Fires one projectile, false if the pool is full. shotId is handed back to an ARangedCharacter owner with its hit */
+	bool Fire(AActor* owner, const FVector& origin, const FVector& velocity, float damage, float lifetime, uint16 shotId = 0);
+
+	/** Removes every projectile */
+	void ClearProjectiles();
+
+	int32 GetNumLive() const { return numLive; }
+
+	/** Cost of last frame's passes */
+	double GetLastIntegrateMs() const { return lastIntegrateMs; }
+	double GetLastCollideMs() const { return lastCollideMs; }
+	double GetLastInstanceUploadMs() const { return lastInstanceUploadMs; }
+	int32 GetLastWorldTraceCount() const { return lastWorldTraceCount; }
+
+private:
+
+	struct FWorldTrace
+	{
+		FTraceHandle handle;
+		//Projectile slot when the trace was issued, slots only move in CompactDead which runs before issuing
+		int32 projectile;
+		uint32 serial;
+	};
+
+	void Allocate();
+	void CollectWorldTraces();
+	void Integrate(float DeltaTime);
+	void CollideTargets();
+	void Hit(int32 projectile, const FVector& location);
+	void CompactDead();
+	void IssueWorldTraces();
+	void UploadInstanceTransforms();
+
+	//Structure of arrays, [0, numLive) are live
+	TArray<float> positionX;
+	TArray<float> positionY;
+	TArray<float> positionZ;
+	TArray<float> previousX;
+	TArray<float> previousY;
+	TArray<float> previousZ;
+	TArray<float> velocityX;
+	TArray<float> velocityY;
+	TArray<float> velocityZ;
+	TArray<float> lifetimes;
+	TArray<float> damages;
+	TArray<TWeakObjectPtr<AActor>> owners;
+	TArray<uint16> shotIds;
+	//Fire order, tells a trace result whether its slot still holds the same projectile
+	TArray<uint32> serials;
+	//Set by this frame's hits and expiry, cleared by CompactDead
+	TArray<bool> dead;
+	int32 numLive;
+	uint32 nextSerial;
+
+	TArray<FWorldTrace> worldTraces;
+	TArray<struct FCombatSpatialQuery> queryScratch;
+	TArray<int32> candidateScratch;
+	TArray<int32> candidateOffsetScratch;
+
+	TArray<FTransform> instanceTransforms;
+	int32 numUploadedLive;
+
+	double lastIntegrateMs;
+	double lastCollideMs;
+	double lastInstanceUploadMs;
+	int32 lastWorldTraceCount;
+
+	UPROPERTY(Transient)
+		UCombatSubsystem* combat;
+};
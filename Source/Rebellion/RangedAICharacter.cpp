@@ -0,0 +1,11 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RangedAICharacter.h"
+
+ARangedAICharacter::ARangedAICharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.DoNotCreateDefaultSubobject(ARangedCharacter::CameraBoomName)
+		.DoNotCreateDefaultSubobject(ARangedCharacter::FollowCameraName))
+{
+	AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RangedCharacter.h"
+#include "RangedAICharacter.generated.h"
+
+/**
+ * Ranged combatant for AI controllers, ARangedCharacter without the camera boom and follow camera.
+ * Shots aim along the controller's rotation instead of the camera, see ARangedCharacter::GetAimDirection.
+ */
+UCLASS()
+class REBELLION_API ARangedAICharacter : public ARangedCharacter
+{
+	GENERATED_BODY()
+
+public:
+
+	ARangedAICharacter(const FObjectInitializer& ObjectInitializer);
+};
@@ -1,17 +1,38 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 #include "RangedCharacter.h"
+#include "CombatSubsystem.h"
+#include "CombatReplaySubsystem.h"
+#include "LagCompensationSubsystem.h"
+#include "ProjectileManager.h"
+#include "RebellionCharacter.h"
+#include "RebellionCharacterMovementComponent.h"
+#include "RebellionSignificanceSubsystem.h"
+#include "RebellionLog.h"
+#include "RebellionStats.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "SkeletalMeshComponentBudgeted.h"
 #include "Components/InputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "TimerManager.h"
+#include "Net/UnrealNetwork.h"
 
+FName ARangedCharacter::CameraBoomName(TEXT("CameraBoom"));
+FName ARangedCharacter::FollowCameraName(TEXT("FollowCamera"));
+
+//Shots from the network older than this are fired from this far along instead
+static const float maxShotCatchUpSeconds = 0.5f;
+//Network time the server gives shot start ticks and claims on top of the tick rounding
+static const float shotTimeSlackSeconds = 0.1f;
 
 // Sets default values
-ARangedCharacter::ARangedCharacter()
+ARangedCharacter::ARangedCharacter(const FObjectInitializer& ObjectInitializer)
+	//Budgeted mesh so the animation budget allocator can time slice its evaluation
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<USkeletalMeshComponentBudgeted>(ACharacter::MeshComponentName)
+		.SetDefaultSubobjectClass<URebellionCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -32,15 +53,30 @@ ARangedCharacter::ARangedCharacter()
 	GetCharacterMovement()->AirControl = 0.2f;
 
 	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
-	CameraBoom->SetupAttachment(RootComponent);
-	CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
-	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+	//Optional, AI variants skip the boom and camera through DoNotCreateDefaultSubobject
+	CameraBoom = CreateOptionalDefaultSubobject<USpringArmComponent>(CameraBoomName);
+	if (CameraBoom)
+	{
+		CameraBoom->SetupAttachment(RootComponent);
+		CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
+		CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+	}
 
 	// Create a follow camera
-	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
-	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	FollowCamera = CreateOptionalDefaultSubobject<UCameraComponent>(FollowCameraName);
+	if (FollowCamera)
+	{
+		// Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
+		if (CameraBoom)
+		{
+			FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
+		}
+		else
+		{
+			FollowCamera->SetupAttachment(RootComponent);
+		}
+		FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	}
 
 	//MH Added
 	//Jumping variable adjuster
@@ -49,16 +85,79 @@ ARangedCharacter::ARangedCharacter()
 	walkSpeed = 600;
 	sprintSpeed = 900;
 	//Dashing adjusters
-	bCanDash = true;
 	dashDistance = 6000;
 	dashCooldown = 1;
 	dashStop = 0.1;
+	//Shot targeting
+	shotRange = 3000;
+	shotConeHalfAngle = 10;
+	projectileSpeed = 3000;
+	projectileDamage = 20;
+	projectileLifetime = 3;
+	fireInterval = 0.25;
 
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
 
 }
 
+//Called on game start or when spawned
+void ARangedCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	health = maxHealth;
+
+	//The old launch moved at dashDistance for dashStop seconds
+	URebellionCharacterMovementComponent* rebellionMovement = GetRebellionMovement();
+	rebellionMovement->MaxWalkSpeed = walkSpeed;
+	rebellionMovement->sprintSpeed = sprintSpeed;
+	rebellionMovement->ConfigureDash(dashDistance * dashStop, dashStop, dashCooldown);
+	rebellionMovement->bDashAlongControlRotation = true;
+
+	if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+	{
+		combat->RegisterPawn(this);
+	}
+	if (URebellionSignificanceSubsystem* significance = GetWorld()->GetSubsystem<URebellionSignificanceSubsystem>())
+	{
+		significance->RegisterCharacter(this);
+	}
+	if (ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		lagCompensation->RegisterCharacter(this);
+	}
+
+	INC_DWORD_STAT(STAT_Rebellion_Characters);
+}
+
+void ARangedCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT(STAT_Rebellion_Characters);
+
+	if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+	{
+		combat->UnregisterPawn(this);
+	}
+	if (URebellionSignificanceSubsystem* significance = GetWorld()->GetSubsystem<URebellionSignificanceSubsystem>())
+	{
+		significance->UnregisterCharacter(this);
+	}
+	if (ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		lagCompensation->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ARangedCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ARangedCharacter, health);
+}
+
 void ARangedCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent)
 {
 	// Set up gameplay key bindings
@@ -93,6 +192,12 @@ void ARangedCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerIn
 	PlayerInputComponent->BindAction("Sprint", IE_Pressed, this, &ARangedCharacter::Sprint);
 	PlayerInputComponent->BindAction("Sprint", IE_Released, this, &ARangedCharacter::Walk);
 	PlayerInputComponent->BindAction("Dash", IE_Pressed, this, &ARangedCharacter::Dash);
+
+	//Logged while a combat replay records
+	if (UCombatReplaySubsystem* replay = GetWorld()->GetSubsystem<UCombatReplaySubsystem>())
+	{
+		replay->WrapPlayerInput(this, PlayerInputComponent);
+	}
 }
 
 void ARangedCharacter::Landed(const FHitResult& hit)
@@ -113,13 +218,18 @@ void ARangedCharacter::DoubleJump()
 //MH Added *Change Sprinting speed
 void ARangedCharacter::Sprint()
 {
-	GetCharacterMovement()->MaxWalkSpeed = sprintSpeed;
+	GetRebellionMovement()->SetWantsToSprint(true);
 }
 
 //MH Added *Chane Walking speed
 void ARangedCharacter::Walk()
 {
-	GetCharacterMovement()->MaxWalkSpeed = walkSpeed;
+	GetRebellionMovement()->SetWantsToSprint(false);
+}
+
+URebellionCharacterMovementComponent* ARangedCharacter::GetRebellionMovement() const
+{
+	return CastChecked<URebellionCharacterMovementComponent>(GetCharacterMovement());
 }
 
 //MH added
@@ -132,43 +242,264 @@ void ARangedCharacter::Attack()
 	//deal damage
 
 	//disable attack box
-	UE_LOG(LogTemp, Warning, TEXT("Attack"));
+	REB_LOG(INFO, "Attack");
+
+	UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	AProjectileManager* projectiles = combat ? combat->GetProjectileManager() : nullptr;
+	const float networkTime = ULagCompensationSubsystem::GetNetworkTime(GetWorld());
+	if (!projectiles || IsDead() || networkTime - lastShotTime < fireInterval)
+	{
+		return;
+	}
+
+	//Shots lean towards the target nearest the aim line so they don't need pixel aim
+	FVector direction = GetAimDirection();
+	const FCombatTarget* target = FindShotTarget();
+	if (target)
+	{
+		REB_LOG(DEBUG, "Shot target %s %d", *GetNameSafe(target->actor.Get()), target->subIndex);
+		direction = (target->position - GetShotOrigin(*projectiles, direction)).GetSafeNormal(SMALL_NUMBER, direction);
+	}
+
+	const uint16 shotId = nextShotId++;
+	if (!FireShot(direction, 0.f, shotId))
+	{
+		return;
+	}
+	lastShotTime = networkTime;
+	if (GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	//Everyone else fires it from the tick it left at
+	FRebellionShotEvent shotEvent;
+	shotEvent.direction = direction;
+	shotEvent.startTick = FRebellionCombatState::ToNetTick(networkTime);
+	shotEvent.shotId = shotId;
+	if (HasAuthority())
+	{
+		MulticastFire(shotEvent);
+	}
+	else if (IsLocallyControlled())
+	{
+		ServerFire(shotEvent);
+	}
 }
 
-//MH Added *Removes friction and launches player based on dashDistance
-void ARangedCharacter::Dash()
+bool ARangedCharacter::FireShot(const FVector& direction, float elapsedSeconds, uint16 shotId)
 {
-	if (bCanDash == true)
+	UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	AProjectileManager* projectiles = combat ? combat->GetProjectileManager() : nullptr;
+	//Shots from the network that are over by the time they arrive aren't fired
+	if (!projectiles || elapsedSeconds >= projectileLifetime)
+	{
+		return false;
+	}
+
+	const FVector velocity = direction * projectileSpeed;
+	const FVector origin = GetShotOrigin(*projectiles, direction) + velocity * elapsedSeconds;
+	if (!projectiles->Fire(this, origin, velocity, projectileDamage, projectileLifetime - elapsedSeconds, shotId))
 	{
-		//Removes friction
-		GetCharacterMovement()->BrakingFrictionFactor = 0;
-		//launches character. Booleans set to true allow override of current velocities from XYZ
-		//GetSafeNormal sets the X and Y value to 1 so dashDistance can be consistent
-		LaunchCharacter(FVector(FollowCamera->GetForwardVector().X, FollowCamera->GetForwardVector().Y, 0).GetSafeNormal() * dashDistance, true, true);
-		bCanDash = false;
-		//This timer means we wait timer seconds and stop dashing. Boolean sets looping timer to false
-		GetWorldTimerManager().SetTimer(dashTimer, this, &ARangedCharacter::StopDash, dashStop, false);
+		REB_LOG(WARNING, "Projectile pool full, shot dropped");
+		return false;
 	}
+	return true;
+}
+
+FVector ARangedCharacter::GetShotOrigin(const AProjectileManager& projectiles, const FVector& direction) const
+{
+	//Leave the capsule first so the shot can't start inside whatever the character is touching
+	return GetActorLocation() + direction * (GetCapsuleComponent()->GetScaledCapsuleRadius() + projectiles.projectileRadius);
 }
 
-//MH Added *Stops dash movement, resets dash, resets player friction
-void ARangedCharacter::StopDash()
+bool ARangedCharacter::ServerFire_Validate(FRebellionShotEvent shotEvent)
 {
-	GetCharacterMovement()->StopMovementImmediately();
-	GetWorldTimerManager().SetTimer(dashTimer, this, &ARangedCharacter::ResetDash, dashCooldown, false);
-	//Resets friction back to default value
-	GetCharacterMovement()->BrakingFrictionFactor = 2;
+	return !shotEvent.direction.ContainsNaN() && !shotEvent.direction.IsNearlyZero();
 }
-//MH Added *Resets canDash to allow player to dash again
-void ARangedCharacter::ResetDash()
+
+void ARangedCharacter::ServerFire_Implementation(FRebellionShotEvent shotEvent)
 {
-	bCanDash = true;
+	const float networkTime = ULagCompensationSubsystem::GetNetworkTime(GetWorld());
+	const float sinceFired = FRebellionCombatState::GetTickSeconds(shotEvent.startTick, FRebellionCombatState::ToNetTick(networkTime));
+	const float fireTime = networkTime - sinceFired;
+
+	//Shots from the future or faster than fireInterval are dropped, a tick of slack for the start tick's rounding.
+	//Fire times only move forward and never past now, so a client can't fire faster by back dating its shots
+	if (IsDead() || sinceFired < -shotTimeSlackSeconds || fireTime - lastShotTime < fireInterval - 1.f / FRebellionCombatState::TicksPerSecond)
+	{
+		REB_LOG(DEBUG, "%s shot %d rejected", *GetName(), shotEvent.shotId);
+		return;
+	}
+	lastShotTime = fireTime;
+
+	//Shots past their lifetime can't be claimed any more
+	const int32 expiredShots = serverShots.IndexOfByPredicate([this, networkTime](const FServerShot& shot) { return shot.fireTime + projectileLifetime + shotTimeSlackSeconds >= networkTime; });
+	serverShots.RemoveAt(0, expiredShots == INDEX_NONE ? serverShots.Num() : expiredShots, false);
+	FServerShot& shot = serverShots.AddDefaulted_GetRef();
+	shot.shotId = shotEvent.shotId;
+	shot.fireTime = fireTime;
+	shot.bClaimed = false;
+
+	//Fire from where the client's shot is by now, the server's copy is for show, its hits come as claims
+	FireShot(shotEvent.direction, FMath::Clamp(sinceFired, 0.f, maxShotCatchUpSeconds), shotEvent.shotId);
+	MulticastFire(shotEvent);
+}
+
+void ARangedCharacter::MulticastFire_Implementation(FRebellionShotEvent shotEvent)
+{
+	//The server and the shooter fired it themselves
+	if (HasAuthority() || IsLocallyControlled() || IsDead())
+	{
+		return;
+	}
+
+	const uint16 nowTick = FRebellionCombatState::ToNetTick(ULagCompensationSubsystem::GetNetworkTime(GetWorld()));
+	FireShot(shotEvent.direction, FMath::Clamp(FRebellionCombatState::GetTickSeconds(shotEvent.startTick, nowTick), 0.f, maxShotCatchUpSeconds), shotEvent.shotId);
+}
+
+bool ARangedCharacter::OwnsShotHits() const
+{
+	//AI and unpossessed shooters fire on the server
+	return IsLocallyControlled() || (HasAuthority() && !IsPlayerControlled());
+}
+
+void ARangedCharacter::HandleProjectileHit(uint16 shotId, AActor* target, int32 targetSubIndex, float damage, const FVector& hitLocation, const FVector& hitDirection)
+{
+	if (!OwnsShotHits())
+	{
+		return;
+	}
+
+	//Crowd enemies are simulated on every machine, only pawn hits go through the server
+	if (HasAuthority() || targetSubIndex != INDEX_NONE)
+	{
+		if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+		{
+			combat->QueueHit(this, target, targetSubIndex, EAttackType::RANGED, damage, hitLocation, hitDirection);
+		}
+	}
+	else
+	{
+		ServerClaimShotHit(shotId, target, hitLocation, hitDirection.GetSafeNormal(), ULagCompensationSubsystem::GetNetworkTime(GetWorld()));
+	}
+}
+
+bool ARangedCharacter::ServerClaimShotHit_Validate(uint16 shotId, AActor* target, FVector_NetQuantize hitLocation, FVector_NetQuantizeNormal hitDirection, float clientTime)
+{
+	return FMath::IsFinite(clientTime);
+}
+
+void ARangedCharacter::ServerClaimShotHit_Implementation(uint16 shotId, AActor* target, FVector_NetQuantize hitLocation, FVector_NetQuantizeNormal hitDirection, float clientTime)
+{
+	//Each accepted shot hits once, while it is in flight
+	FServerShot* shot = serverShots.FindByPredicate([shotId](const FServerShot& recorded) { return recorded.shotId == shotId; });
+	const float flightSeconds = shot ? clientTime - shot->fireTime : 0.f;
+	if (!shot || shot->bClaimed || flightSeconds < -shotTimeSlackSeconds || flightSeconds > projectileLifetime + shotTimeSlackSeconds)
+	{
+		REB_LOG(DEBUG, "%s claim on shot %d rejected", *GetName(), shotId);
+		return;
+	}
+	shot->bClaimed = true;
+
+	ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	if (!target || IsDead() || !lagCompensation || !combat || !lagCompensation->ConfirmShotHit(this, target, clientTime, hitLocation, projectileSpeed * projectileLifetime))
+	{
+		return;
+	}
+
+	//Damage comes from the server's own tuning, never from the claim
+	combat->QueueHit(this, target, INDEX_NONE, EAttackType::RANGED, projectileDamage, hitLocation, hitDirection);
+}
+
+FVector ARangedCharacter::GetAimDirection() const
+{
+	//Base aim rotation is the controller's, so an AI controller's focus aims the same way the camera does
+	return FollowCamera ? FollowCamera->GetForwardVector() : GetBaseAimRotation().Vector();
+}
+
+const FCombatTarget* ARangedCharacter::FindShotTarget() const
+{
+	UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	if (!combat)
+	{
+		return nullptr;
+	}
+
+	//Aim along the camera but measure from the character, the camera sits behind it
+	const FVector origin = GetActorLocation();
+	const FVector direction = GetAimDirection();
+	const FCombatSpatialHash& targetHash = combat->GetTargetHash();
+
+	TArray<int32> candidateIds;
+	targetHash.QueryCone(origin, direction, shotRange, FMath::Cos(FMath::DegreesToRadians(shotConeHalfAngle)), candidateIds);
+
+	//Closest candidate to the aim line wins
+	const FCombatTarget* bestTarget = nullptr;
+	float bestDistance = MAX_flt;
+	for (int32 targetId : candidateIds)
+	{
+		const FCombatTarget& target = targetHash.GetTarget(targetId);
+		//Destroyed targets stay in the hash until their owner unregisters them
+		if (!target.actor.IsValid() || target.actor == this)
+		{
+			continue;
+		}
+
+		const float distance = FMath::PointDistToLine(target.position, direction, origin);
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			bestTarget = &target;
+		}
+	}
+	return bestTarget;
+}
+
+float ARangedCharacter::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	if (IsDead())
+	{
+		return 0.f;
+	}
+
+	const float damage = Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	//An idle character may be dormant, flush so the new health still reaches every connection
+	FlushNetDormancy();
+	const float previousHealth = health;
+	health = FMath::Max(health - damage, 0.f);
+	OnHealthChanged(previousHealth);
+	return damage;
+}
+
+void ARangedCharacter::OnRep_Health(float previousHealth)
+{
+	OnHealthChanged(previousHealth);
+}
+
+void ARangedCharacter::OnHealthChanged(float previousHealth)
+{
+	if (IsDead() && previousHealth > 0.f)
+	{
+		REB_LOG(INFO, "%s died", *GetName());
+		GetCharacterMovement()->DisableMovement();
+	}
+}
+
+//MH Added *Dashes along the camera, the movement component runs it and its cooldown
+void ARangedCharacter::Dash()
+{
+	REBELLION_SCOPE(Dash);
+	INC_DWORD_STAT(STAT_Rebellion_DashCalls);
+
+	GetRebellionMovement()->RequestDash();
 }
 
 //MH added method for blocking
 void ARangedCharacter::Block()
 {
-	UE_LOG(LogTemp, Warning, TEXT("Block"));
+	REB_LOG(INFO, "Block");
 }
 
 void ARangedCharacter::OnResetVR()
@@ -200,6 +531,9 @@ void ARangedCharacter::LookUpAtRate(float Rate)
 
 void ARangedCharacter::MoveForward(float Value)
 {
+	REBELLION_SCOPE(MoveForward);
+	INC_DWORD_STAT(STAT_Rebellion_MoveCalls);
+
 	if ((Controller != NULL) && (Value != 0.0f))
 	{
 		// find out which way is forward
@@ -214,6 +548,9 @@ void ARangedCharacter::MoveForward(float Value)
 
 void ARangedCharacter::MoveRight(float Value)
 {
+	REBELLION_SCOPE(MoveRight);
+	INC_DWORD_STAT(STAT_Rebellion_MoveCalls);
+
 	if ((Controller != NULL) && (Value != 0.0f))
 	{
 		// find out which way is right
@@ -4,13 +4,21 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Engine/NetSerialization.h"
+#include "RebellionCombatState.h"
 #include "RangedCharacter.generated.h"
 
+struct FCombatTarget;
+class AProjectileManager;
+
 UCLASS()
 class REBELLION_API ARangedCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	//Bots and replays drive SetupPlayerInputComponent bindings directly
+	friend struct FScriptedInput;
+
 		/** Camera boom positioning the camera behind the character */
 		UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 		class USpringArmComponent* CameraBoom;
@@ -19,7 +27,18 @@ class REBELLION_API ARangedCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 		class UCameraComponent* FollowCamera;
 public:
-	ARangedCharacter();
+	ARangedCharacter(const FObjectInitializer& ObjectInitializer);
+
+	/** Names of the player only subobjects, subclasses pass them to DoNotCreateDefaultSubobject */
+	static FName CameraBoomName;
+	static FName FollowCameraName;
+
+	//Called on game start or when spawned
+	virtual void BeginPlay() override;
+
+	//Called when destroyed or the level is unloaded
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
@@ -69,9 +88,9 @@ protected:
 	virtual void Landed(const FHitResult& hit) override;
 
 public:
-	/** Returns CameraBoom subobject **/
+	/** Returns CameraBoom subobject, null on AI variants **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
-	/** Returns FollowCamera subobject **/
+	/** Returns FollowCamera subobject, null on AI variants **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
 	//MH added
@@ -97,25 +116,90 @@ public:
 	//Attack
 	UFUNCTION()
 		void Attack();
+	//Target nearest the aim line inside the shot cone, from UCombatSubsystem's target hash
+	const FCombatTarget* FindShotTarget() const;
+	//Along the follow camera, or the controller's aim on variants without one
+	FVector GetAimDirection() const;
+	UPROPERTY(EditAnywhere)
+		float shotRange;
+	UPROPERTY(EditAnywhere)
+		float shotConeHalfAngle;
+	//Shots are projectiles in the world's AProjectileManager
+	UPROPERTY(EditAnywhere, Category = Combat)
+		float projectileSpeed;
+	UPROPERTY(EditAnywhere, Category = Combat)
+		float projectileDamage;
+	UPROPERTY(EditAnywhere, Category = Combat)
+		float projectileLifetime;
+	//Seconds between shots, the server drops shots that come faster
+	UPROPERTY(EditAnywhere, Category = Combat)
+		float fireInterval;
+	//Called by AProjectileManager when one of our projectiles hits, queues the hit or claims it from the server. Ignored on machines that didn't fire it
+	void HandleProjectileHit(uint16 shotId, AActor* target, int32 targetSubIndex, float damage, const FVector& hitLocation, const FVector& hitDirection);
+	//Health, reduced by the combat subsystem's damage pass through TakeDamage. Only the server applies damage
+	UPROPERTY(EditAnywhere, Category = Combat)
+		float maxHealth = 100.f;
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, ReplicatedUsing = OnRep_Health, Category = Combat)
+		float health;
+	UFUNCTION()
+		void OnRep_Health(float previousHealth);
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser) override;
+	UFUNCTION(BlueprintCallable, Category = Combat)
+		bool IsDead() const { return health <= 0.f; }
 	//Dash
 	UFUNCTION()
 		void Dash();
-	UFUNCTION()
-		void StopDash();
-	UFUNCTION()
-		void ResetDash();
+	//Dash speed, held for dashStop seconds
 	UPROPERTY(EditAnywhere)
 		float dashDistance;
 	UPROPERTY(EditAnywhere)
 		float dashCooldown;
-	UPROPERTY()
-		bool bCanDash;
 	UPROPERTY(EditAnywhere)
 		float dashStop;
 
-	//Timer
-	UPROPERTY()
-		FTimerHandle dashTimer;
+	/** Sprint and dash are simulated by the movement component so they are predicted */
+	class URebellionCharacterMovementComponent* GetRebellionMovement() const;
+
+protected:
+
+	/** Shot the owning client fired, fired on the server from its start time and passed on to the simulated proxies */
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerFire(FRebellionShotEvent shotEvent);
+	/** Shot fired on the server, simulated proxies fire it from its start time */
+	UFUNCTION(NetMulticast, Reliable)
+		void MulticastFire(FRebellionShotEvent shotEvent);
+	//Fires a projectile along direction as if it left elapsedSeconds ago, for local presses and shots from the network. False if nothing fired
+	bool FireShot(const FVector& direction, float elapsedSeconds, uint16 shotId);
+	//Where a shot along direction leaves the capsule
+	FVector GetShotOrigin(const AProjectileManager& projectiles, const FVector& direction) const;
+	//Only the machine that fired applies or claims a projectile's hits, the other copies are for show
+	bool OwnsShotHits() const;
+
+	//Network time of the last shot fired, on the server the last one it accepted from the owning client
+	float lastShotTime = -MAX_flt;
+	//Owning client's count of its shots, sent with each shot and its hit claim
+	uint16 nextShotId = 0;
+
+	/** A shot the server accepted from the owning client, what its hit claim is checked against */
+	struct FServerShot
+	{
+		uint16 shotId;
+		//Network time the shot left at
+		float fireTime;
+		bool bClaimed;
+	};
+	//Server only, shots that may still be in flight, oldest first
+	TArray<FServerShot> serverShots;
+
+	/**
+	 * A remote player's projectile hit on shotId. Has to name a shot the server accepted that hasn't hit yet and
+	 * fall inside its flight time, then is confirmed by rewinding both characters to clientTime before it is queued
+	 */
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerClaimShotHit(uint16 shotId, AActor* target, FVector_NetQuantize hitLocation, FVector_NetQuantizeNormal hitDirection, float clientTime);
+
+	//Death for a health change, on the server from TakeDamage and on clients from replication
+	void OnHealthChanged(float previousHealth);
 
 };
 
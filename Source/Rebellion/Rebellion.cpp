@@ -3,5 +3,7 @@
 #include "Rebellion.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogRebellion);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Rebellion, "Rebellion" );
  
\ No newline at end of file
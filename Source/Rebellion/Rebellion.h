@@ -3,3 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogRebellion, Log, All);
+
+//"Weapon" object channel from DefaultEngine.ini, pawns overlap it
+#define ECC_Weapon ECC_GameTraceChannel1
@@ -0,0 +1,11 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionAICharacter.h"
+
+ARebellionAICharacter::ARebellionAICharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.DoNotCreateDefaultSubobject(ARebellionCharacter::CameraBoomName)
+		.DoNotCreateDefaultSubobject(ARebellionCharacter::FollowCameraName))
+{
+	AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
+}
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RebellionCharacter.h"
+#include "RebellionAICharacter.generated.h"
+
+/**
+ * Melee combatant for AI controllers. Same combat as ARebellionCharacter, which stays the player's pawn,
+ * without the camera boom and follow camera nobody looks through. The boom also ticks a collision probe
+ * every frame. Spawned and placed instances get an AI controller.
+ * Rebellion.Bench.CharacterFootprint compares the memory, components and spawn time of every variant.
+ */
+UCLASS()
+class REBELLION_API ARebellionAICharacter : public ARebellionCharacter
+{
+	GENERATED_BODY()
+
+public:
+
+	ARebellionAICharacter(const FObjectInitializer& ObjectInitializer);
+};
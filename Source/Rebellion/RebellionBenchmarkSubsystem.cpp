@@ -0,0 +1,452 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionBenchmarkSubsystem.h"
+#include "Rebellion.h"
+#include "RebellionCharacter.h"
+#include "RebellionGameMode.h"
+#include "RangedCharacter.h"
+#include "RebellionSignificanceSubsystem.h"
+#include "CombatSubsystem.h"
+#include "CombatAudioSubsystem.h"
+#include "ScriptedInput.h"
+#include "CoreGlobals.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+//Blueprint with the ranged mesh and anim blueprint, falls back to the native class
+static const TCHAR* rangedBotClassPath = TEXT("/Game/ThirdPersonCPP/Blueprints/RangedCharacter.RangedCharacter_C");
+
+void FBenchmarkPhysicsTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (benchmark)
+	{
+		benchmark->OnPhysicsTickBoundary(bIsStart);
+	}
+}
+
+void URebellionBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* world = GetWorld();
+	if (!world || !world->IsGameWorld())
+	{
+		return;
+	}
+
+	FRebellionBenchmarkSettings commandLineSettings;
+	if (FParse::Value(FCommandLine::Get(), TEXT("RebellionBenchmark="), commandLineSettings.botCount))
+	{
+		FParse::Value(FCommandLine::Get(), TEXT("BenchmarkFrames="), commandLineSettings.frames);
+		FParse::Value(FCommandLine::Get(), TEXT("BenchmarkWarmup="), commandLineSettings.warmupFrames);
+		FParse::Value(FCommandLine::Get(), TEXT("BenchmarkRangedEvery="), commandLineSettings.rangedEvery);
+		FParse::Value(FCommandLine::Get(), TEXT("BenchmarkOutput="), commandLineSettings.outputPath);
+		commandLineSettings.bExitWhenDone = FParse::Param(FCommandLine::Get(), TEXT("BenchmarkExit"));
+		StartBenchmark(commandLineSettings);
+	}
+}
+
+void URebellionBenchmarkSubsystem::Deinitialize()
+{
+	UnregisterPhysicsTicks();
+	bRunning = false;
+	bPending = false;
+
+	Super::Deinitialize();
+}
+
+TStatId URebellionBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URebellionBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType URebellionBenchmarkSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+void URebellionBenchmarkSubsystem::StartBenchmark(const FRebellionBenchmarkSettings& inSettings)
+{
+	if (bRunning || bPending)
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("Benchmark already running"));
+		return;
+	}
+
+	settings = inSettings;
+	settings.botCount = FMath::Max(settings.botCount, 1);
+	settings.frames = FMath::Max(settings.frames, 1);
+	settings.warmupFrames = FMath::Max(settings.warmupFrames, 0);
+	bPending = true;
+}
+
+void URebellionBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	UWorld* world = GetWorld();
+
+	//Bots use the game mode's pawn class, which is only set once the combat preload is done
+	const ARebellionGameMode* rebellionGameMode = Cast<ARebellionGameMode>(world->GetAuthGameMode());
+	const bool bPreloadComplete = !rebellionGameMode || rebellionGameMode->IsCombatPreloadComplete();
+	if (bPending && world->HasBegunPlay() && bPreloadComplete)
+	{
+		bPending = false;
+		bRunning = true;
+		frame = 0;
+		samples = FFrameSamples();
+		startUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+		peakUsedPhysical = startUsedPhysical;
+
+		SpawnBots();
+		RegisterPhysicsTicks();
+		worldTickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &URebellionBenchmarkSubsystem::OnWorldTickStart);
+		return;
+	}
+
+	if (!bRunning)
+	{
+		return;
+	}
+
+	if (frame == settings.warmupFrames)
+	{
+		//Latency percentiles in the report cover the measured frames only
+		if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+		{
+			combat->ResetInputLatency();
+		}
+	}
+	if (frame >= settings.warmupFrames)
+	{
+		RecordFrame(DeltaTime);
+	}
+
+	if (++frame >= settings.warmupFrames + settings.frames)
+	{
+		Finish();
+		return;
+	}
+
+	//Input given now is consumed by the bots on the next frame
+	DriveBots();
+}
+
+void URebellionBenchmarkSubsystem::SpawnBots()
+{
+	UWorld* world = GetWorld();
+	const double startSeconds = FPlatformTime::Seconds();
+
+	//The game mode's pawn is the blueprint with the mesh and anim blueprint, so montages and notifies run
+	TSubclassOf<APawn> meleeClass = ARebellionCharacter::StaticClass();
+	AGameModeBase* gameMode = world->GetAuthGameMode();
+	if (gameMode && gameMode->DefaultPawnClass && gameMode->DefaultPawnClass->IsChildOf(ARebellionCharacter::StaticClass()))
+	{
+		meleeClass = gameMode->DefaultPawnClass;
+	}
+	TSubclassOf<APawn> rangedClass = LoadClass<ARangedCharacter>(nullptr, rangedBotClassPath);
+	if (!rangedClass)
+	{
+		rangedClass = ARangedCharacter::StaticClass();
+	}
+
+	FVector origin = FVector(0.f, 0.f, 200.f);
+	for (TActorIterator<APlayerStart> it(world); it; ++it)
+	{
+		origin = it->GetActorLocation();
+		break;
+	}
+
+	const int32 gridSize = FMath::CeilToInt(FMath::Sqrt((float)settings.botCount));
+	const float spacing = 150.f;
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	bots.Reset(settings.botCount);
+	botInputComponents.Reset(settings.botCount);
+	for (int32 index = 0; index < settings.botCount; index++)
+	{
+		const bool bRanged = settings.rangedEvery > 0 && index % settings.rangedEvery == settings.rangedEvery - 1;
+		const FVector location = origin + FVector((index % gridSize - gridSize / 2) * spacing, (index / gridSize - gridSize / 2) * spacing, 0.f);
+
+		APawn* pawn = world->SpawnActor<APawn>(bRanged ? rangedClass : meleeClass, location, FRotator::ZeroRotator, spawnParams);
+		if (!pawn)
+		{
+			continue;
+		}
+		//Movement handlers need a controller to read the control rotation from
+		pawn->SpawnDefaultController();
+
+		FBot& bot = bots.AddDefaulted_GetRef();
+		bot.pawn = pawn;
+		bot.bRanged = bRanged;
+		bot.input = bRanged ? FScriptedInput::Bind(CastChecked<ARangedCharacter>(pawn)) : FScriptedInput::Bind(CastChecked<ARebellionCharacter>(pawn));
+		botInputComponents.Add(bot.input);
+	}
+
+	spawnSeconds = FPlatformTime::Seconds() - startSeconds;
+	UE_LOG(LogRebellion, Display, TEXT("Benchmark spawned %d bots in %.2f ms"), bots.Num(), spawnSeconds * 1000.0);
+}
+
+void URebellionBenchmarkSubsystem::DriveBots()
+{
+	static const FName moveForwardName(TEXT("MoveForward"));
+	static const FName moveRightName(TEXT("MoveRight"));
+	static const FName primaryAttackName(TEXT("PrimaryAttack"));
+	static const FName secondaryAttackName(TEXT("SecondaryAttack"));
+	static const FName rangedAttackName(TEXT("Attack"));
+	static const FName sprintName(TEXT("Sprint"));
+	static const FName dashName(TEXT("Dash"));
+	static const FName jumpName(TEXT("Jump"));
+
+	for (int32 index = 0; index < bots.Num(); index++)
+	{
+		const FBot& bot = bots[index];
+		if (!bot.pawn.IsValid())
+		{
+			continue;
+		}
+
+		//Every bot runs the same 4 second script, offset so they don't all attack on the same frame
+		const int32 time = frame + index * 7;
+		FScriptedInput::Axis(bot.input, moveForwardName, FMath::Sin(time * 0.02f));
+		FScriptedInput::Axis(bot.input, moveRightName, FMath::Cos(time * 0.013f));
+
+		switch (time % 240)
+		{
+		case 0:
+		case 40:
+			FScriptedInput::Action(bot.input, bot.bRanged ? rangedAttackName : primaryAttackName, IE_Pressed);
+			break;
+		case 80:
+			FScriptedInput::Action(bot.input, bot.bRanged ? rangedAttackName : secondaryAttackName, IE_Pressed);
+			break;
+		case 120:
+			FScriptedInput::Action(bot.input, sprintName, IE_Pressed);
+			break;
+		case 180:
+			FScriptedInput::Action(bot.input, sprintName, IE_Released);
+			break;
+		case 200:
+			FScriptedInput::Action(bot.input, dashName, IE_Pressed);
+			break;
+		case 220:
+			FScriptedInput::Action(bot.input, jumpName, IE_Pressed);
+			break;
+		case 225:
+			FScriptedInput::Action(bot.input, jumpName, IE_Released);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void URebellionBenchmarkSubsystem::OnWorldTickStart(UWorld* world, ELevelTick tickType, float deltaSeconds)
+{
+	if (world == GetWorld())
+	{
+		worldTickStartCycles = FPlatformTime::Cycles64();
+		physicsStartCycles = 0;
+		physicsEndCycles = 0;
+	}
+}
+
+void URebellionBenchmarkSubsystem::OnPhysicsTickBoundary(bool bIsStart)
+{
+	(bIsStart ? physicsStartCycles : physicsEndCycles) = FPlatformTime::Cycles64();
+}
+
+void URebellionBenchmarkSubsystem::RecordFrame(float DeltaTime)
+{
+	const uint64 nowCycles = FPlatformTime::Cycles64();
+
+	samples.frameMs.Add(FApp::GetDeltaTime() * 1000.f);
+	samples.gameThreadMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+	if (worldTickStartCycles != 0)
+	{
+		samples.worldTickMs.Add(FPlatformTime::ToMilliseconds64(nowCycles - worldTickStartCycles));
+	}
+	if (physicsStartCycles != 0 && physicsEndCycles > physicsStartCycles)
+	{
+		samples.physicsMs.Add(FPlatformTime::ToMilliseconds64(physicsEndCycles - physicsStartCycles));
+	}
+
+	peakUsedPhysical = FMath::Max<uint64>(peakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+}
+
+void URebellionBenchmarkSubsystem::Finish()
+{
+	bRunning = false;
+	UnregisterPhysicsTicks();
+	FWorldDelegates::OnWorldTickStart.Remove(worldTickStartHandle);
+
+	WriteReport();
+
+	if (settings.bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+TSharedRef<FJsonObject> URebellionBenchmarkSubsystem::MakePercentiles(TArray<float> values)
+{
+	TSharedRef<FJsonObject> json = MakeShared<FJsonObject>();
+	if (values.Num() == 0)
+	{
+		return json;
+	}
+
+	values.Sort();
+	auto percentile = [&values](float fraction)
+	{
+		return values[FMath::Clamp(FMath::RoundToInt(fraction * (values.Num() - 1)), 0, values.Num() - 1)];
+	};
+
+	double sum = 0.0;
+	for (float value : values)
+	{
+		sum += value;
+	}
+
+	json->SetNumberField(TEXT("p50"), percentile(0.50f));
+	json->SetNumberField(TEXT("p95"), percentile(0.95f));
+	json->SetNumberField(TEXT("p99"), percentile(0.99f));
+	json->SetNumberField(TEXT("mean"), sum / values.Num());
+	json->SetNumberField(TEXT("max"), values.Last());
+	return json;
+}
+
+bool URebellionBenchmarkSubsystem::SaveReport(const TSharedRef<FJsonObject>& report, const FString& name, bool bLogJson, const FString& outputPath)
+{
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	FJsonSerializer::Serialize(report, writer);
+
+	const FString path = !outputPath.IsEmpty() ? outputPath
+		: FPaths::ProfilingDir() / TEXT("Rebellion") / FString::Printf(TEXT("%s_%s.json"), *name, *FDateTime::Now().ToString());
+	const bool bSaved = FFileHelper::SaveStringToFile(json, *path);
+	if (bSaved)
+	{
+		UE_LOG(LogRebellion, Display, TEXT("%s report written to %s"), *name, *FPaths::ConvertRelativePathToFull(path));
+	}
+	else
+	{
+		UE_LOG(LogRebellion, Error, TEXT("Could not write %s report to %s"), *name, *path);
+	}
+	if (bLogJson)
+	{
+		UE_LOG(LogRebellion, Display, TEXT("%s"), *json);
+	}
+	return bSaved;
+}
+
+void URebellionBenchmarkSubsystem::WriteReport() const
+{
+	const double bytesToMB = 1.0 / (1024.0 * 1024.0);
+	const uint64 endUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+
+	int32 rangedBots = 0;
+	for (const FBot& bot : bots)
+	{
+		rangedBots += bot.bRanged ? 1 : 0;
+	}
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	report->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+	report->SetNumberField(TEXT("bots"), bots.Num());
+	report->SetNumberField(TEXT("meleeBots"), bots.Num() - rangedBots);
+	report->SetNumberField(TEXT("rangedBots"), rangedBots);
+	report->SetNumberField(TEXT("warmupFrames"), settings.warmupFrames);
+	report->SetNumberField(TEXT("frames"), settings.frames);
+	report->SetNumberField(TEXT("spawnMs"), spawnSeconds * 1000.0);
+	//Compare runs with -ExecCmds="Rebellion.Significance.Enabled 0"
+	report->SetBoolField(TEXT("significance"), URebellionSignificanceSubsystem::IsEnabled());
+	if (const URebellionSignificanceSubsystem* significance = GetWorld()->GetSubsystem<URebellionSignificanceSubsystem>())
+	{
+		TSharedRef<FJsonObject> buckets = MakeShared<FJsonObject>();
+		const UEnum* bucketEnum = StaticEnum<ESignificanceBucket>();
+		for (int32 bucket = 0; bucket < (int32)ESignificanceBucket::COUNT; bucket++)
+		{
+			buckets->SetNumberField(bucketEnum->GetNameStringByIndex(bucket), significance->GetBucketCounts()[bucket]);
+		}
+		report->SetObjectField(TEXT("significanceBuckets"), buckets);
+	}
+	report->SetObjectField(TEXT("frameMs"), MakePercentiles(samples.frameMs));
+	report->SetObjectField(TEXT("gameThreadMs"), MakePercentiles(samples.gameThreadMs));
+	report->SetObjectField(TEXT("worldTickMs"), MakePercentiles(samples.worldTickMs));
+	report->SetObjectField(TEXT("physicsMs"), MakePercentiles(samples.physicsMs));
+	if (const UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+	{
+		report->SetObjectField(TEXT("inputToMontageMs"), MakePercentiles(combat->GetInputLatencySamples(ECombatInputLatency::INPUT_TO_MONTAGE)));
+		report->SetObjectField(TEXT("inputToFirstHitMs"), MakePercentiles(combat->GetInputLatencySamples(ECombatInputLatency::INPUT_TO_FIRST_HIT)));
+	}
+
+	if (const UCombatAudioSubsystem* audio = GetWorld()->GetSubsystem<UCombatAudioSubsystem>())
+	{
+		TSharedRef<FJsonObject> combatAudio = MakeShared<FJsonObject>();
+		combatAudio->SetNumberField(TEXT("pooledComponents"), audio->GetPoolSize());
+		combatAudio->SetNumberField(TEXT("played"), audio->GetPlayedCount());
+		combatAudio->SetNumberField(TEXT("culled"), audio->GetCulledCount());
+		report->SetObjectField(TEXT("combatAudio"), combatAudio);
+	}
+
+	TSharedRef<FJsonObject> memory = MakeShared<FJsonObject>();
+	memory->SetNumberField(TEXT("startUsedMB"), startUsedPhysical * bytesToMB);
+	memory->SetNumberField(TEXT("endUsedMB"), endUsedPhysical * bytesToMB);
+	memory->SetNumberField(TEXT("peakUsedMB"), peakUsedPhysical * bytesToMB);
+	memory->SetNumberField(TEXT("perBotKB"), bots.Num() > 0 ? ((double)endUsedPhysical - (double)startUsedPhysical) / 1024.0 / bots.Num() : 0.0);
+	report->SetObjectField(TEXT("memory"), memory);
+
+	SaveReport(report, FString::Printf(TEXT("Benchmark_%d"), bots.Num()), true, settings.outputPath);
+}
+
+void URebellionBenchmarkSubsystem::RegisterPhysicsTicks()
+{
+	UWorld* world = GetWorld();
+
+	physicsStartTick.benchmark = this;
+	physicsStartTick.bIsStart = true;
+	physicsStartTick.TickGroup = TG_StartPhysics;
+	physicsStartTick.bCanEverTick = true;
+	physicsStartTick.bStartWithTickEnabled = true;
+	physicsStartTick.RegisterTickFunction(world->PersistentLevel);
+	//Physics starts only after we've taken the timestamp
+	world->StartPhysicsTickFunction.AddPrerequisite(this, physicsStartTick);
+
+	physicsEndTick.benchmark = this;
+	physicsEndTick.bIsStart = false;
+	physicsEndTick.TickGroup = TG_EndPhysics;
+	physicsEndTick.bCanEverTick = true;
+	physicsEndTick.bStartWithTickEnabled = true;
+	physicsEndTick.RegisterTickFunction(world->PersistentLevel);
+	physicsEndTick.AddPrerequisite(world, world->EndPhysicsTickFunction);
+}
+
+void URebellionBenchmarkSubsystem::UnregisterPhysicsTicks()
+{
+	UWorld* world = GetWorld();
+
+	if (physicsStartTick.IsTickFunctionRegistered())
+	{
+		if (world)
+		{
+			world->StartPhysicsTickFunction.RemovePrerequisite(this, physicsStartTick);
+		}
+		physicsStartTick.UnRegisterTickFunction();
+	}
+	if (physicsEndTick.IsTickFunctionRegistered())
+	{
+		physicsEndTick.UnRegisterTickFunction();
+	}
+}
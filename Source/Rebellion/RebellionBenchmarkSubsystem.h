@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/EngineBaseTypes.h"
+#include "RebellionBenchmarkSubsystem.generated.h"
+
+class UInputComponent;
+class URebellionBenchmarkSubsystem;
+
+/** Marks the start or end of the physics tick groups for the benchmark */
+struct FBenchmarkPhysicsTickFunction : public FTickFunction
+{
+	URebellionBenchmarkSubsystem* benchmark = nullptr;
+	bool bIsStart = false;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override { return TEXT("RebellionBenchmarkPhysicsTick"); }
+};
+
+/** Benchmark run settings, read from the command line or the Rebellion.Benchmark console command */
+struct FRebellionBenchmarkSettings
+{
+	int32 botCount = 50;
+	int32 warmupFrames = 60;
+	int32 frames = 600;
+	//Every Nth bot is a ranged character
+	int32 rangedEvery = 4;
+	bool bExitWhenDone = false;
+	FString outputPath;
+};
+
+/**
+ * Headless combat benchmark. Spawns N melee/ranged bots, drives them through their own input
+ * bindings (FScriptedInput) with a deterministic script for a fixed number of frames, then writes
+ * p50/p95/p99 frame, game thread, world tick and physics times plus memory as JSON.
+ *
+ *	UE4Editor Rebellion /Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap -game -nullrhi -nosound -unattended
+ *		-benchmark -fps=60 -RebellionBenchmark=250 [-BenchmarkFrames=600] [-BenchmarkWarmup=60]
+ *		[-BenchmarkOutput=path.json] [-BenchmarkExit]
+ *
+ * -benchmark -fps=60 fixes the timestep so every run simulates the same frames.
+ */
+UCLASS()
+class REBELLION_API URebellionBenchmarkSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	/** Queues a run that starts on the next frame */
+	void StartBenchmark(const FRebellionBenchmarkSettings& settings);
+
+	bool IsRunning() const { return bRunning; }
+
+	void OnPhysicsTickBoundary(bool bIsStart);
+
+	/** p50/p95/p99/mean/max of a set of samples as a JSON object */
+	static TSharedRef<class FJsonObject> MakePercentiles(TArray<float> values);
+
+	/**
+	 * Writes report to Saved/Profiling/Rebellion/<name>_<date>.json, or to outputPath if one is given, and logs where.
+	 * Every Rebellion report goes through here. bLogJson also prints the JSON for runs without file access
+	 */
+	static bool SaveReport(const TSharedRef<class FJsonObject>& report, const FString& name, bool bLogJson = false, const FString& outputPath = FString());
+
+private:
+
+	struct FBot
+	{
+		TWeakObjectPtr<APawn> pawn;
+		UInputComponent* input = nullptr;
+		bool bRanged = false;
+	};
+
+	/** Per frame samples in milliseconds */
+	struct FFrameSamples
+	{
+		TArray<float> frameMs;
+		TArray<float> gameThreadMs;
+		TArray<float> worldTickMs;
+		TArray<float> physicsMs;
+	};
+
+	void SpawnBots();
+	void DriveBots();
+	void RecordFrame(float DeltaTime);
+	void Finish();
+	void WriteReport() const;
+	void RegisterPhysicsTicks();
+	void UnregisterPhysicsTicks();
+
+	void OnWorldTickStart(UWorld* world, ELevelTick tickType, float deltaSeconds);
+
+	FRebellionBenchmarkSettings settings;
+	bool bPending = false;
+	bool bRunning = false;
+	int32 frame = 0;
+
+	TArray<FBot> bots;
+	FFrameSamples samples;
+
+	uint64 worldTickStartCycles = 0;
+	uint64 physicsStartCycles = 0;
+	uint64 physicsEndCycles = 0;
+	uint64 peakUsedPhysical = 0;
+	uint64 startUsedPhysical = 0;
+	double spawnSeconds = 0.0;
+
+	FDelegateHandle worldTickStartHandle;
+	FBenchmarkPhysicsTickFunction physicsStartTick;
+	FBenchmarkPhysicsTickFunction physicsEndTick;
+
+	UPROPERTY()
+		TArray<UInputComponent*> botInputComponents;
+};
@@ -0,0 +1,1233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+//Console driven microbenchmarks for the combat systems. Run them from the console of a PIE or -game session:
+//	Rebellion.Bench.WeaponTraces [attackers...] [frames=N] [substeps=N]
+//	Rebellion.Bench.Crowd [enemies...] [frames=N]
+//	Rebellion.Bench.Projectiles [projectiles...] [frames=N]
+//	Rebellion.Bench.TargetQueries [targets...] [queries=N] [radius=N] [spacing=N]
+//	Rebellion.Bench.HitResolve [hits...] [frames=N] [maxtasks=N] [chunk=N]
+//	Rebellion.Bench.CharacterFootprint [count=N]
+//	Rebellion.Bench.NetSoak [npcs=N] [moving=percent] [spacing=N] [seconds=N] [interval=N] (on a server, clients join separately)
+//	Rebellion.Benchmark [bots] [frames=N] [warmup=N] (full scripted bot run, see URebellionBenchmarkSubsystem)
+//Each one writes Saved/Profiling/Rebellion/<name>_<date>.json through URebellionBenchmarkSubsystem::SaveReport, one frame benchmark runs at a time.
+
+#include "CoreMinimal.h"
+#include "CoreGlobals.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/World.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "WorldCollision.h"
+#include "Rebellion.h"
+#include "CombatSubsystem.h"
+#include "CombatSpatialHash.h"
+#include "EnemyCrowdManager.h"
+#include "ProjectileManager.h"
+#include "RebellionBenchmarkSubsystem.h"
+#include "RebellionCharacter.h"
+#include "RebellionAICharacter.h"
+#include "RangedCharacter.h"
+#include "RangedAICharacter.h"
+#include "RebellionReplicationGraph.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/GameModeBase.h"
+#include "Dom/JsonObject.h"
+
+namespace RebellionBenchmarks
+{
+	/** Parses "key=value" out of the console arguments, leaving plain numbers in outValues */
+	static int32 ParseArgs(const TArray<FString>& args, const TCHAR* key, int32 defaultValue, TArray<int32>& outValues)
+	{
+		int32 result = defaultValue;
+		const FString prefix = FString(key) + TEXT("=");
+		for (const FString& arg : args)
+		{
+			if (arg.StartsWith(prefix))
+			{
+				result = FCString::Atoi(*arg.RightChop(prefix.Len()));
+			}
+			else if (arg.IsNumeric())
+			{
+				outValues.AddUnique(FCString::Atoi(*arg));
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * A benchmark measured over frames from the world's post actor tick. Each measured step adds a row, once it
+	 * finishes the rows go to Saved/Profiling/Rebellion/<name>_<date>.json through URebellionBenchmarkSubsystem::SaveReport.
+	 */
+	class FFrameBenchmark
+	{
+	public:
+		FFrameBenchmark(UWorld* inWorld, const TCHAR* inName)
+			: world(inWorld)
+			, name(inName)
+		{
+			tickHandle = FWorldDelegates::OnWorldPostActorTick.AddRaw(this, &FFrameBenchmark::OnPostActorTick);
+		}
+
+		virtual ~FFrameBenchmark()
+		{
+			FWorldDelegates::OnWorldPostActorTick.Remove(tickHandle);
+		}
+
+		virtual bool IsFinished() const = 0;
+
+		const TCHAR* GetName() const { return name; }
+
+	protected:
+
+		//Only called for the benchmark's world while it isn't finished
+		virtual void Step(UWorld& tickWorld, float deltaSeconds) = 0;
+		//Called once it finished, before the report is saved: fields besides the rows and cleanup
+		virtual void FinishRun(FJsonObject& report) {}
+
+		void AddRow(const TSharedRef<FJsonObject>& row)
+		{
+			rows.Add(MakeShared<FJsonValueObject>(row));
+		}
+
+		TWeakObjectPtr<UWorld> world;
+		//Also prints the report, for machines without easy access to their files
+		bool bLogJson = false;
+
+	private:
+
+		void OnPostActorTick(UWorld* tickWorld, ELevelTick tickType, float deltaSeconds)
+		{
+			if (!tickWorld || tickWorld != world.Get() || IsFinished())
+			{
+				return;
+			}
+
+			Step(*tickWorld, deltaSeconds);
+			if (IsFinished())
+			{
+				TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+				report->SetStringField(TEXT("map"), tickWorld->GetMapName());
+				FinishRun(*report);
+				if (rows.Num() > 0)
+				{
+					report->SetArrayField(TEXT("runs"), rows);
+				}
+				URebellionBenchmarkSubsystem::SaveReport(report, name, bLogJson);
+			}
+		}
+
+		const TCHAR* name;
+		FDelegateHandle tickHandle;
+		TArray<TSharedPtr<FJsonValue>> rows;
+	};
+
+	//One frame benchmark at a time, two would measure each other
+	static TUniquePtr<FFrameBenchmark> frameBenchmark;
+
+	static bool IsFrameBenchmarkRunning()
+	{
+		if (frameBenchmark && !frameBenchmark->IsFinished())
+		{
+			UE_LOG(LogRebellion, Warning, TEXT("Rebellion.Bench.%s is still running"), frameBenchmark->GetName());
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Feeds UCombatSubsystem a synthetic weapon sweep load for a number of frames per attacker count,
+	 * then logs the per frame trace issue/dispatch cost and game thread time for each count.
+	 */
+	class FWeaponTraceBenchmark : public FFrameBenchmark
+	{
+	public:
+		FWeaponTraceBenchmark(UWorld* inWorld, const TArray<int32>& inAttackerCounts, int32 inFrames, int32 inSubsteps)
+			: FFrameBenchmark(inWorld, TEXT("WeaponTraces"))
+			, attackerCounts(inAttackerCounts)
+			, framesPerCount(FMath::Max(inFrames, 2))
+			, substeps(FMath::Max(inSubsteps, 1))
+		{
+		}
+
+		virtual bool IsFinished() const override { return countIndex >= attackerCounts.Num(); }
+
+	private:
+
+		virtual void Step(UWorld& tickWorld, float deltaSeconds) override
+		{
+			UCombatSubsystem* combat = tickWorld.GetSubsystem<UCombatSubsystem>();
+			if (!combat)
+			{
+				return;
+			}
+
+			//The first frame has nothing in flight yet
+			if (frame > 0)
+			{
+				const FCombatTraceFrameStats& stats = combat->GetLastFrameStats();
+				issueCycles += stats.issueCycles;
+				dispatchCycles += stats.dispatchCycles;
+				hits += stats.hitsDispatched;
+				gameThreadCycles += GGameThreadTime;
+			}
+
+			if (++frame > framesPerCount)
+			{
+				Report();
+				ResetCounters();
+				countIndex++;
+				return;
+			}
+
+			QueueSyntheticSweeps(*combat, attackerCounts[countIndex]);
+		}
+
+		void QueueSyntheticSweeps(UCombatSubsystem& combat, int32 attackers)
+		{
+			//Attackers stand on a grid 2m apart, each swinging a short arc around itself
+			const int32 gridSize = FMath::CeilToInt(FMath::Sqrt((float)attackers));
+			const FVector halfExtent(8.f, 8.f, 40.f);
+			const float arcPerStep = 0.35f / substeps;
+
+			for (int32 attacker = 0; attacker < attackers; attacker++)
+			{
+				const FVector center((attacker % gridSize) * 200.f, (attacker / gridSize) * 200.f, 100.f);
+				float angle = frame * 0.35f + attacker;
+				for (int32 step = 0; step < substeps; step++)
+				{
+					const FVector start = center + FVector(FMath::Cos(angle), FMath::Sin(angle), 0.f) * 80.f;
+					angle += arcPerStep;
+					const FVector end = center + FVector(FMath::Cos(angle), FMath::Sin(angle), 0.f) * 80.f;
+					combat.QueueWeaponSweep(nullptr, start, end, FQuat(FVector::UpVector, angle), halfExtent);
+				}
+			}
+		}
+
+		void Report()
+		{
+			const int32 measuredFrames = framesPerCount - 1;
+			const int32 attackers = attackerCounts[countIndex];
+			const double issueMs = FPlatformTime::ToMilliseconds64(issueCycles) / measuredFrames;
+			const double dispatchMs = FPlatformTime::ToMilliseconds64(dispatchCycles) / measuredFrames;
+			const double gameThreadMs = FPlatformTime::ToMilliseconds64(gameThreadCycles) / measuredFrames;
+			const float hitsPerFrame = (float)hits / measuredFrames;
+			UE_LOG(LogRebellion, Display, TEXT("WeaponTraces attackers=%d sweeps/frame=%d issue=%.3fms dispatch=%.3fms gamethread=%.3fms hits/frame=%.1f"),
+				attackers,
+				attackers * substeps,
+				issueMs,
+				dispatchMs,
+				gameThreadMs,
+				hitsPerFrame);
+
+			TSharedRef<FJsonObject> row = MakeShared<FJsonObject>();
+			row->SetNumberField(TEXT("attackers"), attackers);
+			row->SetNumberField(TEXT("sweepsPerFrame"), attackers * substeps);
+			row->SetNumberField(TEXT("issueMs"), issueMs);
+			row->SetNumberField(TEXT("dispatchMs"), dispatchMs);
+			row->SetNumberField(TEXT("gameThreadMs"), gameThreadMs);
+			row->SetNumberField(TEXT("hitsPerFrame"), hitsPerFrame);
+			AddRow(row);
+		}
+
+		virtual void FinishRun(FJsonObject& report) override
+		{
+			report.SetNumberField(TEXT("frames"), framesPerCount);
+			report.SetNumberField(TEXT("substeps"), substeps);
+		}
+
+		void ResetCounters()
+		{
+			frame = 0;
+			issueCycles = 0;
+			dispatchCycles = 0;
+			gameThreadCycles = 0;
+			hits = 0;
+		}
+
+		TArray<int32> attackerCounts;
+		int32 framesPerCount;
+		int32 substeps;
+
+		int32 countIndex = 0;
+		int32 frame = 0;
+		uint64 issueCycles = 0;
+		uint64 dispatchCycles = 0;
+		uint64 gameThreadCycles = 0;
+		int64 hits = 0;
+	};
+
+	static void StartWeaponTraceBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world || IsFrameBenchmarkRunning())
+		{
+			return;
+		}
+
+		TArray<int32> attackerCounts;
+		const int32 frames = ParseArgs(args, TEXT("frames"), 300, attackerCounts);
+		const int32 substeps = ParseArgs(args, TEXT("substeps"), 4, attackerCounts);
+		if (attackerCounts.Num() == 0)
+		{
+			attackerCounts = { 10, 100, 1000 };
+		}
+
+		frameBenchmark.Reset();
+		frameBenchmark = MakeUnique<FWeaponTraceBenchmark>(world, attackerCounts, frames, substeps);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchWeaponTracesCommand(
+		TEXT("Rebellion.Bench.WeaponTraces"),
+		TEXT("Queues synthetic weapon sweeps through UCombatSubsystem and logs per frame cost, then writes it as JSON to Saved/Profiling/Rebellion. Args: [attacker counts...] [frames=300] [substeps=4]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartWeaponTraceBenchmark));
+
+	/**
+	 * Runs a temporary AEnemyCrowdManager at each enemy count for a number of frames and logs the
+	 * SoA update pass and instance upload cost per frame and per enemy.
+	 */
+	class FCrowdBenchmark : public FFrameBenchmark
+	{
+	public:
+		FCrowdBenchmark(UWorld* inWorld, const TArray<int32>& inEnemyCounts, int32 inFrames)
+			: FFrameBenchmark(inWorld, TEXT("Crowd"))
+			, enemyCounts(inEnemyCounts)
+			, framesPerCount(FMath::Max(inFrames, 2))
+		{
+			FActorSpawnParameters spawnParams;
+			spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			spawnParams.bDeferConstruction = true;
+			crowd = inWorld->SpawnActor<AEnemyCrowdManager>(FVector::ZeroVector, FRotator::ZeroRotator, spawnParams);
+			if (crowd.IsValid())
+			{
+				crowd->initialEnemyCount = 0;
+				crowd->FinishSpawning(FTransform::Identity);
+			}
+		}
+
+		virtual ~FCrowdBenchmark()
+		{
+			if (crowd.IsValid())
+			{
+				crowd->Destroy();
+			}
+		}
+
+		virtual bool IsFinished() const override { return countIndex >= enemyCounts.Num() || !crowd.IsValid(); }
+
+	private:
+
+		virtual void Step(UWorld& tickWorld, float deltaSeconds) override
+		{
+			//Spawn on the first frame of a count, the crowd's next tick is the first one measured
+			if (frame == 0)
+			{
+				//Keep density constant so the chase behaviour matches across counts
+				const int32 enemies = enemyCounts[countIndex];
+				crowd->ClearEnemies();
+				crowd->SpawnEnemies(enemies, FVector(0.f, 0.f, 100.f), FMath::Sqrt((float)enemies) * 100.f);
+				frame = 1;
+				return;
+			}
+
+			updateMs += crowd->GetLastUpdateMs();
+			uploadMs += crowd->GetLastInstanceUploadMs();
+
+			if (++frame > framesPerCount)
+			{
+				Report();
+				countIndex++;
+				frame = 0;
+				updateMs = 0.0;
+				uploadMs = 0.0;
+
+				if (countIndex >= enemyCounts.Num())
+				{
+					crowd->Destroy();
+				}
+			}
+		}
+
+		void Report()
+		{
+			const int32 enemies = enemyCounts[countIndex];
+			const double updatePerFrame = updateMs / framesPerCount;
+			const double uploadPerFrame = uploadMs / framesPerCount;
+			UE_LOG(LogRebellion, Display, TEXT("Crowd enemies=%d update=%.3fms (%.1fns/enemy) upload=%.3fms (%.1fns/enemy)"),
+				enemies,
+				updatePerFrame,
+				updatePerFrame * 1000000.0 / enemies,
+				uploadPerFrame,
+				uploadPerFrame * 1000000.0 / enemies);
+
+			TSharedRef<FJsonObject> row = MakeShared<FJsonObject>();
+			row->SetNumberField(TEXT("enemies"), enemies);
+			row->SetNumberField(TEXT("updateMs"), updatePerFrame);
+			row->SetNumberField(TEXT("updateNsPerEnemy"), updatePerFrame * 1000000.0 / enemies);
+			row->SetNumberField(TEXT("uploadMs"), uploadPerFrame);
+			row->SetNumberField(TEXT("uploadNsPerEnemy"), uploadPerFrame * 1000000.0 / enemies);
+			AddRow(row);
+		}
+
+		virtual void FinishRun(FJsonObject& report) override
+		{
+			report.SetNumberField(TEXT("frames"), framesPerCount);
+		}
+
+		TWeakObjectPtr<AEnemyCrowdManager> crowd;
+		TArray<int32> enemyCounts;
+		int32 framesPerCount;
+
+		int32 countIndex = 0;
+		int32 frame = 0;
+		double updateMs = 0.0;
+		double uploadMs = 0.0;
+	};
+
+	static void StartCrowdBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world || IsFrameBenchmarkRunning())
+		{
+			return;
+		}
+
+		TArray<int32> enemyCounts;
+		const int32 frames = ParseArgs(args, TEXT("frames"), 300, enemyCounts);
+		if (enemyCounts.Num() == 0)
+		{
+			enemyCounts = { 100, 500, 1000, 2500, 5000 };
+		}
+
+		frameBenchmark.Reset();
+		frameBenchmark = MakeUnique<FCrowdBenchmark>(world, enemyCounts, frames);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchCrowdCommand(
+		TEXT("Rebellion.Bench.Crowd"),
+		TEXT("Simulates a crowd at each enemy count and logs SoA update and instance upload cost, then writes it as JSON to Saved/Profiling/Rebellion. Args: [enemy counts...] [frames=300]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartCrowdBenchmark));
+
+	/**
+	 * Keeps a temporary AProjectileManager topped up to each live count for a number of frames and logs
+	 * the integrate, collide and instance upload cost per frame and per projectile. Projectiles fly far
+	 * above the level with short lifetimes, so every frame pays for expiry, refills and world traces but no hits.
+	 */
+	class FProjectileBenchmark : public FFrameBenchmark
+	{
+	public:
+		FProjectileBenchmark(UWorld* inWorld, const TArray<int32>& inProjectileCounts, int32 inFrames)
+			: FFrameBenchmark(inWorld, TEXT("Projectiles"))
+			, projectileCounts(inProjectileCounts)
+			, framesPerCount(FMath::Max(inFrames, 2))
+		{
+			FActorSpawnParameters spawnParams;
+			spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			spawnParams.bDeferConstruction = true;
+			projectiles = inWorld->SpawnActor<AProjectileManager>(FVector::ZeroVector, FRotator::ZeroRotator, spawnParams);
+			if (projectiles.IsValid())
+			{
+				projectiles->maxProjectiles = FMath::Max(projectileCounts);
+				projectiles->FinishSpawning(FTransform::Identity);
+			}
+		}
+
+		virtual ~FProjectileBenchmark()
+		{
+			if (projectiles.IsValid())
+			{
+				projectiles->Destroy();
+			}
+		}
+
+		virtual bool IsFinished() const override { return countIndex >= projectileCounts.Num() || !projectiles.IsValid(); }
+
+	private:
+
+		virtual void Step(UWorld& tickWorld, float deltaSeconds) override
+		{
+			//The first frame of a count only fills the pool, the manager's next tick is the first one measured
+			if (frame == 0)
+			{
+				projectiles->ClearProjectiles();
+				frame = 1;
+			}
+			else
+			{
+				integrateMs += projectiles->GetLastIntegrateMs();
+				collideMs += projectiles->GetLastCollideMs();
+				uploadMs += projectiles->GetLastInstanceUploadMs();
+				worldTraces += projectiles->GetLastWorldTraceCount();
+				refills += projectileCounts[countIndex] - projectiles->GetNumLive();
+
+				if (++frame > framesPerCount)
+				{
+					Report();
+					countIndex++;
+					frame = 0;
+					integrateMs = 0.0;
+					collideMs = 0.0;
+					uploadMs = 0.0;
+					worldTraces = 0;
+					refills = 0;
+
+					if (countIndex >= projectileCounts.Num())
+					{
+						projectiles->Destroy();
+					}
+					return;
+				}
+			}
+
+			TopUp(projectileCounts[countIndex]);
+		}
+
+		void TopUp(int32 count)
+		{
+			//Lifetimes spread over a second so roughly the same number expire and refill every frame
+			while (projectiles->GetNumLive() < count)
+			{
+				const FVector origin(random.FRandRange(-20000.f, 20000.f), random.FRandRange(-20000.f, 20000.f), 100000.f);
+				const float heading = random.FRandRange(0.f, 2.f * PI);
+				const FVector velocity(FMath::Cos(heading) * 3000.f, FMath::Sin(heading) * 3000.f, 0.f);
+				if (!projectiles->Fire(nullptr, origin, velocity, 0.f, random.FRandRange(0.5f, 1.5f)))
+				{
+					break;
+				}
+			}
+		}
+
+		void Report()
+		{
+			const int32 count = projectileCounts[countIndex];
+			const double integratePerFrame = integrateMs / framesPerCount;
+			const double collidePerFrame = collideMs / framesPerCount;
+			const double uploadPerFrame = uploadMs / framesPerCount;
+			UE_LOG(LogRebellion, Display, TEXT("Projectiles live=%d integrate=%.3fms (%.1fns/projectile) collide=%.3fms (%.1fns/projectile) upload=%.3fms (%.1fns/projectile) worldTraces/frame=%.0f refills/frame=%.0f"),
+				count,
+				integratePerFrame,
+				integratePerFrame * 1000000.0 / count,
+				collidePerFrame,
+				collidePerFrame * 1000000.0 / count,
+				uploadPerFrame,
+				uploadPerFrame * 1000000.0 / count,
+				(double)worldTraces / framesPerCount,
+				(double)refills / framesPerCount);
+
+			TSharedRef<FJsonObject> row = MakeShared<FJsonObject>();
+			row->SetNumberField(TEXT("live"), count);
+			row->SetNumberField(TEXT("integrateMs"), integratePerFrame);
+			row->SetNumberField(TEXT("collideMs"), collidePerFrame);
+			row->SetNumberField(TEXT("uploadMs"), uploadPerFrame);
+			row->SetNumberField(TEXT("worldTracesPerFrame"), (double)worldTraces / framesPerCount);
+			row->SetNumberField(TEXT("refillsPerFrame"), (double)refills / framesPerCount);
+			AddRow(row);
+		}
+
+		virtual void FinishRun(FJsonObject& report) override
+		{
+			report.SetNumberField(TEXT("frames"), framesPerCount);
+		}
+
+		TWeakObjectPtr<AProjectileManager> projectiles;
+		TArray<int32> projectileCounts;
+		int32 framesPerCount;
+		FRandomStream random{ 1337 };
+
+		int32 countIndex = 0;
+		int32 frame = 0;
+		double integrateMs = 0.0;
+		double collideMs = 0.0;
+		double uploadMs = 0.0;
+		int64 worldTraces = 0;
+		int64 refills = 0;
+	};
+
+	static void StartProjectileBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world || IsFrameBenchmarkRunning())
+		{
+			return;
+		}
+
+		TArray<int32> projectileCounts;
+		const int32 frames = ParseArgs(args, TEXT("frames"), 300, projectileCounts);
+		projectileCounts.RemoveAll([](int32 count) { return count <= 0; });
+		if (projectileCounts.Num() == 0)
+		{
+			projectileCounts = { 1000, 5000, 10000 };
+		}
+
+		frameBenchmark.Reset();
+		frameBenchmark = MakeUnique<FProjectileBenchmark>(world, projectileCounts, frames);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchProjectilesCommand(
+		TEXT("Rebellion.Bench.Projectiles"),
+		TEXT("Keeps each number of projectiles live and logs integrate, collide and instance upload cost, then writes it as JSON to Saved/Profiling/Rebellion. Args: [live counts...] [frames=300]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartProjectileBenchmark));
+
+	/**
+	 * Places pawn-like capsule targets on a jittered grid and times the same radius queries through
+	 * FCombatSpatialHash (one by one and batched) and through OverlapMultiByChannel on the Pawn channel.
+	 * Runs synchronously inside the console command.
+	 */
+	static void RunTargetQueryBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world)
+		{
+			return;
+		}
+
+		TArray<int32> targetCounts;
+		const int32 queryCount = FMath::Max(ParseArgs(args, TEXT("queries"), 1000, targetCounts), 1);
+		const float radius = (float)ParseArgs(args, TEXT("radius"), 300, targetCounts);
+		//Default spacing is a dense melee brawl, one target every 2m
+		const float spacing = (float)ParseArgs(args, TEXT("spacing"), 200, targetCounts);
+		if (targetCounts.Num() == 0)
+		{
+			targetCounts = { 50, 200, 1000 };
+		}
+
+		TArray<TSharedPtr<FJsonValue>> runs;
+		for (int32 targetCount : targetCounts)
+		{
+			FRandomStream random(targetCount);
+			const int32 gridSize = FMath::CeilToInt(FMath::Sqrt((float)targetCount));
+
+			FCombatSpatialHash targetHash;
+			TArray<AActor*> targets;
+			targets.Reserve(targetCount);
+
+			FActorSpawnParameters spawnParams;
+			spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			for (int32 index = 0; index < targetCount; index++)
+			{
+				const FVector location((index % gridSize) * spacing + random.FRandRange(-0.25f, 0.25f) * spacing,
+					(index / gridSize) * spacing + random.FRandRange(-0.25f, 0.25f) * spacing,
+					100000.f);
+
+				AActor* target = world->SpawnActor<AActor>(AActor::StaticClass(), FTransform(location), spawnParams);
+				UCapsuleComponent* capsule = NewObject<UCapsuleComponent>(target);
+				capsule->InitCapsuleSize(42.f, 96.f);
+				capsule->SetCollisionProfileName(UCollisionProfile::Pawn_ProfileName);
+				target->SetRootComponent(capsule);
+				capsule->SetWorldLocation(location);
+				capsule->RegisterComponent();
+
+				targets.Add(target);
+				targetHash.Add(target, location, 96.f);
+			}
+
+			TArray<FCombatSpatialQuery> queries;
+			queries.Reserve(queryCount);
+			for (int32 index = 0; index < queryCount; index++)
+			{
+				FCombatSpatialQuery& query = queries.AddDefaulted_GetRef();
+				query.type = ECombatSpatialQueryType::RADIUS;
+				query.origin = targets[random.RandHelper(targetCount)]->GetActorLocation();
+				query.radius = radius;
+			}
+
+			TArray<int32> candidateIds;
+			int64 hashCandidates = 0;
+			uint64 startCycles = FPlatformTime::Cycles64();
+			for (const FCombatSpatialQuery& query : queries)
+			{
+				candidateIds.Reset();
+				targetHash.QueryRadius(query.origin, query.radius, candidateIds);
+				hashCandidates += candidateIds.Num();
+			}
+			const double hashMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+			TArray<int32> batchIds;
+			TArray<int32> batchOffsets;
+			startCycles = FPlatformTime::Cycles64();
+			targetHash.QueryBatch(queries, batchIds, batchOffsets);
+			const double batchMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+			TArray<FOverlapResult> overlaps;
+			const FCollisionQueryParams queryParams(SCENE_QUERY_STAT(TargetQueryBenchmark), false);
+			int64 overlapCandidates = 0;
+			startCycles = FPlatformTime::Cycles64();
+			for (const FCombatSpatialQuery& query : queries)
+			{
+				overlaps.Reset();
+				world->OverlapMultiByChannel(overlaps, query.origin, FQuat::Identity, ECC_Pawn, FCollisionShape::MakeSphere(query.radius), queryParams);
+				overlapCandidates += overlaps.Num();
+			}
+			const double overlapMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+			//The hash tests bounding spheres, so it returns a few more candidates than the exact overlap
+			UE_LOG(LogRebellion, Display, TEXT("TargetQueries targets=%d queries=%d radius=%.0f hash=%.3fms batch=%.3fms overlap=%.3fms (%.2fx) candidates/query hash=%.1f overlap=%.1f"),
+				targetCount,
+				queryCount,
+				radius,
+				hashMs,
+				batchMs,
+				overlapMs,
+				hashMs > 0.0 ? overlapMs / hashMs : 0.0,
+				(float)hashCandidates / queryCount,
+				(float)overlapCandidates / queryCount);
+
+			TSharedRef<FJsonObject> run = MakeShared<FJsonObject>();
+			run->SetNumberField(TEXT("targets"), targetCount);
+			run->SetNumberField(TEXT("hashMs"), hashMs);
+			run->SetNumberField(TEXT("batchMs"), batchMs);
+			run->SetNumberField(TEXT("overlapMs"), overlapMs);
+			run->SetNumberField(TEXT("hashCandidatesPerQuery"), (double)hashCandidates / queryCount);
+			run->SetNumberField(TEXT("overlapCandidatesPerQuery"), (double)overlapCandidates / queryCount);
+			runs.Add(MakeShared<FJsonValueObject>(run));
+
+			for (AActor* target : targets)
+			{
+				target->Destroy();
+			}
+		}
+
+		TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+		report->SetStringField(TEXT("map"), world->GetMapName());
+		report->SetNumberField(TEXT("queries"), queryCount);
+		report->SetNumberField(TEXT("radius"), radius);
+		report->SetNumberField(TEXT("spacing"), spacing);
+		report->SetArrayField(TEXT("runs"), runs);
+		URebellionBenchmarkSubsystem::SaveReport(report, TEXT("TargetQueries"));
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchTargetQueriesCommand(
+		TEXT("Rebellion.Bench.TargetQueries"),
+		TEXT("Times radius target queries through the combat spatial hash against OverlapMultiByChannel and writes them as JSON to Saved/Profiling/Rebellion. Args: [target counts...] [queries=1000] [radius=300] [spacing=200]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunTargetQueryBenchmark));
+
+	/**
+	 * Times the damage pass's compute stage on synthetic hit records for every task count from 1 to maxtasks
+	 * and logs the speedup over one task, and the smallest hit count where going parallel paid off, what
+	 * Rebellion.Combat.ParallelHitThreshold should be set from. Writes Saved/Profiling/Rebellion/HitResolve_<date>.json.
+	 * Pure data, no actors are spawned. Runs synchronously inside the console command.
+	 */
+	static void RunHitResolveBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		TArray<int32> hitCounts;
+		const int32 frames = FMath::Max(ParseArgs(args, TEXT("frames"), 200, hitCounts), 1);
+		const int32 maxTasks = FMath::Clamp(ParseArgs(args, TEXT("maxtasks"), 8, hitCounts), 1, 64);
+		const int32 chunkSize = FMath::Max(ParseArgs(args, TEXT("chunk"), 64, hitCounts), 1);
+		if (hitCounts.Num() == 0)
+		{
+			hitCounts = { 250, 1000, 4000, 16000, 64000 };
+		}
+		hitCounts.Sort();
+
+		//Less than this over one task doesn't pay for the frame to frame noise of waking workers
+		const double minUsefulSpeedup = 1.1;
+		int32 breakEvenHits = INDEX_NONE;
+
+		const FCombatHitRules rules = FCombatHitRules::FromConsoleVariables();
+		TArray<TSharedPtr<FJsonValue>> runs;
+		for (int32 hitCount : hitCounts)
+		{
+			//A brawl's mix: a quarter ranged from up to 50m, a quarter of the targets blocking
+			FRandomStream random(hitCount);
+			TArray<FCombatHitRecord> records;
+			records.SetNumZeroed(hitCount);
+			for (int32 index = 0; index < hitCount; index++)
+			{
+				FCombatHitRecord& record = records[index];
+				const bool bRanged = random.FRand() < 0.25f;
+				record.attackType = bRanged ? EAttackType::RANGED : EAttackType::MELEE_PRIMARY;
+				record.targetSubIndex = INDEX_NONE;
+				record.damage = random.FRandRange(10.f, 50.f);
+				record.attackerLocation = FVector(random.FRandRange(-5000.f, 5000.f), random.FRandRange(-5000.f, 5000.f), 100.f);
+				record.hitDirection = random.GetUnitVector();
+				record.hitLocation = record.attackerLocation + record.hitDirection * (bRanged ? random.FRandRange(200.f, 5000.f) : 150.f);
+				record.targetForward = FVector(random.GetUnitVector().GetSafeNormal2D());
+				record.bTargetBlocking = random.FRand() < 0.25f;
+				record.sequence = index;
+			}
+
+			TArray<FCombatHitResult> results;
+			double singleTaskMs = 0.0;
+			double bestSpeedup = 1.0;
+			for (int32 taskCount = 1; taskCount <= maxTasks; taskCount++)
+			{
+				//Untimed pass, so every task count starts with warm caches and awake workers
+				UCombatSubsystem::ComputeHitResults(records, results, rules, taskCount, chunkSize);
+
+				TArray<float> frameMs;
+				frameMs.Reserve(frames);
+				for (int32 frame = 0; frame < frames; frame++)
+				{
+					const uint64 startCycles = FPlatformTime::Cycles64();
+					UCombatSubsystem::ComputeHitResults(records, results, rules, taskCount, chunkSize);
+					frameMs.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles));
+				}
+
+				TSharedRef<FJsonObject> percentiles = URebellionBenchmarkSubsystem::MakePercentiles(frameMs);
+				const double p50 = percentiles->GetNumberField(TEXT("p50"));
+				if (taskCount == 1)
+				{
+					singleTaskMs = p50;
+				}
+				const double speedup = p50 > 0.0 ? singleTaskMs / p50 : 0.0;
+				bestSpeedup = FMath::Max(bestSpeedup, speedup);
+
+				UE_LOG(LogRebellion, Display, TEXT("HitResolve hits=%d tasks=%d p50=%.3fms p95=%.3fms speedup=%.2fx efficiency=%.0f%% ns/hit=%.1f"),
+					hitCount,
+					taskCount,
+					p50,
+					percentiles->GetNumberField(TEXT("p95")),
+					speedup,
+					speedup / taskCount * 100.0,
+					p50 * 1000000.0 / hitCount);
+
+				TSharedRef<FJsonObject> run = MakeShared<FJsonObject>();
+				run->SetNumberField(TEXT("hits"), hitCount);
+				run->SetNumberField(TEXT("tasks"), taskCount);
+				run->SetObjectField(TEXT("frameMs"), percentiles);
+				run->SetNumberField(TEXT("speedup"), speedup);
+				runs.Add(MakeShared<FJsonValueObject>(run));
+			}
+
+			if (breakEvenHits == INDEX_NONE && bestSpeedup >= minUsefulSpeedup)
+			{
+				breakEvenHits = hitCount;
+			}
+		}
+
+		if (breakEvenHits == INDEX_NONE)
+		{
+			UE_LOG(LogRebellion, Display, TEXT("HitResolve no hit count ran %.1fx faster on more than one task, the compute stage should stay inline"), minUsefulSpeedup);
+		}
+		else
+		{
+			const IConsoleVariable* thresholdVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("Rebellion.Combat.ParallelHitThreshold"));
+			UE_LOG(LogRebellion, Display, TEXT("HitResolve parallel break even at %d hits, Rebellion.Combat.ParallelHitThreshold is %d"), breakEvenHits, thresholdVariable ? thresholdVariable->GetInt() : INDEX_NONE);
+		}
+
+		//Task counts past workers + 1 can't run at once, speedup flattens there whatever the code does
+		TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+		report->SetNumberField(TEXT("cores"), FPlatformMisc::NumberOfCores());
+		report->SetNumberField(TEXT("workerThreads"), FTaskGraphInterface::Get().GetNumWorkerThreads());
+		report->SetNumberField(TEXT("chunkSize"), chunkSize);
+		report->SetNumberField(TEXT("frames"), frames);
+		//-1 if more tasks never paid off
+		report->SetNumberField(TEXT("parallelBreakEvenHits"), breakEvenHits);
+		report->SetArrayField(TEXT("runs"), runs);
+
+		URebellionBenchmarkSubsystem::SaveReport(report, TEXT("HitResolve"));
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchHitResolveCommand(
+		TEXT("Rebellion.Bench.HitResolve"),
+		TEXT("Times the damage pass's parallel hit compute stage from 1 to maxtasks tasks and writes the scaling as JSON to Saved/Profiling/Rebellion. Args: [hit counts...] [frames=200] [maxtasks=8] [chunk=64]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunHitResolveBenchmark));
+
+	/**
+	 * Spawns count of each player and AI character variant at once and reports the time it took, the
+	 * components of one instance and what an instance costs in memory: the size of its UObjects, their
+	 * own resources, and the process's used physical memory growth divided by count. The native classes
+	 * carry no mesh or anim blueprint, so the numbers are the classes' own overhead.
+	 * Writes Saved/Profiling/Rebellion/CharacterFootprint_<date>.json. Runs synchronously inside the console command.
+	 */
+	static void RunCharacterFootprintBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world)
+		{
+			return;
+		}
+
+		//A plain number works as the count too
+		TArray<int32> counts;
+		int32 count = ParseArgs(args, TEXT("count"), 500, counts);
+		count = FMath::Max(counts.Num() > 0 ? counts[0] : count, 1);
+		const TArray<UClass*> variants = {
+			ARebellionCharacter::StaticClass(),
+			ARebellionAICharacter::StaticClass(),
+			ARangedCharacter::StaticClass(),
+			ARangedAICharacter::StaticClass()
+		};
+
+		FActorSpawnParameters spawnParams;
+		spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		const int32 gridSize = FMath::CeilToInt(FMath::Sqrt((float)count));
+		const float spacing = 150.f;
+
+		TArray<TSharedPtr<FJsonValue>> rows;
+		for (UClass* variantClass : variants)
+		{
+			//Last variant's garbage would otherwise land in this one's memory growth
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+			const uint64 usedBefore = FPlatformMemory::GetStats().UsedPhysical;
+
+			//Every variant gets a controller, the AI ones through AutoPossessAI during the spawn
+			TArray<APawn*> pawns;
+			pawns.Reserve(count);
+			const uint64 startCycles = FPlatformTime::Cycles64();
+			for (int32 index = 0; index < count; index++)
+			{
+				const FVector location((index % gridSize) * spacing, (index / gridSize) * spacing, 100000.f);
+				APawn* pawn = world->SpawnActor<APawn>(variantClass, location, FRotator::ZeroRotator, spawnParams);
+				if (pawn)
+				{
+					pawn->SpawnDefaultController();
+					pawns.Add(pawn);
+				}
+			}
+			const double spawnMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+			const int64 usedGrowth = (int64)FPlatformMemory::GetStats().UsedPhysical - (int64)usedBefore;
+
+			if (pawns.Num() == 0)
+			{
+				UE_LOG(LogRebellion, Warning, TEXT("CharacterFootprint could not spawn %s"), *variantClass->GetName());
+				continue;
+			}
+
+			//Components are the same on every instance, the first one stands for all
+			TInlineComponentArray<UActorComponent*> components(pawns[0]);
+			int64 objectBytes = pawns[0]->GetClass()->GetStructureSize();
+			int64 resourceBytes = pawns[0]->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+			TMap<FString, int32> componentClasses;
+			for (UActorComponent* component : components)
+			{
+				objectBytes += component->GetClass()->GetStructureSize();
+				resourceBytes += component->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+				componentClasses.FindOrAdd(component->GetClass()->GetName())++;
+			}
+
+			UE_LOG(LogRebellion, Display, TEXT("CharacterFootprint %s count=%d spawn=%.2fms (%.3fms each) components=%d objectBytes=%lld resourceBytes=%lld usedPhysical/instance=%lld"),
+				*variantClass->GetName(),
+				pawns.Num(),
+				spawnMs,
+				spawnMs / pawns.Num(),
+				components.Num(),
+				objectBytes,
+				resourceBytes,
+				usedGrowth / pawns.Num());
+
+			TSharedRef<FJsonObject> componentsJson = MakeShared<FJsonObject>();
+			for (const TPair<FString, int32>& componentClass : componentClasses)
+			{
+				componentsJson->SetNumberField(componentClass.Key, componentClass.Value);
+			}
+
+			TSharedRef<FJsonObject> row = MakeShared<FJsonObject>();
+			row->SetStringField(TEXT("class"), variantClass->GetName());
+			row->SetNumberField(TEXT("spawned"), pawns.Num());
+			row->SetNumberField(TEXT("spawnMs"), spawnMs);
+			row->SetNumberField(TEXT("spawnMsPerInstance"), spawnMs / pawns.Num());
+			row->SetNumberField(TEXT("componentCount"), components.Num());
+			row->SetObjectField(TEXT("components"), componentsJson);
+			row->SetNumberField(TEXT("objectBytesPerInstance"), objectBytes);
+			row->SetNumberField(TEXT("resourceBytesPerInstance"), resourceBytes);
+			row->SetNumberField(TEXT("usedPhysicalBytesPerInstance"), (double)usedGrowth / pawns.Num());
+			rows.Add(MakeShared<FJsonValueObject>(row));
+
+			for (APawn* pawn : pawns)
+			{
+				if (AController* controller = pawn->GetController())
+				{
+					controller->Destroy();
+				}
+				pawn->Destroy();
+			}
+		}
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+		TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+		report->SetStringField(TEXT("map"), world->GetMapName());
+		report->SetNumberField(TEXT("count"), count);
+		report->SetArrayField(TEXT("variants"), rows);
+
+		URebellionBenchmarkSubsystem::SaveReport(report, TEXT("CharacterFootprint"));
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchCharacterFootprintCommand(
+		TEXT("Rebellion.Bench.CharacterFootprint"),
+		TEXT("Spawns count of each player and AI character variant at once and writes their spawn time, components and memory per instance as JSON to Saved/Profiling/Rebellion. Args: [count=500]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunCharacterFootprintBenchmark));
+
+	/**
+	 * Server side of a local multi client soak. Spawns replicated NPC characters spread over several grid
+	 * cells, walks a share of them in circles and leaves the rest idle to go dormant, then every interval logs
+	 * the replication graph's net tick time and the bytes per second sent to each connection, grouped by how
+	 * many clients were connected. Start a listen or dedicated server, run this, then join clients one at a time:
+	 *	UE4Editor Rebellion ThirdPersonExampleMap?listen -game -nullrhi -nosound -log
+	 *	UE4Editor Rebellion 127.0.0.1 -game -nullrhi -nosound -log (once per client)
+	 * Multiplayer PIE with several clients works too. Writes Saved/Profiling/Rebellion/NetSoak_<date>.json when done.
+	 */
+	class FNetSoakBenchmark : public FFrameBenchmark
+	{
+	public:
+		FNetSoakBenchmark(UWorld* inWorld, int32 inNpcCount, int32 inMovingPercent, float inSpacing, int32 inSeconds, int32 inInterval)
+			: FFrameBenchmark(inWorld, TEXT("NetSoak"))
+			, movingPercent(FMath::Clamp(inMovingPercent, 0, 100))
+			, soakSeconds(FMath::Max(inSeconds, 1))
+			, intervalSeconds(FMath::Max(inInterval, 1))
+		{
+			bLogJson = true;
+			SpawnNpcs(FMath::Max(inNpcCount, 0), FMath::Max(inSpacing, 100.f));
+		}
+
+		virtual ~FNetSoakBenchmark()
+		{
+			DestroyNpcs();
+		}
+
+		virtual bool IsFinished() const override { return bFinished || !world.IsValid(); }
+
+	private:
+
+		/** Intervals measured at one client count */
+		struct FClientBucket
+		{
+			int32 intervals = 0;
+			double netTickMs = 0.0;
+			double netTickMaxMs = 0.0;
+			double outBytesPerConnection = 0.0;
+			int32 outBytesMaxConnection = 0;
+			double inBytesPerConnection = 0.0;
+			double dormant = 0.0;
+		};
+
+		void SpawnNpcs(int32 count, float spacing)
+		{
+			UWorld* spawnWorld = world.Get();
+			TSubclassOf<APawn> npcClass = ARebellionCharacter::StaticClass();
+			AGameModeBase* gameMode = spawnWorld->GetAuthGameMode();
+			if (gameMode && gameMode->DefaultPawnClass && gameMode->DefaultPawnClass->IsChildOf(ARebellionCharacter::StaticClass()))
+			{
+				npcClass = gameMode->DefaultPawnClass;
+			}
+
+			FActorSpawnParameters spawnParams;
+			spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+			//Spread wide enough that clients standing at the origin only gather some of the cells
+			const int32 gridSize = FMath::CeilToInt(FMath::Sqrt((float)count));
+			for (int32 index = 0; index < count; index++)
+			{
+				const FVector location((index % gridSize - gridSize / 2) * spacing, (index / gridSize - gridSize / 2) * spacing, 200.f);
+				APawn* npc = spawnWorld->SpawnActor<APawn>(npcClass, location, FRotator::ZeroRotator, spawnParams);
+				if (npc)
+				{
+					//Character movement only simulates with a controller
+					npc->SpawnDefaultController();
+					npcs.Add(npc);
+				}
+			}
+			UE_LOG(LogRebellion, Display, TEXT("NetSoak spawned %d NPCs, %d%% moving, %.0fcm apart"), npcs.Num(), movingPercent, spacing);
+		}
+
+		void DestroyNpcs()
+		{
+			for (const TWeakObjectPtr<APawn>& npc : npcs)
+			{
+				if (npc.IsValid())
+				{
+					if (AController* controller = npc->GetController())
+					{
+						controller->Destroy();
+					}
+					npc->Destroy();
+				}
+			}
+			npcs.Reset();
+		}
+
+		virtual void Step(UWorld& tickWorld, float deltaSeconds) override
+		{
+			elapsedSeconds += deltaSeconds;
+			intervalElapsed += deltaSeconds;
+
+			//The first movingPercent of every hundred walk in circles, the rest stand still
+			for (int32 index = 0; index < npcs.Num(); index++)
+			{
+				APawn* npc = npcs[index].Get();
+				if (npc && index % 100 < movingPercent)
+				{
+					const float heading = elapsedSeconds * 0.5f + index;
+					npc->AddMovementInput(FVector(FMath::Cos(heading), FMath::Sin(heading), 0.f));
+				}
+			}
+
+			//This frame's net tick has not run yet, the graph still holds the previous one
+			if (const URebellionReplicationGraph* graph = GetGraph())
+			{
+				intervalNetTickMs += graph->GetLastReplicateMs();
+				intervalNetTickMaxMs = FMath::Max(intervalNetTickMaxMs, graph->GetLastReplicateMs());
+				intervalFrames++;
+			}
+
+			if (intervalElapsed >= intervalSeconds)
+			{
+				SampleInterval();
+				intervalElapsed = 0.f;
+				intervalNetTickMs = 0.0;
+				intervalNetTickMaxMs = 0.0;
+				intervalFrames = 0;
+			}
+
+			if (elapsedSeconds >= soakSeconds)
+			{
+				bFinished = true;
+			}
+		}
+
+		URebellionReplicationGraph* GetGraph() const
+		{
+			UNetDriver* netDriver = world.IsValid() ? world->GetNetDriver() : nullptr;
+			return netDriver ? Cast<URebellionReplicationGraph>(netDriver->GetReplicationDriver()) : nullptr;
+		}
+
+		void SampleInterval()
+		{
+			UNetDriver* netDriver = world->GetNetDriver();
+			if (!netDriver)
+			{
+				return;
+			}
+
+			//Connection rates are refreshed once a second by the net driver
+			const TArray<UNetConnection*>& connections = netDriver->ClientConnections;
+			int64 outBytes = 0;
+			int64 inBytes = 0;
+			int32 outBytesMax = 0;
+			for (const UNetConnection* connection : connections)
+			{
+				outBytes += connection->OutBytesPerSecond;
+				inBytes += connection->InBytesPerSecond;
+				outBytesMax = FMath::Max(outBytesMax, connection->OutBytesPerSecond);
+			}
+
+			const URebellionReplicationGraph* graph = GetGraph();
+			const int32 clients = connections.Num();
+			const double netTickMs = intervalFrames > 0 ? intervalNetTickMs / intervalFrames : 0.0;
+			const double outPerConnection = clients > 0 ? (double)outBytes / clients : 0.0;
+			const double inPerConnection = clients > 0 ? (double)inBytes / clients : 0.0;
+			const int32 dormant = graph ? graph->GetDormantCount() : 0;
+
+			FClientBucket& bucket = buckets.FindOrAdd(clients);
+			bucket.intervals++;
+			bucket.netTickMs += netTickMs;
+			bucket.netTickMaxMs = FMath::Max(bucket.netTickMaxMs, intervalNetTickMaxMs);
+			bucket.outBytesPerConnection += outPerConnection;
+			bucket.outBytesMaxConnection = FMath::Max(bucket.outBytesMaxConnection, outBytesMax);
+			bucket.inBytesPerConnection += inPerConnection;
+			bucket.dormant += dormant;
+
+			UE_LOG(LogRebellion, Display, TEXT("NetSoak clients=%d netTick=%.3fms (max %.3fms) out/connection=%.0fB/s (max %dB/s) in/connection=%.0fB/s dormant=%d/%d%s"),
+				clients,
+				netTickMs,
+				intervalNetTickMaxMs,
+				outPerConnection,
+				outBytesMax,
+				inPerConnection,
+				dormant,
+				npcs.Num(),
+				graph ? TEXT("") : TEXT(" (no replication graph, net tick not timed)"));
+		}
+
+		virtual void FinishRun(FJsonObject& report) override
+		{
+			buckets.KeySort(TLess<int32>());
+
+			TArray<TSharedPtr<FJsonValue>> rows;
+			for (const TPair<int32, FClientBucket>& pair : buckets)
+			{
+				const FClientBucket& bucket = pair.Value;
+				TSharedRef<FJsonObject> row = MakeShared<FJsonObject>();
+				row->SetNumberField(TEXT("clients"), pair.Key);
+				row->SetNumberField(TEXT("intervals"), bucket.intervals);
+				row->SetNumberField(TEXT("netTickMs"), bucket.netTickMs / bucket.intervals);
+				row->SetNumberField(TEXT("netTickMaxMs"), bucket.netTickMaxMs);
+				row->SetNumberField(TEXT("outBytesPerSecondPerConnection"), bucket.outBytesPerConnection / bucket.intervals);
+				row->SetNumberField(TEXT("outBytesPerSecondMaxConnection"), bucket.outBytesMaxConnection);
+				row->SetNumberField(TEXT("inBytesPerSecondPerConnection"), bucket.inBytesPerConnection / bucket.intervals);
+				row->SetNumberField(TEXT("dormantNpcs"), bucket.dormant / bucket.intervals);
+				rows.Add(MakeShared<FJsonValueObject>(row));
+			}
+
+			report.SetNumberField(TEXT("netMode"), (int32)world->GetNetMode());
+			report.SetBoolField(TEXT("replicationGraph"), GetGraph() != nullptr);
+			report.SetNumberField(TEXT("npcs"), npcs.Num());
+			report.SetNumberField(TEXT("movingPercent"), movingPercent);
+			report.SetNumberField(TEXT("seconds"), soakSeconds);
+			report.SetArrayField(TEXT("clients"), rows);
+			DestroyNpcs();
+		}
+
+		TArray<TWeakObjectPtr<APawn>> npcs;
+		int32 movingPercent;
+		int32 soakSeconds;
+		int32 intervalSeconds;
+		bool bFinished = false;
+
+		float elapsedSeconds = 0.f;
+		float intervalElapsed = 0.f;
+		double intervalNetTickMs = 0.0;
+		double intervalNetTickMaxMs = 0.0;
+		int32 intervalFrames = 0;
+		//Sorted by client count for the report
+		TMap<int32, FClientBucket> buckets;
+	};
+
+	static void StartNetSoakBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world)
+		{
+			return;
+		}
+		if (world->GetNetMode() != NM_ListenServer && world->GetNetMode() != NM_DedicatedServer)
+		{
+			UE_LOG(LogRebellion, Warning, TEXT("Rebellion.Bench.NetSoak runs on the server, open the map with ?listen or run a dedicated server"));
+			return;
+		}
+		if (args.Contains(TEXT("stop")))
+		{
+			frameBenchmark.Reset();
+			return;
+		}
+		if (IsFrameBenchmarkRunning())
+		{
+			return;
+		}
+
+		TArray<int32> unusedValues;
+		const int32 npcs = ParseArgs(args, TEXT("npcs"), 200, unusedValues);
+		const int32 moving = ParseArgs(args, TEXT("moving"), 25, unusedValues);
+		const int32 spacing = ParseArgs(args, TEXT("spacing"), 1000, unusedValues);
+		const int32 seconds = ParseArgs(args, TEXT("seconds"), 300, unusedValues);
+		const int32 interval = ParseArgs(args, TEXT("interval"), 5, unusedValues);
+
+		frameBenchmark.Reset();
+		frameBenchmark = MakeUnique<FNetSoakBenchmark>(world, npcs, moving, (float)spacing, seconds, interval);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchNetSoakCommand(
+		TEXT("Rebellion.Bench.NetSoak"),
+		TEXT("On a server, spawns replicated NPCs and logs net tick time and bytes per connection by client count, then writes JSON to Saved/Profiling/Rebellion. Args: [npcs=200] [moving=25] [spacing=1000] [seconds=300] [interval=5] [stop]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartNetSoakBenchmark));
+
+	static void StartBotBenchmark(const TArray<FString>& args, UWorld* world)
+	{
+		URebellionBenchmarkSubsystem* benchmark = world ? world->GetSubsystem<URebellionBenchmarkSubsystem>() : nullptr;
+		if (!benchmark)
+		{
+			return;
+		}
+
+		TArray<int32> botCounts;
+		FRebellionBenchmarkSettings settings;
+		settings.frames = ParseArgs(args, TEXT("frames"), settings.frames, botCounts);
+		settings.warmupFrames = ParseArgs(args, TEXT("warmup"), settings.warmupFrames, botCounts);
+		if (botCounts.Num() > 0)
+		{
+			settings.botCount = botCounts[0];
+		}
+		benchmark->StartBenchmark(settings);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs benchmarkCommand(
+		TEXT("Rebellion.Benchmark"),
+		TEXT("Spawns scripted bots and writes frame time percentiles as JSON to Saved/Profiling/Rebellion. Args: [bots=50] [frames=600] [warmup=60]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartBotBenchmark));
+}
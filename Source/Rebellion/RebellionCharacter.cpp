@@ -1,25 +1,59 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "RebellionCharacter.h"
+#include "CombatSubsystem.h"
+#include "CombatAudioSubsystem.h"
+#include "CombatDataSubsystem.h"
+#include "CombatReplaySubsystem.h"
+#include "RebellionSignificanceSubsystem.h"
+#include "EnemyCrowdManager.h"
+#include "LagCompensationSubsystem.h"
+#include "RebellionCharacterMovementComponent.h"
+#include "RebellionLog.h"
+#include "RebellionStats.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "SkeletalMeshComponentBudgeted.h"
 #include "Components/BoxComponent.h"
+#include "Animation/AnimInstance.h"
+#include "Engine/CollisionProfile.h"
 #include "Components/InputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "TimerManager.h"
-#include "UObject/ConstructorHelpers.h"
+#include "Animation/AnimMontage.h"
+#include "Engine/AssetManager.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StreamableManager.h"
 #include "Math/Vector.h"
+#include "Net/UnrealNetwork.h"
 
+//Socket the weapon box snaps to and the sweeps sample
+static const FName weaponSocketName(TEXT("hand_r_weapon"));
+
+//Furthest the server fast forwards an owning client's attack, its clock trails ours by half its round trip
+static const float maxAttackCatchUpSeconds = 0.5f;
+
+//Weapon hit claims the server looks at per swing, rejected ones included, so spamming can't buy rewinds
+static const int32 maxWeaponClaimsPerSwing = 16;
+
+static_assert((int32)EAttackType::COUNT <= (1 << FRebellionCombatState::AttackTypeBits), "EAttackType must fit its bits in FRebellionCombatState");
+static_assert((int32)EAttackWindowState::RECOVERY < (1 << FRebellionCombatState::WindowStateBits), "EAttackWindowState must fit its bits in FRebellionCombatState");
 
 
 
 //////////////////////////////////////////////////////////////////////////
 // ARebellionCharacter
 
-ARebellionCharacter::ARebellionCharacter()
+FName ARebellionCharacter::CameraBoomName(TEXT("CameraBoom"));
+FName ARebellionCharacter::FollowCameraName(TEXT("FollowCamera"));
+
+ARebellionCharacter::ARebellionCharacter(const FObjectInitializer& ObjectInitializer)
+	//Budgeted mesh so the animation budget allocator can time slice its evaluation
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<USkeletalMeshComponentBudgeted>(ACharacter::MeshComponentName)
+		.SetDefaultSubobjectClass<URebellionCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -40,15 +74,30 @@ ARebellionCharacter::ARebellionCharacter()
 	GetCharacterMovement()->AirControl = 0.2f;
 
 	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
-	CameraBoom->SetupAttachment(RootComponent);
-	CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
-	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+	//Optional, AI variants skip the boom and camera through DoNotCreateDefaultSubobject
+	CameraBoom = CreateOptionalDefaultSubobject<USpringArmComponent>(CameraBoomName);
+	if (CameraBoom)
+	{
+		CameraBoom->SetupAttachment(RootComponent);
+		CameraBoom->TargetArmLength = 300.0f; // The camera follows at this distance behind the character	
+		CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
+	}
 
 	// Create a follow camera
-	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
-	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	FollowCamera = CreateOptionalDefaultSubobject<UCameraComponent>(FollowCameraName);
+	if (FollowCamera)
+	{
+		// Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
+		if (CameraBoom)
+		{
+			FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
+		}
+		else
+		{
+			FollowCamera->SetupAttachment(RootComponent);
+		}
+		FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
+	}
 
 	//MH Added
 	//Jumping variable adjuster
@@ -57,38 +106,24 @@ ARebellionCharacter::ARebellionCharacter()
 	walkSpeed = 600;
 	sprintSpeed = 900;
 	//Dashing adjusters
-	bCanDash = true;
 	dashDistance = 1000;
 	dashCooldown = 1;
 	dashStopTimer = 0.1;
 
-	//Load melee attack data table
-	static ConstructorHelpers::FObjectFinder<UDataTable> playerAttackMontageObject(TEXT("DataTable'/Game/DataTables/PlayerAttackMontageDataTable.PlayerAttackMontageDataTable'"));
-	if (playerAttackMontageObject.Succeeded()) 
-	{
-		//if the object is loaded, get the object that was loaded
-		playerAttackDataTable = playerAttackMontageObject.Object;
-	}
-
-	//Load sounds cue object
-	static ConstructorHelpers::FObjectFinder<USoundCue> SwordSoundCueObject(TEXT("SoundCue'/Game/Audio/Player/SwordSwooshSoundCue.SwordSwooshSoundCue'"));
-	if (SwordSoundCueObject.Succeeded()) 
-	{
-		//if sound object is loaded, get object that was loaded
-		SwordSoundCue = SwordSoundCueObject.Object;
-
-		//Instantiate SwordAudioComponent and attach to player
-		SwordAudioComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("SwordAudioComponent"));
-		SwordAudioComponent->SetupAttachment(RootComponent);
-
-	}
+	//Melee attack data table and sound cue, only the paths here. Loaded in BeginPlay if the game mode hasn't already
+	playerAttackDataTable = TSoftObjectPtr<UDataTable>(FSoftObjectPath(TEXT("/Game/DataTables/PlayerAttackMontageDataTable.PlayerAttackMontageDataTable")));
+	SwordSoundCue = TSoftObjectPtr<USoundCue>(FSoftObjectPath(TEXT("/Game/Audio/Player/SwordSwooshSoundCue.SwordSwooshSoundCue")));
 
 	//Creates collision box
 	primaryWeaponCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("MeleeCollisionBox"));
 	primaryWeaponCollisionBox->SetupAttachment(RootComponent);
-	//Reference to Engine-Collision profiles
-	primaryWeaponCollisionBox->SetCollisionProfileName("NoCollision");
+	//Reference to Engine-Collision profiles. The box keeps the weapon object type and one query only
+	//body for its whole life, attack windows only swap its channel responses
+	primaryWeaponCollisionBox->SetCollisionProfileName(meleeCollisionProfile.enabled);
+	primaryWeaponCollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	primaryWeaponCollisionBox->SetCollisionResponseToAllChannels(ECR_Ignore);
 	primaryWeaponCollisionBox->SetNotifyRigidBodyCollision(false);
+	primaryWeaponCollisionBox->SetGenerateOverlapEvents(false);
 
 	//TODO: Method to handle shooting and use this
 	//rangedWeaponCollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("RangedCollisionBox"));
@@ -102,14 +137,123 @@ void ARebellionCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	primaryWeaponCollisionBox->OnComponentHit.AddDynamic(this, &ARebellionCharacter::OnAttackHit);
-	/*primaryWeaponCollisionBox->OnComponentBeginOverlap.AddDynamic(this, &ARebellionCharacter::OnAttackOverlapBegin);
-	primaryWeaponCollisionBox->OnComponentEndOverlap.AddDynamic(this, &ARebellionCharacter::OnAttackOverlapEnd);*/
+	ResolveWeaponCollisionResponses();
+	health = maxHealth;
+
+	const FCombatDataPack* pack = GetCombatPack();
+	if (const FCombatPackProfile* packProfile = FindCombatPackProfile(pack))
+	{
+		const FCombatPackMovement& movement = packProfile->movement;
+		jumpHeight = movement.jumpHeight;
+		walkSpeed = movement.walkSpeed;
+		sprintSpeed = movement.sprintSpeed;
+		dashDistance = movement.dashDistance;
+		dashCooldown = movement.dashCooldown;
+		dashStopTimer = movement.dashStopTimer;
+	}
+
+	URebellionCharacterMovementComponent* rebellionMovement = GetRebellionMovement();
+	rebellionMovement->MaxWalkSpeed = walkSpeed;
+	rebellionMovement->sprintSpeed = sprintSpeed;
+	rebellionMovement->ConfigureDash(dashDistance, dashStopTimer, dashCooldown);
+
+	//Already resident when the game mode preloaded them, the callback then runs straight away
+	TArray<FSoftObjectPath> combatAssetPaths;
+	GetCombatAssetPaths(pack, combatAssetPaths);
+	if (combatAssetPaths.Num() > 0)
+	{
+		combatAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(combatAssetPaths, FStreamableDelegate::CreateUObject(this, &ARebellionCharacter::OnCombatAssetsLoaded));
+	}
+
+	if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+	{
+		combat->RegisterPawn(this);
+	}
+	if (URebellionSignificanceSubsystem* significance = GetWorld()->GetSubsystem<URebellionSignificanceSubsystem>())
+	{
+		significance->RegisterCharacter(this);
+	}
+	if (ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		lagCompensation->RegisterCharacter(this, primaryWeaponCollisionBox, weaponSocketName);
+	}
+
+	UpdateCombatState();
+	INC_DWORD_STAT(STAT_Rebellion_Characters);
+}
+
+void ARebellionCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT(STAT_Rebellion_Characters);
+
+	//Closes an open window so the combat subsystem stops sweeping for us
+	attackInputBuffer.Reset();
+	EAttackWindowState previousWindowState;
+	if (attackWindow.Stop(previousWindowState))
+	{
+		OnAttackWindowChanged(previousWindowState);
+	}
+
+	if (combatAssetsHandle.IsValid())
+	{
+		if (combatAssetsHandle->IsLoadingInProgress())
+		{
+			combatAssetsHandle->CancelHandle();
+		}
+		else
+		{
+			combatAssetsHandle->ReleaseHandle();
+		}
+		combatAssetsHandle.Reset();
+	}
+
+	if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+	{
+		combat->UnregisterPawn(this);
+	}
+	if (URebellionSignificanceSubsystem* significance = GetWorld()->GetSubsystem<URebellionSignificanceSubsystem>())
+	{
+		significance->UnregisterCharacter(this);
+	}
+	if (ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		lagCompensation->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ARebellionCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ARebellionCharacter, combatState);
+}
+
+void ARebellionCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+
+	if (!HasAuthority())
+	{
+		return;
+	}
 
-	if (SwordAudioComponent && SwordSoundCue)
+	//The cooldown starts as a dash ends, its end tick stays put while it runs down
+	const float cooldownRemaining = GetRebellionMovement()->GetDashCooldownRemaining();
+	if (PrevMovementMode == MOVE_Custom && PreviousCustomMode == (uint8)ERebellionMovementMode::DASH && cooldownRemaining > 0.f)
 	{
-		SwordAudioComponent->SetSound(SwordSoundCue);
+		const float now = ULagCompensationSubsystem::GetNetworkTime(GetWorld());
+		//0 means no cooldown, an end landing on it is a tick late instead
+		combatState.dashCooldownEndTick = FMath::Max(FRebellionCombatState::ToNetTick(now + cooldownRemaining), (uint16)1);
+		GetWorldTimerManager().SetTimer(dashCooldownTimer, this, &ARebellionCharacter::OnDashCooldownEnded, cooldownRemaining, false);
 	}
+	UpdateCombatState();
+}
+
+void ARebellionCharacter::OnDashCooldownEnded()
+{
+	combatState.dashCooldownEndTick = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -155,6 +299,12 @@ void ARebellionCharacter::SetupPlayerInputComponent(class UInputComponent* Playe
 	PlayerInputComponent->BindAction("Sprint", IE_Pressed, this, &ARebellionCharacter::Sprint);
 	PlayerInputComponent->BindAction("Sprint", IE_Released, this, &ARebellionCharacter::Walk);
 	PlayerInputComponent->BindAction("Dash", IE_Pressed, this, &ARebellionCharacter::DashStart);
+
+	//Logged while a combat replay records
+	if (UCombatReplaySubsystem* replay = GetWorld()->GetSubsystem<UCombatReplaySubsystem>())
+	{
+		replay->WrapPlayerInput(this, PlayerInputComponent);
+	}
 }
 
 void ARebellionCharacter::Landed(const FHitResult& hit)
@@ -178,100 +328,284 @@ void ARebellionCharacter::DoubleJump()
 //MH Added *Change Sprinting speed
 void ARebellionCharacter::Sprint() 
 {
-	GetCharacterMovement()->MaxWalkSpeed = sprintSpeed;	
+	GetRebellionMovement()->SetWantsToSprint(true);
 }
 
 //MH Added *Change Walking speed
 void ARebellionCharacter::Walk()
 {
-	GetCharacterMovement()->MaxWalkSpeed = walkSpeed;
+	GetRebellionMovement()->SetWantsToSprint(false);
 }
 
-//MH added
-void ARebellionCharacter::AttackInput(EAttackType attackType) 
+URebellionCharacterMovementComponent* ARebellionCharacter::GetRebellionMovement() const
+{
+	return CastChecked<URebellionCharacterMovementComponent>(GetCharacterMovement());
+}
+
+bool ARebellionCharacter::IsDashing() const
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
+	return GetLocalRole() == ROLE_SimulatedProxy ? combatState.bDashing : GetRebellionMovement()->IsDashing();
+}
 
-	if (playerAttackDataTable)
+float ARebellionCharacter::GetDashCooldownRemaining() const
+{
+	if (GetLocalRole() != ROLE_SimulatedProxy)
 	{
-		static const FString contextString(TEXT("Player Attack Montage Context"));
-		FName attackRowKey;
+		return GetRebellionMovement()->GetDashCooldownRemaining();
+	}
+	if (combatState.dashCooldownEndTick == 0)
+	{
+		return 0.f;
+	}
+	//An end tick that arrived late can't be more than a whole cooldown away
+	const uint16 nowTick = FRebellionCombatState::ToNetTick(ULagCompensationSubsystem::GetNetworkTime(GetWorld()));
+	return FMath::Clamp(FRebellionCombatState::GetTickSeconds(nowTick, combatState.dashCooldownEndTick), 0.f, dashCooldown);
+}
 
-		//Attach collision component to sockets based on transformation definitions
-		const FAttachmentTransformRules AttachmentRules(EAttachmentRule::SnapToTarget, EAttachmentRule::SnapToTarget, EAttachmentRule::KeepWorld, false);
+//Row keys in PlayerAttackMontageDataTable, indexed by the melee EAttackTypes
+static const FName attackRowKeys[] = { FName(TEXT("PrimaryAttack")), FName(TEXT("SecondaryAttack")) };
+static_assert(UE_ARRAY_COUNT(attackRowKeys) == meleeAttackCount, "Every melee EAttackType needs a data table row key");
 
-		currentAttack = attackType;
+const FCombatDataPack* ARebellionCharacter::GetCombatPack() const
+{
+	const UGameInstance* gameInstance = GetGameInstance();
+	const UCombatDataSubsystem* combatData = gameInstance ? gameInstance->GetSubsystem<UCombatDataSubsystem>() : nullptr;
+	return combatData ? combatData->GetPack() : nullptr;
+}
 
-		switch (attackType)
+const FCombatPackProfile* ARebellionCharacter::FindCombatPackProfile(const FCombatDataPack* pack) const
+{
+	//Subclasses and other Blueprints keep their own tuning and data table unless the pack has them too
+	return pack ? pack->FindProfile(GetClass()->GetPathName()) : nullptr;
+}
+
+void ARebellionCharacter::GetCombatAssetPaths(const FCombatDataPack* pack, TArray<FSoftObjectPath>& outPaths) const
+{
+	if (const FCombatPackProfile* packProfile = FindCombatPackProfile(pack))
+	{
+		//The table itself isn't needed, only the montages its rows point at
+		for (const FName& rowKey : attackRowKeys)
 		{
-		case EAttackType::MELEE_PRIMARY:
-			attackRowKey = FName(TEXT("PrimaryAttack"));
+			if (const FCombatPackAttack* attack = pack->FindAttack(*packProfile, rowKey))
+			{
+				outPaths.Add(FSoftObjectPath(UTF8_TO_TCHAR(pack->GetString(attack->montagePathOffset))));
+			}
+		}
+	}
+	else if (!playerAttackDataTable.IsNull())
+	{
+		outPaths.Add(playerAttackDataTable.ToSoftObjectPath());
+	}
+	if (!SwordSoundCue.IsNull())
+	{
+		outPaths.Add(SwordSoundCue.ToSoftObjectPath());
+	}
+}
 
-			//Attach box to mesh on socket based on attachmentRules
-			primaryWeaponCollisionBox->AttachToComponent(GetMesh(), AttachmentRules, "hand_r_weapon");
+void ARebellionCharacter::OnCombatAssetsLoaded()
+{
+	const FCombatDataPack* pack = GetCombatPack();
+	if (const FCombatPackProfile* packProfile = FindCombatPackProfile(pack))
+	{
+		BuildAttackMontageCacheFromPack(*pack, *packProfile);
+		return;
+	}
 
-			isKeyboardEnabled = true;
-			isAnimationBlended = false;
-			break;
+	if (!playerAttackDataTable.Get())
+	{
+		REB_LOG(WARNING, "%s could not load %s, attacks are disabled", *GetName(), *playerAttackDataTable.ToString());
+	}
+	BuildAttackMontageCache();
+}
 
-		case EAttackType::MELEE_SECONDARY:
-			attackRowKey = FName(TEXT("SecondaryAttack"));
-			
-			isKeyboardEnabled = false;
-			isAnimationBlended = false;
-			break;
+void ARebellionCharacter::BuildAttackMontageCacheFromPack(const FCombatDataPack& pack, const FCombatPackProfile& packProfile)
+{
+	attackMontageCache.Reset();
+	attackMontageCache.SetNum(meleeAttackCount);
 
-		default:
-			isAnimationBlended = true;
-			break;
+	for (int32 attackIndex = 0; attackIndex < meleeAttackCount; attackIndex++)
+	{
+		const FCombatPackAttack* attack = pack.FindAttack(packProfile, attackRowKeys[attackIndex]);
+		if (!attack)
+		{
+			continue;
 		}
 
-		attackMontage = playerAttackDataTable->FindRow<FPlayerAttackMontage>(attackRowKey, contextString, true);
+		//Loaded by combatAssetsHandle, this only resolves the path
+		FAttackMontageCacheEntry& entry = attackMontageCache[attackIndex];
+		entry.montage = Cast<UAnimMontage>(FSoftObjectPath(UTF8_TO_TCHAR(pack.GetString(attack->montagePathOffset))).ResolveObject());
+		entry.damage = attack->damage;
 
-		if (attackMontage)
+		const TArrayView<const FCombatPackSection> sections = pack.GetSections(*attack);
+		entry.sectionNames.Reserve(sections.Num());
+		entry.nextSteps.Reserve(sections.Num());
+		for (const FCombatPackSection& section : sections)
 		{
-			if (montageSectionIndex > 3)
-			{
-				montageSectionIndex = 1;
-			}
-			FString montageSection = "start_" + FString::FromInt(montageSectionIndex);
-			PlayAnimMontage(attackMontage->montage, 1.0f, FName(montageSection));
+			entry.sectionNames.Add(FName(UTF8_TO_TCHAR(pack.GetString(section.nameOffset))));
+			entry.nextSteps.Add(sections.IsValidIndex(section.nextStep) ? section.nextStep : 0);
 		}
-		montageSectionIndex++;
 	}
+}
 
-	
-	////Add statement for air attack here**
-	//if (GetCharacterMovement()->IsFalling())
-	//{
-	//	FString montageSection = "start_3";
-	//	PlayAnimMontage(SwordAttackMontage, 1.0f, FName(*montageSection));
-	//}
-	//else if (montageSectionIndex > 3 && !GetCharacterMovement()->IsFalling()) 
-	//{
-	//	montageSectionIndex = 1;
-
-	//	FString montageSection = "start_" + FString::FromInt(montageSectionIndex);
-
-	//	PlayAnimMontage(SwordAttackMontage, 1.0f, FName(*montageSection));
-	//	montageSectionIndex++;
-	//}
-	//else 
-	//{
-	//	//string reference for animation section
-	//	FString montageSection = "start_" + FString::FromInt(montageSectionIndex);
-
-	//	PlayAnimMontage(SwordAttackMontage, 1.0f, FName(*montageSection));
-	//	montageSectionIndex++;
-	//}
-	//
-	////Plays sound if audio is not currently playing and SwordAudioComponent exists
-	//if (SwordAudioComponent && !SwordAudioComponent->IsPlaying())
-	//{
-	//	//default pitch volume is 1.0f
-	//	SwordAudioComponent->SetPitchMultiplier(FMath::RandRange(1.0f, 1.4f));
-	//	SwordAudioComponent->Play(0.0f);
-	//}
+void ARebellionCharacter::BuildAttackMontageCache()
+{
+	attackMontageCache.Reset();
+	attackMontageCache.SetNum(meleeAttackCount);
+
+	const UDataTable* attackTable = playerAttackDataTable.Get();
+	if (!attackTable)
+	{
+		return;
+	}
+
+	static const FString contextString(TEXT("Player Attack Montage Context"));
+
+	for (int32 attackIndex = 0; attackIndex < meleeAttackCount; attackIndex++)
+	{
+		const FPlayerAttackMontage* row = attackTable->FindRow<FPlayerAttackMontage>(attackRowKeys[attackIndex], contextString, true);
+		if (!row || !row->montage)
+		{
+			continue;
+		}
+
+		FAttackMontageCacheEntry& entry = attackMontageCache[attackIndex];
+		entry.montage = row->montage;
+		entry.damage = row->damage > 0.f ? row->damage : defaultAttackDamage;
+
+		//Older rows were authored without a section count, the montages have always had 3
+		const int32 sectionCount = row->animSectionCount > 0 ? row->animSectionCount : 3;
+		entry.sectionNames.Reserve(sectionCount);
+		entry.nextSteps.Reserve(sectionCount);
+		for (int32 section = 1; section <= sectionCount; section++)
+		{
+			entry.sectionNames.Add(FName(*FString::Printf(TEXT("start_%d"), section)));
+			//Combos loop back to the first step
+			entry.nextSteps.Add(section % sectionCount);
+		}
+	}
+}
+
+//MH added
+void ARebellionCharacter::AttackInput(EAttackType attackType, uint64 pressCycles) 
+{
+	REBELLION_SCOPE(AttackInput);
+	INC_DWORD_STAT(STAT_Rebellion_AttackInputCalls);
+	REB_LOG(INFO, "AttackInput");
+
+	if (!attackMontageCache.IsValidIndex((int32)attackType))
+	{
+		return;
+	}
+
+	const int32 step = GetNextComboStep(attackType);
+	const uint16 startTick = FRebellionCombatState::ToNetTick(ULagCompensationSubsystem::GetNetworkTime(GetWorld()));
+	if (!PlayAttack(attackType, step, 0.f, pressCycles) || GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	//Everyone else plays it from the tick it started at
+	FRebellionAttackEvent attackEvent;
+	attackEvent.attackType = (uint8)attackType;
+	attackEvent.comboStep = GetNetAttackSection();
+	attackEvent.startTick = startTick;
+	if (HasAuthority())
+	{
+		attackStartTick = startTick;
+		UpdateCombatState();
+		MulticastAttack(attackEvent);
+	}
+	else if (IsLocallyControlled())
+	{
+		ServerAttack(attackEvent);
+	}
+}
+
+bool ARebellionCharacter::PlayAttack(EAttackType attackType, int32 step, float elapsedSeconds, uint64 pressCycles)
+{
+	if (!attackMontageCache.IsValidIndex((int32)attackType))
+	{
+		return false;
+	}
+
+	//Swings from the network that are over by the time they arrive aren't played
+	const FAttackMontageCacheEntry& entry = attackMontageCache[(int32)attackType];
+	if (elapsedSeconds > 0.f && entry.montage && entry.sectionNames.Num() > 0)
+	{
+		const int32 sectionIndex = entry.montage->GetSectionIndex(entry.sectionNames[step % entry.sectionNames.Num()]);
+		if (sectionIndex == INDEX_NONE || elapsedSeconds >= entry.montage->GetSectionLength(sectionIndex))
+		{
+			return false;
+		}
+	}
+
+	//Attach collision component to sockets based on transformation definitions
+	const FAttachmentTransformRules AttachmentRules(EAttachmentRule::SnapToTarget, EAttachmentRule::SnapToTarget, EAttachmentRule::KeepWorld, false);
+
+	//A new attack replaces the current one, closing its window if it is still open
+	comboStep = step;
+	EAttackWindowState previousWindowState;
+	if (attackWindow.StartAttack(previousWindowState))
+	{
+		OnAttackWindowChanged(previousWindowState);
+	}
+	currentAttack = attackType;
+
+	switch (attackType)
+	{
+	case EAttackType::MELEE_PRIMARY:
+		//Attach box to mesh on socket based on attachmentRules
+		primaryWeaponCollisionBox->AttachToComponent(GetMesh(), AttachmentRules, weaponSocketName);
+
+		isKeyboardEnabled = true;
+		isAnimationBlended = false;
+		break;
+
+	case EAttackType::MELEE_SECONDARY:
+		isKeyboardEnabled = false;
+		isAnimationBlended = false;
+		break;
+
+	default:
+		isAnimationBlended = true;
+		break;
+	}
+
+	float montageLength = 0.f;
+	if (entry.montage && entry.sectionNames.Num() > 0)
+	{
+		//The montage this replaces blends out in here, its delegate still has the previous serial
+		montageLength = PlayAnimMontage(entry.montage, 1.0f, entry.sectionNames[comboStep % entry.sectionNames.Num()]);
+	}
+
+	UAnimInstance* animInstance = GetMesh()->GetAnimInstance();
+	if (montageLength <= 0.f || !animInstance)
+	{
+		if (attackWindow.Stop(previousWindowState))
+		{
+			OnAttackWindowChanged(previousWindowState);
+		}
+		return false;
+	}
+
+	//Catch up with where the attacker is in the swing
+	if (elapsedSeconds > 0.f)
+	{
+		animInstance->Montage_SetPosition(entry.montage, animInstance->Montage_GetPosition(entry.montage) + elapsedSeconds);
+	}
+
+	FOnMontageBlendingOutStarted blendingOutDelegate = FOnMontageBlendingOutStarted::CreateUObject(this, &ARebellionCharacter::OnAttackMontageBlendingOut, attackWindow.GetSerial());
+	animInstance->Montage_SetBlendingOutDelegate(blendingOutDelegate, entry.montage);
+
+	attackPressCycles = pressCycles;
+	bFirstHitRecorded = false;
+	UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	if (combat && pressCycles != 0)
+	{
+		combat->RecordInputLatency(ECombatInputLatency::INPUT_TO_MONTAGE, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - pressCycles));
+	}
+	UpdateCombatState();
+	return true;
 }
 
 EAttackType ARebellionCharacter::GetCurrentAttack()
@@ -287,177 +621,594 @@ bool ARebellionCharacter::GetIsAnimationBlended()
 void ARebellionCharacter::SetIsKeyboardEnabled(bool enabled)
 {
 	isKeyboardEnabled = enabled;
+	UpdateCombatState();
 }
 //MH added
 void ARebellionCharacter::PrimaryAttack()
 {
-	AttackInput(EAttackType::MELEE_PRIMARY);
+	BufferAttackInput(EAttackType::MELEE_PRIMARY);
 }
 
 //MH added
 void ARebellionCharacter::SecondaryAttack() 
 {
-	AttackInput(EAttackType::MELEE_SECONDARY);
+	BufferAttackInput(EAttackType::MELEE_SECONDARY);
+}
+
+void ARebellionCharacter::BufferAttackInput(EAttackType attackType)
+{
+	attackInputBuffer.Push(attackType, FPlatformTime::Cycles64());
+	ConsumeBufferedAttackInput();
+}
+
+void ARebellionCharacter::ConsumeBufferedAttackInput()
+{
+	if (bConsumingAttackInput || attackInputBuffer.IsEmpty() || !CanStartAttack())
+	{
+		return;
+	}
+
+	const uint64 now = FPlatformTime::Cycles64();
+	const uint64 maxAgeCycles = (uint64)(attackInputBufferSeconds / FPlatformTime::GetSecondsPerCycle64());
+	attackInputBuffer.DropOlderThan(now > maxAgeCycles ? now - maxAgeCycles : 0);
+
+	FBufferedAttackInput press;
+	if (attackInputBuffer.Pop(press))
+	{
+		//AttackInput changes state, which would consume again
+		TGuardValue<bool> consumingGuard(bConsumingAttackInput, true);
+		AttackInput(press.attackType, press.pressCycles);
+	}
+}
+
+bool ARebellionCharacter::CanStartAttack() const
+{
+	const EAttackWindowState windowState = attackWindow.GetState();
+	return !IsDead() && isKeyboardEnabled && (windowState == EAttackWindowState::IDLE || windowState == EAttackWindowState::RECOVERY);
+}
+
+bool ARebellionCharacter::CanAcceptClientAttack(uint16 startTick) const
+{
+	//Same rule the client's own input follows, so attacks can't come faster than the server's swing allows.
+	//Each start tick is played once, a resent or replayed event is dropped
+	const bool bNewStart = lastClientAttackTick == INDEX_NONE || FRebellionCombatState::GetTickSeconds((uint16)lastClientAttackTick, startTick) > 0.f;
+	return bNewStart && CanStartAttack();
+}
+
+int32 ARebellionCharacter::GetNextComboStep(EAttackType attackType) const
+{
+	if (!attackMontageCache.IsValidIndex((int32)attackType))
+	{
+		return 0;
+	}
+
+	//Chaining from the combo window follows the combo graph, anything else starts it over
+	const FAttackMontageCacheEntry& entry = attackMontageCache[(int32)attackType];
+	const bool bChained = attackWindow.GetState() == EAttackWindowState::RECOVERY && attackType == currentAttack;
+	return bChained && entry.nextSteps.IsValidIndex(comboStep) ? entry.nextSteps[comboStep] : 0;
+}
+
+void ARebellionCharacter::RecordFirstHitLatency()
+{
+	if (bFirstHitRecorded || attackPressCycles == 0)
+	{
+		return;
+	}
+	bFirstHitRecorded = true;
+	if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+	{
+		combat->RecordInputLatency(ECombatInputLatency::INPUT_TO_FIRST_HIT, FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - attackPressCycles));
+	}
 }
 
 //MH added
 void ARebellionCharacter::AttackStart()
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
-	
-	primaryWeaponCollisionBox->SetCollisionProfileName("Weapon");
-	//Sets "Simulation Generates Hit events" value
-	primaryWeaponCollisionBox->SetNotifyRigidBodyCollision(true);
-	//Sets "Generate Overlap Events" value
-	/*primaryWeaponCollisionBox->SetGenerateOverlapEvents(true);*/
+	REB_LOG(INFO, "AttackStart");
+	EAttackWindowState previousWindowState;
+	if (attackWindow.NotifyBegin(previousWindowState))
+	{
+		OnAttackWindowChanged(previousWindowState);
+	}
 }
 
 //MH Added
 void ARebellionCharacter::AttackEnd() 
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
+	REB_LOG(INFO, "AttackEnd");
 
-	primaryWeaponCollisionBox->SetCollisionProfileName("NoCollision");
-	primaryWeaponCollisionBox->SetNotifyRigidBodyCollision(false);
-	/*primaryWeaponCollisionBox->SetGenerateOverlapEvents(false);*/
+	//The window may already be closed if its montage was interrupted before the notify ended
+	EAttackWindowState previousWindowState;
+	if (attackWindow.NotifyEnd(previousWindowState))
+	{
+		OnAttackWindowChanged(previousWindowState);
+	}
 }
 
-//MH added
-void ARebellionCharacter::OnAttackHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit) 
+void ARebellionCharacter::OnAttackMontageBlendingOut(UAnimMontage* montage, bool bInterrupted, uint32 serial)
 {
-	/*int enemyHealth = 10;
-
-	if (Hit.GetActor()->GetName() == "EnemyCube")
+	//Ignored if a newer attack replaced this montage and owns the state now
+	EAttackWindowState previousWindowState;
+	if (attackWindow.MontageBlendingOut(serial, previousWindowState))
 	{
-		enemyHealth--;
-		Log(ELogLevel::DEBUG, FString::FromInt(enemyHealth));
-	}*/
-	Log(ELogLevel::WARNING, Hit.GetActor()->GetName());
+		REB_LOG(DEBUG, "Attack montage %s %s", *GetNameSafe(montage), bInterrupted ? TEXT("interrupted") : TEXT("blending out"));
+		OnAttackWindowChanged(previousWindowState);
+	}
 }
 
-//void ARebellionCharacter::OnAttackOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult) 
-//{
-//	Log(ELogLevel::INFO, __FUNCTION__);
-//	//Log(ELogLevel::WARNING, SweepResult.GetActor()->GetName());
-//}
+void ARebellionCharacter::OnAttackWindowChanged(EAttackWindowState oldState)
+{
+	const EAttackWindowState newState = attackWindow.GetState();
+	REB_LOG(TRACE, "Attack window %d -> %d", (int32)oldState, (int32)newState);
 
-//void ARebellionCharacter::OnAttackOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
-//{
-//	Log(ELogLevel::INFO, __FUNCTION__);
-//	//Log(ELogLevel::WARNING, OtherActor->GetName());
-//}
+	UWorld* world = GetWorld();
+	UCombatSubsystem* combat = world ? world->GetSubsystem<UCombatSubsystem>() : nullptr;
+	URebellionSignificanceSubsystem* significance = world ? world->GetSubsystem<URebellionSignificanceSubsystem>() : nullptr;
 
-//MH added method for blocking
-void ARebellionCharacter::BlockStart()
+	if (oldState == EAttackWindowState::ACTIVE)
+	{
+		REBELLION_SCOPE(AttackEnd);
+		//Game thread cost per swing, the traces themselves run async and show up in stat collision
+		REB_LOG(DEBUG, "Swing: %d sweeps, %d hits, %d crowd hits, %.3f ms", swingSweepCount, swingHitActors.Num(), swingHitCrowdEnemies.Num(), FPlatformTime::ToMilliseconds64(swingSweepCycles));
+		bHasLastWeaponTransform = false;
+
+		SetWeaponCollisionActive(false);
+
+		if (combat)
+		{
+			combat->RemoveAttackWindow(this);
+		}
+		if (significance)
+		{
+			significance->SetNeverSkipAnimation(this, false);
+		}
+	}
+
+	switch (newState)
+	{
+	case EAttackWindowState::ACTIVE:
+	{
+		REBELLION_SCOPE(AttackStart);
+		INC_DWORD_STAT(STAT_Rebellion_AttackWindows);
+
+		//First SweepWeapon call only records where the swing starts
+		bHasLastWeaponTransform = false;
+		swingHitActors.Reset();
+		swingHitCrowdEnemies.Reset();
+		swingSweepCount = 0;
+		swingSweepCycles = 0;
+		swingClaimCount = 0;
+
+		//Hits come from the weapon sweeps, the box only needs to be visible to other weapons
+		SetWeaponCollisionActive(true);
+		isKeyboardEnabled = false;
+
+		if (UCombatAudioSubsystem* audio = world ? world->GetSubsystem<UCombatAudioSubsystem>() : nullptr)
+		{
+			//default pitch volume is 1.0f
+			audio->PlaySound(ECombatSound::SWOOSH, SwordSoundCue.Get(), primaryWeaponCollisionBox->GetComponentLocation(), FMath::RandRange(1.0f, 1.4f));
+		}
+
+		//Only the attacker's own machine sweeps, swings played from the network are for show and for the hitbox history
+		if (combat && IsLocallyControlled())
+		{
+			combat->AddAttackWindow(this);
+		}
+		if (significance)
+		{
+			significance->NotifyCombat(this);
+			significance->SetNeverSkipAnimation(this, true);
+		}
+		break;
+	}
+
+	case EAttackWindowState::RECOVERY:
+	case EAttackWindowState::IDLE:
+		isKeyboardEnabled = true;
+		//Combo window boundary, a press made during the attack starts the next one now
+		ConsumeBufferedAttackInput();
+		break;
+
+	default:
+		//WINDUP input lock depends on the attack type, set by PlayAttack
+		break;
+	}
+
+	UpdateCombatState();
+}
+
+void ARebellionCharacter::ResolveWeaponCollisionResponses()
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
+	UCollisionProfile* collisionProfiles = UCollisionProfile::Get();
+
+	FCollisionResponseTemplate enabledTemplate;
+	if (collisionProfiles->GetProfileTemplate(meleeCollisionProfile.enabled, enabledTemplate))
+	{
+		weaponEnabledResponses = enabledTemplate.ResponseToChannels;
+		primaryWeaponCollisionBox->SetCollisionObjectType(enabledTemplate.ObjectType);
+	}
+	else
+	{
+		REB_LOG(ERROR, "Unknown weapon collision profile %s", *meleeCollisionProfile.enabled.ToString());
+		weaponEnabledResponses = FCollisionResponseContainer(ECR_Ignore);
+	}
+
+	//A NoCollision profile can't be expressed as responses on a query body, so it means ignore everything
+	FCollisionResponseTemplate disabledTemplate;
+	if (collisionProfiles->GetProfileTemplate(meleeCollisionProfile.disabled, disabledTemplate) && disabledTemplate.CollisionEnabled != ECollisionEnabled::NoCollision)
+	{
+		weaponDisabledResponses = disabledTemplate.ResponseToChannels;
+	}
+	else
+	{
+		weaponDisabledResponses = FCollisionResponseContainer(ECR_Ignore);
+	}
+
+	bWeaponCollisionActive = false;
+	primaryWeaponCollisionBox->SetCollisionResponseToChannels(weaponDisabledResponses);
 }
 
-//MH added method for blocking
-void ARebellionCharacter::BlockEnd()
+void ARebellionCharacter::SetWeaponCollisionActive(bool bActive)
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
+	if (bWeaponCollisionActive == bActive)
+	{
+		return;
+	}
+	bWeaponCollisionActive = bActive;
+
+	//Only updates the body's query filter data
+	primaryWeaponCollisionBox->SetCollisionResponseToChannels(bActive ? weaponEnabledResponses : weaponDisabledResponses);
 }
 
-//MH Added *Removes friction and launches player based on dashDistance
-void ARebellionCharacter::DashStart()
+void ARebellionCharacter::SweepWeapon()
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
-	if (bCanDash == true)
+	REBELLION_SCOPE(SweepWeapon);
+
+	const FTransform currentWeaponTransform = GetMesh()->GetSocketTransform(weaponSocketName);
+	if (!bHasLastWeaponTransform)
 	{
-		//APlayerController player;
-		//Removes friction
-		GetCharacterMovement()->BrakingFrictionFactor = 0;
-		//Log(ELogLevel::WARNING, FVector::);
-		//launches character. Booleans set to true allow override of current velocities from XYZ
-		//GetSafeNormal sets the X and Y value to 1 so dashDistance can be consistent
-		//LaunchCharacter(FVector(addin.Inp, GetCharacterMovement(), 0).GetSafeNormal() * dashDistance, true, true);
-		bCanDash = false;
-		//This timer means we wait timer seconds and stop dashing. Boolean sets looping timer to false
-		GetWorldTimerManager().SetTimer(dashTimer, this, & ARebellionCharacter::DashStop, dashStopTimer, false);
+		lastWeaponTransform = currentWeaponTransform;
+		bHasLastWeaponTransform = true;
+		return;
+	}
+
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	const FVector halfExtent = primaryWeaponCollisionBox->GetScaledBoxExtent();
+
+	//Sample the path between the two frames so fast swings can't skip over a target
+	FVector stepStart = lastWeaponTransform.GetLocation();
+	for (int32 step = 1; step <= weaponSweepSubsteps; step++)
+	{
+		const float alpha = (float)step / (float)weaponSweepSubsteps;
+		const FVector stepEnd = FMath::Lerp(lastWeaponTransform.GetLocation(), currentWeaponTransform.GetLocation(), alpha);
+		const FQuat stepRotation = FQuat::Slerp(lastWeaponTransform.GetRotation(), currentWeaponTransform.GetRotation(), alpha);
+
+		combat->QueueWeaponSweep(this, stepStart, stepEnd, stepRotation, halfExtent);
+		swingSweepCount++;
+		stepStart = stepEnd;
 	}
+
+	lastWeaponTransform = currentWeaponTransform;
+	swingSweepCycles += FPlatformTime::Cycles64() - startCycles;
 }
 
-//MH Added *Stops dash movement, resets dash, resets player friction
-void ARebellionCharacter::DashStop()
+void ARebellionCharacter::ReceiveWeaponHits(const TArray<FHitResult>& hits)
 {
-	Log(ELogLevel::INFO, __FUNCTION__);
-	GetCharacterMovement()->StopMovementImmediately();
-	GetWorldTimerManager().SetTimer(dashTimer, this, &ARebellionCharacter::ResetDash, dashCooldown, false);
-	//Resets friction back to default value
-	GetCharacterMovement()->BrakingFrictionFactor = 2;
+	REBELLION_SCOPE(OnAttackHit);
+
+	for (const FHitResult& hit : hits)
+	{
+		AActor* hitActor = hit.GetActor();
+		//Each actor is only hit once per swing
+		if (hitActor && !swingHitActors.Contains(hitActor))
+		{
+			swingHitActors.Add(hitActor);
+			HandleWeaponHit(hit);
+		}
+	}
 }
 
-//MH Added *Resets canDash to allow player to dash again
-void ARebellionCharacter::ResetDash()
+void ARebellionCharacter::ReceiveCrowdHit(AEnemyCrowdManager* crowd, int32 enemyIndex)
 {
-	bCanDash = true;
+	REBELLION_SCOPE(OnAttackHit);
+
+	//Each enemy is only hit once per swing
+	const uint64 enemyKey = ((uint64)crowd->GetUniqueID() << 32) | (uint32)enemyIndex;
+	if (swingHitCrowdEnemies.Contains(enemyKey))
+	{
+		return;
+	}
+	swingHitCrowdEnemies.Add(enemyKey);
+
+	INC_DWORD_STAT(STAT_Rebellion_WeaponHits);
+
+	const FVector enemyPosition = crowd->GetEnemyPosition(enemyIndex);
+	if (UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>())
+	{
+		combat->QueueHit(this, crowd, enemyIndex, currentAttack, GetCurrentAttackDamage(), enemyPosition, enemyPosition - GetActorLocation());
+	}
+	RecordFirstHitLatency();
+	if (UCombatAudioSubsystem* audio = GetWorld()->GetSubsystem<UCombatAudioSubsystem>())
+	{
+		audio->PlaySound(ECombatSound::IMPACT, impactSound, enemyPosition);
+	}
 }
 
-void ARebellionCharacter::Log(ELogLevel logLevel, FString message)
+float ARebellionCharacter::GetAttackDamage(EAttackType attackType) const
 {
-	Log(logLevel, message, ELogOutput::ALL);
+	const FAttackMontageCacheEntry* attack = attackMontageCache.IsValidIndex((int32)attackType) ? &attackMontageCache[(int32)attackType] : nullptr;
+	return attack ? attack->damage : defaultAttackDamage;
 }
 
-void ARebellionCharacter::Log(ELogLevel logLevel, FString message, ELogOutput logOutput)
+void ARebellionCharacter::HandleWeaponHit(const FHitResult& Hit)
 {
-	//Only print when screen is selected and the GEngine object is available
-	if ((logOutput == ELogOutput::ALL || logOutput == ELogOutput::SCREEN) && GEngine)
+	AActor* hitActor = Hit.GetActor();
+	if (HasAuthority() && IsLocallyControlled())
 	{
-		//default color
-		FColor logColor = FColor::Cyan;
-		//Change color based on type
-		switch (logLevel)
+		UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+		if (!combat)
 		{
-		case ELogLevel::TRACE:
-			logColor = FColor::Green;
-			break;
-		case ELogLevel::DEBUG:
-			logColor = FColor::Cyan;
-			break;
-		case ELogLevel::INFO:
-			logColor = FColor::White;
-			break;
-		case ELogLevel::WARNING:
-			logColor = FColor::Yellow;
-			break;
-		case ELogLevel::ERROR:
-			logColor = FColor::Red;
-			break;
-		default:
-			break;
+			return;
 		}
-		//Print message and leave on screen for a duration(4.5 currently)
-		GEngine->AddOnScreenDebugMessage(-1, 4.5f, logColor, message);
+		combat->QueueHit(this, hitActor, INDEX_NONE, currentAttack, GetCurrentAttackDamage(), Hit.ImpactPoint, hitActor->GetActorLocation() - GetActorLocation());
+	}
+	else if (IsLocallyControlled())
+	{
+		//Stamped with the time our view of the target was from, the server rewinds to it
+		ServerClaimWeaponHit(hitActor, Hit.ImpactPoint, currentAttack, ULagCompensationSubsystem::GetNetworkTime(GetWorld()));
 	}
-	if (logOutput == ELogOutput::ALL || logOutput == ELogOutput::OUTPUT_LOG)
+	else
 	{
-		//Change the message based on error level
-		switch (logLevel) 
+		//Other players' swings on this client only exist for show
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_Rebellion_WeaponHits);
+	REB_LOG(DEBUG, "Hit %s", *GetNameSafe(hitActor));
+	RecordFirstHitLatency();
+	if (UCombatAudioSubsystem* audio = GetWorld()->GetSubsystem<UCombatAudioSubsystem>())
+	{
+		audio->PlaySound(ECombatSound::IMPACT, impactSound, Hit.ImpactPoint);
+	}
+}
+
+bool ARebellionCharacter::ServerClaimWeaponHit_Validate(AActor* target, FVector_NetQuantize hitLocation, EAttackType attackType, float clientTime)
+{
+	return (int32)attackType < meleeAttackCount && FMath::IsFinite(clientTime);
+}
+
+void ARebellionCharacter::ServerClaimWeaponHit_Implementation(AActor* target, FVector_NetQuantize hitLocation, EAttackType attackType, float clientTime)
+{
+	//Only during the swing the server is playing for this client, and each target once per swing
+	if (!target || IsDead() || attackWindow.GetState() != EAttackWindowState::ACTIVE || attackType != currentAttack)
+	{
+		REB_LOG(DEBUG, "Weapon claim on %s outside an attack window", *GetNameSafe(target));
+		return;
+	}
+	if (++swingClaimCount > maxWeaponClaimsPerSwing || swingHitActors.Contains(target))
+	{
+		REB_LOG(DEBUG, "Weapon claim on %s over the swing's limit or already hit", *GetNameSafe(target));
+		return;
+	}
+
+	ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	UCombatSubsystem* combat = GetWorld()->GetSubsystem<UCombatSubsystem>();
+	if (!lagCompensation || !combat || !lagCompensation->ConfirmWeaponHit(this, target, clientTime, hitLocation))
+	{
+		return;
+	}
+	swingHitActors.Add(target);
+
+	//Damage comes from the server's own attack table, never from the claim
+	combat->QueueHit(this, target, INDEX_NONE, attackType, GetAttackDamage(attackType), hitLocation, target->GetActorLocation() - GetActorLocation());
+}
+
+float ARebellionCharacter::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	if (IsDead())
+	{
+		return 0.f;
+	}
+
+	const float damage = Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	//An idle character may be dormant, flush so the new health still reaches every connection
+	FlushNetDormancy();
+	const float previousHealth = health;
+	health = FMath::Max(health - damage, 0.f);
+	OnHealthChanged(previousHealth);
+	UpdateCombatState();
+	return damage;
+}
+
+void ARebellionCharacter::UpdateCombatState()
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	//The dash cooldown end tick is set once as the dash ends, recomputing it here would resend it every update
+	combatState.SetHealth(health);
+	combatState.attackType = (uint8)currentAttack;
+	combatState.attackWindowState = (uint8)attackWindow.GetState();
+	combatState.comboStep = GetNetAttackSection();
+	combatState.attackStartTick = attackStartTick;
+	combatState.bKeyboardEnabled = isKeyboardEnabled;
+	combatState.bBlocking = bBlocking;
+	combatState.bDashing = GetRebellionMovement()->IsDashing();
+}
+
+uint8 ARebellionCharacter::GetNetAttackSection() const
+{
+	//Combo graphs are far shorter than the bits allow, a section past them plays as the last one
+	const int32 sections = attackMontageCache.IsValidIndex((int32)currentAttack) ? attackMontageCache[(int32)currentAttack].sectionNames.Num() : 0;
+	const int32 section = sections > 0 ? comboStep % sections : 0;
+	return (uint8)FMath::Min(section, (1 << FRebellionCombatState::ComboStepBits) - 1);
+}
+
+void ARebellionCharacter::OnRep_CombatState()
+{
+	const FRebellionCombatState previousState = appliedCombatState;
+	appliedCombatState = combatState;
+
+	if (combatState.healthTenths != previousState.healthTenths)
+	{
+		const float previousHealth = health;
+		health = combatState.GetHealth();
+		OnHealthChanged(previousHealth);
+	}
+
+	//The owner runs its own attacks and input lock
+	if (IsLocallyControlled())
+	{
+		return;
+	}
+
+	isKeyboardEnabled = combatState.bKeyboardEnabled;
+	bBlocking = combatState.bBlocking;
+
+	//Joining or becoming relevant mid swing, the attack RPC went out before we could see it
+	if (combatState.attackStartTick != previousState.attackStartTick && combatState.attackWindowState != (uint8)EAttackWindowState::IDLE)
+	{
+		PlayRemoteAttack((EAttackType)combatState.attackType, combatState.comboStep, combatState.attackStartTick);
+	}
+}
+
+bool ARebellionCharacter::ServerAttack_Validate(FRebellionAttackEvent attackEvent)
+{
+	return attackEvent.attackType < meleeAttackCount;
+}
+
+void ARebellionCharacter::ServerAttack_Implementation(FRebellionAttackEvent attackEvent)
+{
+	if (!CanAcceptClientAttack(attackEvent.startTick))
+	{
+		REB_LOG(DEBUG, "%s attack rejected, window state %d", *GetName(), (int32)attackWindow.GetState());
+		return;
+	}
+
+	//The combo step follows the server's own combo graph, never the event's
+	const EAttackType attackType = (EAttackType)attackEvent.attackType;
+	const int32 step = GetNextComboStep(attackType);
+
+	//Play from where the client is in the swing so the hitbox history matches what it swept
+	const uint16 nowTick = FRebellionCombatState::ToNetTick(ULagCompensationSubsystem::GetNetworkTime(GetWorld()));
+	const float elapsedSeconds = FMath::Clamp(FRebellionCombatState::GetTickSeconds(attackEvent.startTick, nowTick), 0.f, maxAttackCatchUpSeconds);
+	if (!PlayAttack(attackType, step, elapsedSeconds, 0))
+	{
+		return;
+	}
+
+	lastClientAttackTick = attackEvent.startTick;
+	attackEvent.comboStep = GetNetAttackSection();
+	attackStartTick = attackEvent.startTick;
+	UpdateCombatState();
+	MulticastAttack(attackEvent);
+}
+
+void ARebellionCharacter::MulticastAttack_Implementation(FRebellionAttackEvent attackEvent)
+{
+	//The server and the attacker started it themselves
+	if (HasAuthority() || IsLocallyControlled())
+	{
+		return;
+	}
+	PlayRemoteAttack((EAttackType)attackEvent.attackType, attackEvent.comboStep, attackEvent.startTick);
+}
+
+void ARebellionCharacter::PlayRemoteAttack(EAttackType attackType, int32 step, uint16 startTick)
+{
+	//The RPC and the combat state can both bring the same attack
+	if (lastRemoteAttackTick == startTick || IsDead())
+	{
+		return;
+	}
+	lastRemoteAttackTick = startTick;
+
+	const uint16 nowTick = FRebellionCombatState::ToNetTick(ULagCompensationSubsystem::GetNetworkTime(GetWorld()));
+	PlayAttack(attackType, step, FMath::Max(FRebellionCombatState::GetTickSeconds(startTick, nowTick), 0.f), 0);
+}
+
+void ARebellionCharacter::OnHealthChanged(float previousHealth)
+{
+	if (IsDead() && previousHealth > 0.f)
+	{
+		REB_LOG(INFO, "%s died", *GetName());
+		attackInputBuffer.Reset();
+		bBlocking = false;
+		StopAnimMontage();
+		EAttackWindowState previousWindowState;
+		if (attackWindow.Stop(previousWindowState))
 		{
-		case ELogLevel::TRACE:
-			UE_LOG(LogTemp, VeryVerbose, TEXT("%s"), *message);
-			break;
-		case ELogLevel::DEBUG:
-			UE_LOG(LogTemp, Verbose, TEXT("%s"), *message);
-			break;
-		case ELogLevel::INFO:
-			UE_LOG(LogTemp, Log, TEXT("%s"), *message);
-			break;
-		case ELogLevel::WARNING:
-			UE_LOG(LogTemp, Warning, TEXT("%s"), *message);
-			break;
-		case ELogLevel::ERROR:
-			UE_LOG(LogTemp, Error, TEXT("%s"), *message);
-			break;
-		default:
-			UE_LOG(LogTemp, Log, TEXT("%s"), *message);
-			break;
+			OnAttackWindowChanged(previousWindowState);
 		}
+		GetCharacterMovement()->DisableMovement();
+	}
+	else if (hitReactMontage && health < previousHealth && !IsDead())
+	{
+		PlayAnimMontage(hitReactMontage);
+	}
+}
+
+//void ARebellionCharacter::OnAttackOverlapBegin(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult) 
+//{
+//	Log(ELogLevel::INFO, __FUNCTION__);
+//	//Log(ELogLevel::WARNING, SweepResult.GetActor()->GetName());
+//}
+
+//void ARebellionCharacter::OnAttackOverlapEnd(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+//{
+//	Log(ELogLevel::INFO, __FUNCTION__);
+//	//Log(ELogLevel::WARNING, OtherActor->GetName());
+//}
+
+//MH added method for blocking
+void ARebellionCharacter::BlockStart()
+{
+	REB_LOG(INFO, "BlockStart");
+	SetBlocking(true);
+	if (UCombatAudioSubsystem* audio = GetWorld()->GetSubsystem<UCombatAudioSubsystem>())
+	{
+		audio->PlaySound(ECombatSound::BLOCK, blockSound, GetActorLocation());
 	}
 }
 
+//MH added method for blocking
+void ARebellionCharacter::BlockEnd()
+{
+	REB_LOG(INFO, "BlockEnd");
+	SetBlocking(false);
+}
 
+void ARebellionCharacter::SetBlocking(bool bNewBlocking)
+{
+	bBlocking = bNewBlocking;
+	if (HasAuthority())
+	{
+		UpdateCombatState();
+	}
+	else if (IsLocallyControlled())
+	{
+		ServerSetBlocking(bNewBlocking);
+	}
+}
+
+void ARebellionCharacter::ServerSetBlocking_Implementation(bool bNewBlocking)
+{
+	bBlocking = bNewBlocking && !IsDead();
+	UpdateCombatState();
+}
+
+//MH Added *Dashes dashDistance over dashStopTimer, the movement component runs it and its cooldown
+void ARebellionCharacter::DashStart()
+{
+	REBELLION_SCOPE(Dash);
+	INC_DWORD_STAT(STAT_Rebellion_DashCalls);
+
+	REB_LOG(INFO, "DashStart");
+	GetRebellionMovement()->RequestDash();
+}
 
 void ARebellionCharacter::OnResetVR()
 {
@@ -488,6 +1239,9 @@ void ARebellionCharacter::LookUpAtRate(float Rate)
 
 void ARebellionCharacter::MoveForward(float Value)
 {
+	REBELLION_SCOPE(MoveForward);
+	INC_DWORD_STAT(STAT_Rebellion_MoveCalls);
+
 	if ((Controller != NULL) && (Value != 0.0f) && isKeyboardEnabled)
 	{
 		// find out which way is forward
@@ -502,6 +1256,9 @@ void ARebellionCharacter::MoveForward(float Value)
 
 void ARebellionCharacter::MoveRight(float Value)
 {
+	REBELLION_SCOPE(MoveRight);
+	INC_DWORD_STAT(STAT_Rebellion_MoveCalls);
+
 	if ( (Controller != NULL) && (Value != 0.0f) && isKeyboardEnabled )
 	{
 		// find out which way is right
@@ -5,13 +5,16 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Components/BoxComponent.h"
-#include "Components/AudioComponent.h"
 #include "Sound/SoundCue.h"
 #include "Engine/DataTable.h"
+#include "Engine/NetSerialization.h"
+#include "CombatInputBuffer.h"
+#include "AttackWindowStateMachine.h"
+#include "RebellionCombatState.h"
 
 #include "RebellionCharacter.generated.h"
 
-//Needs implementing
+//Attack row in PlayerAttackMontageDataTable, resolved once into attackMontageCache
 USTRUCT(BlueprintType)
 struct FPlayerAttackMontage : public FTableRowBase
 {
@@ -23,9 +26,12 @@ struct FPlayerAttackMontage : public FTableRowBase
 		int32 animSectionCount;
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 		FString description;
+	//Damage one hit of this attack deals, 0 uses the character's defaultAttackDamage
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		float damage = 0.f;
 };
 
-//Needs implementing
+//Collision profiles a weapon hitbox switches between, resolved once into response containers
 USTRUCT(BlueprintType)
 struct FMeleeCollisionProfile 
 {
@@ -47,30 +53,36 @@ struct FMeleeCollisionProfile
 
 //MH added for tracking
 UENUM(BlueprintType)
-enum class ELogLevel : uint8 
+enum class EAttackType : uint8
 {
-	TRACE			UMETA(DisplayName = "Trace"),
-	DEBUG			UMETA(DisplayName = "Debug"),
-	INFO			UMETA(DisplayName = "Info"),
-	WARNING			UMETA(DisplayName = "Warning"),
-	ERROR			UMETA(DisplayName = "Error")
+	MELEE_PRIMARY			UMETA(DisplayName = "Melee - Primary"),
+	MELEE_SECONDARY			UMETA(DisplayName = "Melee - Secondary"),
+	//AProjectileManager hits, not a montage
+	RANGED					UMETA(DisplayName = "Ranged"),
+	COUNT					UMETA(Hidden)
 };
+//Attacks with a montage in the attack data table
+static constexpr int32 meleeAttackCount = (int32)EAttackType::RANGED;
 
-//MH added for tracking
-UENUM(BlueprintType)
-enum class ELogOutput : uint8
+//Attack montage row resolved once so an attack is just an array lookup
+USTRUCT()
+struct FAttackMontageCacheEntry
 {
-	ALL				UMETA(DisplayName = "All levels"),
-	OUTPUT_LOG		UMETA(DisplayName = "Output log"),
-	SCREEN			UMETA(DisplayName = "Screen")
-};
+	GENERATED_BODY()
 
-//MH added for tracking
-UENUM(BlueprintType)
-enum class EAttackType : uint8
-{
-	MELEE_PRIMARY			UMETA(DisplayName = "Melee - Primary"),
-	MELEE_SECONDARY			UMETA(DisplayName = "Melee - Secondary")
+	UPROPERTY()
+		UAnimMontage* montage = nullptr;
+
+	//"start_1".."start_N" section names, index 0 is combo step 1
+	UPROPERTY()
+		TArray<FName> sectionNames;
+
+	//Combo graph, the step chained from each step's combo window
+	UPROPERTY()
+		TArray<int32> nextSteps;
+
+	UPROPERTY()
+		float damage = 0.f;
 };
 
 UCLASS(config=Game)
@@ -78,6 +90,11 @@ class ARebellionCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	//Bots and replays drive SetupPlayerInputComponent bindings directly
+	friend struct FScriptedInput;
+	//Bakes the attack table and tuning defaults into the combat pack
+	friend class URebellionCombatPackCommandlet;
+
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class USpringArmComponent* CameraBoom;
@@ -86,16 +103,25 @@ class ARebellionCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
 
+	//Soft so the class default object doesn't pull every montage in, loaded through the asset manager
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Animation, meta = (AllowPrivateAccess = "true"))
-		class UDataTable* playerAttackDataTable;
+		TSoftObjectPtr<UDataTable> playerAttackDataTable;
 
 	//Melee sword attack montage
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Animation, meta = (AllowPrivateAccess = "true"))
 		class UAnimMontage* SwordAttackMontage;
 
-	//Sound Cue
+	//Sound Cue, played through UCombatAudioSubsystem when an attack window opens
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Audio, meta = (AllowPrivateAccess = "true"))
+		TSoftObjectPtr<USoundCue> SwordSoundCue;
+
+	//Optional, played where a weapon hit is detected
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Audio, meta = (AllowPrivateAccess = "true"))
-		class USoundCue* SwordSoundCue;
+		class USoundBase* impactSound;
+
+	//Optional, played when blocking starts
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Audio, meta = (AllowPrivateAccess = "true"))
+		class USoundBase* blockSound;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
 		class UBoxComponent* primaryWeaponCollisionBox;
@@ -103,6 +129,10 @@ class ARebellionCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
 		class UBoxComponent* secondaryWeaponCollisionBox;
 
+	//Profiles primaryWeaponCollisionBox uses while an attack window is open/closed
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
+		FMeleeCollisionProfile meleeCollisionProfile;
+
 	/*UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Collision, meta = (AllowPrivateAccess = "true"))
 		class UBoxComponent* rangedWeaponCollisionBox;*/
 
@@ -110,11 +140,20 @@ class ARebellionCharacter : public ACharacter
 		float animationVariable;
 
 public:
-	ARebellionCharacter();
+	ARebellionCharacter(const FObjectInitializer& ObjectInitializer);
+
+	/** Names of the player only subobjects, subclasses pass them to DoNotCreateDefaultSubobject */
+	static FName CameraBoomName;
+	static FName FollowCameraName;
 
 	//Called on game start or when player is spawned
 	virtual void BeginPlay() override;
 
+	//Called when the player is destroyed or the level is unloaded
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode) override;
+
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
 	float BaseTurnRate;
@@ -163,9 +202,9 @@ protected:
 	virtual void Landed(const FHitResult& hit) override;
 
 public:
-	/** Returns CameraBoom subobject **/
+	/** Returns CameraBoom subobject, null on AI variants **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
-	/** Returns FollowCamera subobject **/
+	/** Returns FollowCamera subobject, null on AI variants **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
 	//MH added
@@ -195,25 +234,82 @@ public:
 	UFUNCTION()
 		void BlockEnd();
 
-	//Triggers attack type based on user input
-	void AttackInput(EAttackType attackType);
-	UPROPERTY()
-		int montageSectionIndex = 1;
+	//Starts an attack now, pressCycles is the input it came from for the latency telemetry (0 for none)
+	void AttackInput(EAttackType attackType, uint64 pressCycles = 0);
+	/** Alive, input enabled and idle or in the combo window; the server holds a client's attacks to the same rule */
+	bool CanStartAttack() const;
+	/** Whether the server plays a client's ServerAttack that started at startTick: a new start the character can make now */
+	bool CanAcceptClientAttack(uint16 startTick) const;
+	//Resolves every attack row and its section names, called once the combat assets are loaded
+	void BuildAttackMontageCache();
+
+	/**
+	 * Soft referenced assets an attack needs, ARebellionGameMode preloads the default pawn's at map load.
+	 * With a combat pack profile for this class that is its montages, otherwise the attack data table.
+	 */
+	void GetCombatAssetPaths(const class FCombatDataPack* pack, TArray<FSoftObjectPath>& outPaths) const;
+
+	/** Buffered attack presses older than this are dropped instead of starting an attack late */
+	UPROPERTY(EditAnywhere, Category = Combat, meta = (ClampMin = "0"))
+		float attackInputBufferSeconds = 0.5f;
 
-	//Attack
+	//Attack, the presses are buffered until the combo window opens
 
 	void PrimaryAttack();
 	void SecondaryAttack();
 
+	/** Attack window begin and end, forwarded once per window by UAttackStartNotifyState */
 	UFUNCTION()
 		void AttackStart();
 	UFUNCTION()
 		void AttackEnd();
+
+	UFUNCTION(BlueprintCallable, Category = Combat)
+		EAttackWindowState GetAttackWindowState() const { return attackWindow.GetState(); }
+
+	/** The next combo step can be chained, from the end of the window until the montage blends out */
+	bool IsComboWindowOpen() const { return attackWindow.GetState() == EAttackWindowState::RECOVERY; }
 	UPROPERTY()
 		class UBoxComponent* attackBox;
-	//Triggered whe collision hit even fires between our weapon and enemy entities
-	UFUNCTION()
-		void OnAttackHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	/** Queues this frame's weapon sweeps, called by UCombatSubsystem every frame of an attack window */
+	void SweepWeapon();
+
+	/** Bumped for every attack started, identifies the swing a weapon sweep belongs to */
+	uint32 GetAttackSerial() const { return attackWindow.GetSerial(); }
+
+	/** Called by UCombatSubsystem with the hits from one of our weapon sweeps */
+	void ReceiveWeaponHits(const TArray<FHitResult>& hits);
+
+	/** Called by UCombatSubsystem for each crowd enemy one of our weapon sweeps touched */
+	void ReceiveCrowdHit(class AEnemyCrowdManager* crowd, int32 enemyIndex);
+
+	/** Health, reduced by the combat subsystem's damage pass through TakeDamage. Only the server applies damage, clients get it through combatState */
+	UPROPERTY(EditAnywhere, Category = Combat)
+		float maxHealth = 100.f;
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = Combat)
+		float health;
+
+	/** Played on hits that don't kill, optional */
+	UPROPERTY(EditDefaultsOnly, Category = Animation)
+		UAnimMontage* hitReactMontage;
+
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, class AController* EventInstigator, AActor* DamageCauser) override;
+
+	UFUNCTION(BlueprintCallable, Category = Combat)
+		bool IsDead() const { return health <= 0.f; }
+
+	/** Between BlockStart and BlockEnd, hits from the front then do Rebellion.Combat.BlockDamageScale of their damage. Replicated through combatState */
+	UFUNCTION(BlueprintCallable, Category = Combat)
+		bool IsBlocking() const { return bBlocking; }
+
+	/** Damage for attack rows that don't set their own */
+	UPROPERTY(EditAnywhere, Category = Combat)
+		float defaultAttackDamage = 25.f;
+
+	/** Number of interpolated sweeps between two frames of an attack window */
+	UPROPERTY(EditAnywhere, Category = Combat, meta = (ClampMin = "1", ClampMax = "16"))
+		int32 weaponSweepSubsteps = 4;
 
 	/** Bool that tells us if we need to branch our animation Blueprint pathes*/
 	UFUNCTION(BlueprintCallable, Category=Animation)
@@ -238,50 +334,138 @@ public:
 	//Dash
 	UFUNCTION()
 		void DashStart();
-	UFUNCTION()
-		void DashStop();
-	UFUNCTION()
-		void ResetDash();
 	UPROPERTY(EditAnywhere)
 		float dashDistance;
 	UPROPERTY(EditAnywhere)
 		float dashCooldown;
-	UPROPERTY()
-		bool bCanDash;
+	//Dash duration
 	UPROPERTY(EditAnywhere)
 		float dashStopTimer;
 
+	/** Sprint and dash are simulated by the movement component so they are predicted */
+	class URebellionCharacterMovementComponent* GetRebellionMovement() const;
+
+	/** Dash state on any machine, simulated proxies read it from combatState */
+	UFUNCTION(BlueprintCallable, Category = Movement)
+		bool IsDashing() const;
+	UFUNCTION(BlueprintCallable, Category = Movement)
+		float GetDashCooldownRemaining() const;
+
 private:
 
-	UAudioComponent* SwordAudioComponent;
+	//Clears combatState's dash cooldown end tick once it has passed, before the 16 bit tick can wrap back around to it
+	FTimerHandle dashCooldownTimer;
+	void OnDashCooldownEnded();
 
-	FPlayerAttackMontage* attackMontage;
+	//Indexed by EAttackType
+	UPROPERTY()
+		TArray<FAttackMontageCacheEntry> attackMontageCache;
 
-	EAttackType currentAttack;
+	//Keeps the soft referenced combat assets loaded while this character exists
+	TSharedPtr<struct FStreamableHandle> combatAssetsHandle;
+	void OnCombatAssetsLoaded();
 
-	bool isAnimationBlended;
+	//Mapped combat pack from UCombatDataSubsystem, null when there is none
+	const class FCombatDataPack* GetCombatPack() const;
+	//This class's profile in pack, null to use the data table and constructor defaults
+	const struct FCombatPackProfile* FindCombatPackProfile(const class FCombatDataPack* pack) const;
+	void BuildAttackMontageCacheFromPack(const class FCombatDataPack& pack, const struct FCombatPackProfile& packProfile);
 
-	bool isKeyboardEnabled;
+	EAttackType currentAttack;
+	//Network time tick the current attack started at, sent with it and replicated in combatState
+	uint16 attackStartTick = 0;
 
-	//Tracking/Debugging
-	/**
-	Log - prints a message to all log outputs with a specific color
-	logLevel affects color of log
-	message is the message to display
-	*/
-	void Log(ELogLevel logLevel, FString message);
+	bool isAnimationBlended;
 
-	/**
-	Log prints message to all log outputs with a specific color
-	logLevel affects color of log
-	message is the message to display
-	ELogOutput outputs to the log or screen
-	*/
-	void Log(ELogLevel logLevel, FString message, ELogOutput logOutput);
-
-	//Timer
-	UPROPERTY(EditAnywhere)
-		FTimerHandle dashTimer;
+	//On from the start, attacks and movement are only locked by an attack or SetIsKeyboardEnabled
+	bool isKeyboardEnabled = true;
+
+	FAttackWindowStateMachine attackWindow;
+	//All attack side effects happen on the transitions, nothing runs per frame inside a state
+	void OnAttackWindowChanged(EAttackWindowState oldState);
+
+	//Closes the attack when its montage finishes, is interrupted or is blended out by another montage
+	void OnAttackMontageBlendingOut(UAnimMontage* montage, bool bInterrupted, uint32 serial);
+
+	/** Plays a combo step of an attack elapsedSeconds in, for local presses and attacks from the network. False if nothing played */
+	bool PlayAttack(EAttackType attackType, int32 step, float elapsedSeconds, uint64 pressCycles);
+
+	/** Attack the owning client started, played on the server from its start time and passed on to the simulated proxies */
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerAttack(FRebellionAttackEvent attackEvent);
+	/** Attack started on the server, simulated proxies play it from its start time */
+	UFUNCTION(NetMulticast, Reliable)
+		void MulticastAttack(FRebellionAttackEvent attackEvent);
+	//Simulated proxies, from the RPC or from combatState if the character became relevant mid swing
+	void PlayRemoteAttack(EAttackType attackType, int32 step, uint16 startTick);
+	//Start tick of the last attack played from the network, INDEX_NONE before the first
+	int32 lastRemoteAttackTick = INDEX_NONE;
+	//Start tick of the last ServerAttack the server played, a claim has to be newer. INDEX_NONE before the first
+	int32 lastClientAttackTick = INDEX_NONE;
+
+	/** Health, attack and dash state in one delta compressed property, written by UpdateCombatState on the server */
+	UPROPERTY(ReplicatedUsing = OnRep_CombatState)
+		FRebellionCombatState combatState;
+	//State OnRep_CombatState last applied, what the next one is compared against
+	FRebellionCombatState appliedCombatState;
+	void UpdateCombatState();
+	//Montage section of the current attack, what the network sends as its combo step
+	uint8 GetNetAttackSection() const;
+	UFUNCTION()
+		void OnRep_CombatState();
+
+	void BufferAttackInput(EAttackType attackType);
+	//Starts the oldest buffered press if nothing is playing or the combo window is open
+	void ConsumeBufferedAttackInput();
+	//Combo step an attack started now plays, the next one in the combo graph if chained from the combo window
+	int32 GetNextComboStep(EAttackType attackType) const;
+	void RecordFirstHitLatency();
+
+	bool bBlocking = false;
+	//Owning client's BlockStart/BlockEnd, the server's copy is what the damage pass reads
+	UFUNCTION(Server, Reliable)
+		void ServerSetBlocking(bool bNewBlocking);
+	void SetBlocking(bool bNewBlocking);
+
+	FAttackInputBuffer attackInputBuffer;
+	bool bConsumingAttackInput = false;
+	//Index into the current attack's section names, advances only when chained from the combo window
+	int32 comboStep = 0;
+	//Press that started the current attack and whether its first hit was recorded yet
+	uint64 attackPressCycles = 0;
+	bool bFirstHitRecorded = false;
+
+	//Called once per actor hit per swing, queues the hit for the damage pass or claims it from the server
+	void HandleWeaponHit(const FHitResult& hit);
+	float GetAttackDamage(EAttackType attackType) const;
+	float GetCurrentAttackDamage() const { return GetAttackDamage(currentAttack); }
+
+	/** A remote player's weapon hit during the attack window the server is playing, confirmed by rewinding both characters to clientTime before it is queued */
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerClaimWeaponHit(AActor* target, FVector_NetQuantize hitLocation, EAttackType attackType, float clientTime);
+
+	//Hit react or death for a health change, on the server from TakeDamage and on clients from combatState
+	void OnHealthChanged(float previousHealth);
+
+	//Looks meleeCollisionProfile up in the collision profile table once
+	void ResolveWeaponCollisionResponses();
+	//Flips the weapon box between the resolved responses, the physics body is never rebuilt
+	void SetWeaponCollisionActive(bool bActive);
+
+	FCollisionResponseContainer weaponEnabledResponses;
+	FCollisionResponseContainer weaponDisabledResponses;
+	bool bWeaponCollisionActive;
+
+	//Weapon sweep state for the current swing
+	FTransform lastWeaponTransform;
+	bool bHasLastWeaponTransform;
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<8>> swingHitActors;
+	//Crowd enemies hit this swing, crowd unique id in the high bits and enemy index in the low bits
+	TArray<uint64, TInlineAllocator<16>> swingHitCrowdEnemies;
+	int32 swingSweepCount;
+	uint64 swingSweepCycles = 0;
+	//Weapon hit claims the server received this swing, the targets it confirmed are in swingHitActors
+	int32 swingClaimCount = 0;
 
 };
 
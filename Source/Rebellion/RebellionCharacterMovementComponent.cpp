@@ -0,0 +1,385 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionCharacterMovementComponent.h"
+#include "Rebellion.h"
+#include "RebellionBenchmarkSubsystem.h"
+#include "RebellionLog.h"
+#include "RebellionStats.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Character.h"
+#include "Dom/JsonObject.h"
+
+static TAutoConsoleVariable<int32> CVarNetSprintDash(
+	TEXT("Rebellion.Movement.NetSprintDash"),
+	1,
+	TEXT("Server simulates the sprint and dash flags of client moves. 0 ignores them like the old unpredicted sprint and dash, for before/after correction counts."),
+	ECVF_Cheat);
+
+//Saved move flags, FLAG_Custom_2 and 3 are free
+static constexpr uint8 sprintFlag = FSavedMove_Character::FLAG_Custom_0;
+static constexpr uint8 dashFlag = FSavedMove_Character::FLAG_Custom_1;
+
+class FSavedMove_Rebellion : public FSavedMove_Character
+{
+public:
+
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override
+	{
+		Super::Clear();
+		bSavedWantsToSprint = false;
+		bSavedWantsToDash = false;
+		bSavedDashing = false;
+	}
+
+	virtual uint8 GetCompressedFlags() const override
+	{
+		uint8 flags = Super::GetCompressedFlags();
+		if (bSavedWantsToSprint)
+		{
+			flags |= sprintFlag;
+		}
+		if (bSavedWantsToDash)
+		{
+			flags |= dashFlag;
+		}
+		return flags;
+	}
+
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override
+	{
+		//Combined moves change the delta times the server steps the dash with
+		const FSavedMove_Rebellion* newMove = static_cast<const FSavedMove_Rebellion*>(NewMove.Get());
+		if (bSavedWantsToSprint != newMove->bSavedWantsToSprint || bSavedWantsToDash || newMove->bSavedWantsToDash || bSavedDashing || newMove->bSavedDashing)
+		{
+			return false;
+		}
+		return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+	}
+
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override
+	{
+		Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+		const URebellionCharacterMovementComponent* movement = Cast<URebellionCharacterMovementComponent>(Character->GetCharacterMovement());
+		if (movement)
+		{
+			bSavedWantsToSprint = movement->WantsToSprint();
+			bSavedWantsToDash = movement->WantsToDash();
+			bSavedDashing = movement->IsDashing();
+		}
+	}
+
+	bool bSavedWantsToSprint = false;
+	bool bSavedWantsToDash = false;
+	bool bSavedDashing = false;
+};
+
+class FNetworkPredictionData_Client_Rebellion : public FNetworkPredictionData_Client_Character
+{
+public:
+
+	FNetworkPredictionData_Client_Rebellion(const UCharacterMovementComponent& ClientMovement)
+		: FNetworkPredictionData_Client_Character(ClientMovement)
+	{
+	}
+
+	virtual FSavedMovePtr AllocateNewMove() override
+	{
+		return FSavedMovePtr(new FSavedMove_Rebellion());
+	}
+};
+
+void FRebellionMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
+{
+	FCharacterMoveResponseDataContainer::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	const URebellionCharacterMovementComponent& movement = static_cast<const URebellionCharacterMovementComponent&>(CharacterMovement);
+	dashStepsRemaining = movement.GetDashStepsRemaining();
+	dashStepAccumulator = movement.GetDashStepAccumulator();
+	dashCooldownRemaining = movement.GetDashCooldownRemaining();
+	dashDirection = movement.GetDashDirection();
+}
+
+bool FRebellionMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if (!FCharacterMoveResponseDataContainer::Serialize(CharacterMovement, Ar, PackageMap))
+	{
+		return false;
+	}
+
+	//Good moves stay as small as the engine's, the dash state only rides on corrections
+	if (IsCorrection())
+	{
+		uint8 steps = (uint8)FMath::Clamp(dashStepsRemaining, 0, 255);
+		Ar << steps;
+		dashStepsRemaining = steps;
+		Ar << dashStepAccumulator;
+		Ar << dashCooldownRemaining;
+		bool bDirectionSuccess = true;
+		FVector_NetQuantizeNormal direction = dashDirection;
+		direction.NetSerialize(Ar, PackageMap, bDirectionSuccess);
+		dashDirection = direction;
+	}
+	return !Ar.IsError();
+}
+
+URebellionCharacterMovementComponent::URebellionCharacterMovementComponent()
+{
+	sprintSpeed = 900.f;
+	dashStepSeconds = 1.f / 60.f;
+	dashSteps = 6;
+	dashSpeed = 6000.f;
+	dashCooldown = 1.f;
+	bDashAlongControlRotation = false;
+
+	SetMoveResponseDataContainer(moveResponseData);
+}
+
+FNetworkPredictionData_Client* URebellionCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		URebellionCharacterMovementComponent* mutableThis = const_cast<URebellionCharacterMovementComponent*>(this);
+		mutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Rebellion(*this);
+	}
+	return ClientPredictionData;
+}
+
+void URebellionCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	//Emulates the server that never heard about sprint or dash
+	if (CVarNetSprintDash.GetValueOnGameThread() == 0 && CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority && !CharacterOwner->IsLocallyControlled())
+	{
+		return;
+	}
+
+	bWantsToSprint = (Flags & sprintFlag) != 0;
+	bWantsToDash = (Flags & dashFlag) != 0;
+}
+
+void URebellionCharacterMovementComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	moveResponseCount++;
+	if (MoveResponse.IsCorrection())
+	{
+		correctionCount++;
+		INC_DWORD_STAT(STAT_Rebellion_MovementCorrections);
+
+		//Moves after the corrected one are replayed from here
+		const FRebellionMoveResponseDataContainer& response = static_cast<const FRebellionMoveResponseDataContainer&>(MoveResponse);
+		dashStepsRemaining = response.dashStepsRemaining;
+		dashStepAccumulator = response.dashStepAccumulator;
+		dashCooldownRemaining = response.dashCooldownRemaining;
+		dashDirection = response.dashDirection;
+	}
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
+
+float URebellionCharacterMovementComponent::GetMaxSpeed() const
+{
+	if (IsDashing())
+	{
+		return dashSpeed;
+	}
+	if (bWantsToSprint && IsMovingOnGround() && !IsCrouching())
+	{
+		return sprintSpeed;
+	}
+	return Super::GetMaxSpeed();
+}
+
+void URebellionCharacterMovementComponent::ConfigureDash(float distance, float duration, float cooldown)
+{
+	dashSteps = FMath::Max(FMath::RoundToInt(duration / dashStepSeconds), 1);
+	dashSpeed = distance / (dashSteps * dashStepSeconds);
+	dashCooldown = cooldown;
+}
+
+bool URebellionCharacterMovementComponent::CanDash() const
+{
+	return !IsDashing() && dashCooldownRemaining <= 0.f && dashSteps > 0 && (IsMovingOnGround() || IsFalling());
+}
+
+void URebellionCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	if (bWantsToDash)
+	{
+		//A press during the cooldown is dropped, not queued
+		bWantsToDash = false;
+		if (CanDash())
+		{
+			StartDash();
+		}
+	}
+}
+
+void URebellionCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+
+	//Counted per simulated move, so client replays and the server agree on when the next dash is allowed
+	if (!IsDashing() && dashCooldownRemaining > 0.f)
+	{
+		dashCooldownRemaining = FMath::Max(dashCooldownRemaining - DeltaSeconds, 0.f);
+	}
+}
+
+void URebellionCharacterMovementComponent::StartDash()
+{
+	//Along the view or the movement input, facing without either, never vertical
+	const FVector input = bDashAlongControlRotation && CharacterOwner->GetController() ? CharacterOwner->GetControlRotation().Vector() : Acceleration;
+	const FVector facing = UpdatedComponent->GetForwardVector();
+	const FVector flatInput(input.X, input.Y, 0.f);
+	dashDirection = flatInput.IsNearlyZero() ? FVector(facing.X, facing.Y, 0.f).GetSafeNormal() : flatInput.GetSafeNormal();
+	dashStepsRemaining = dashSteps;
+	dashStepAccumulator = 0.f;
+
+	REB_LOG(TRACE, "%s dash start", *GetNameSafe(CharacterOwner));
+	SetMovementMode(MOVE_Custom, (uint8)ERebellionMovementMode::DASH);
+}
+
+void URebellionCharacterMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (CustomMovementMode == (uint8)ERebellionMovementMode::DASH)
+	{
+		PhysDash(deltaTime, Iterations);
+		return;
+	}
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void URebellionCharacterMovementComponent::PhysDash(float deltaTime, int32 Iterations)
+{
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	//Whole steps only, the remainder waits for the next move so the path doesn't depend on frame times
+	dashStepAccumulator += deltaTime;
+	while (dashStepsRemaining > 0 && dashStepAccumulator >= dashStepSeconds - KINDA_SMALL_NUMBER)
+	{
+		dashStepAccumulator -= dashStepSeconds;
+		dashStepsRemaining--;
+
+		Velocity = dashDirection * dashSpeed;
+		const FVector delta = Velocity * dashStepSeconds;
+		FHitResult hit(1.f);
+		SafeMoveUpdatedComponent(delta, UpdatedComponent->GetComponentQuat(), true, hit);
+		if (hit.IsValidBlockingHit())
+		{
+			HandleImpact(hit, dashStepSeconds, delta);
+			SlideAlongSurface(delta, 1.f - hit.Time, hit.Normal, hit, true);
+		}
+	}
+
+	if (dashStepsRemaining == 0)
+	{
+		EndDash(FMath::Max(dashStepAccumulator, 0.f), Iterations);
+	}
+}
+
+void URebellionCharacterMovementComponent::EndDash(float remainingTime, int32 Iterations)
+{
+	dashStepAccumulator = 0.f;
+	dashCooldownRemaining = dashCooldown;
+	//Dashes stop dead instead of sliding on
+	Velocity = FVector::ZeroVector;
+
+	FFindFloorResult floor;
+	FindFloor(UpdatedComponent->GetComponentLocation(), floor, false);
+	SetMovementMode(floor.IsWalkableFloor() ? MOVE_Walking : MOVE_Falling);
+
+	REB_LOG(TRACE, "%s dash end", *GetNameSafe(CharacterOwner));
+	StartNewPhysics(remainingTime, Iterations);
+}
+
+namespace RebellionMovementReport
+{
+	static void WriteReport(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world)
+		{
+			return;
+		}
+
+		int32 moveResponses = 0;
+		int32 corrections = 0;
+		for (TActorIterator<ACharacter> iterator(world); iterator; ++iterator)
+		{
+			URebellionCharacterMovementComponent* movement = Cast<URebellionCharacterMovementComponent>(iterator->GetCharacterMovement());
+			if (!movement)
+			{
+				continue;
+			}
+			if (args.Contains(TEXT("reset")))
+			{
+				movement->ResetNetStats();
+			}
+			moveResponses += movement->GetMoveResponseCount();
+			corrections += movement->GetCorrectionCount();
+		}
+
+		if (args.Contains(TEXT("reset")))
+		{
+			UE_LOG(LogRebellion, Display, TEXT("Movement correction counts reset"));
+			return;
+		}
+
+		//Current rates of every connection this machine has, the server's one to each client or a client's one to the server
+		int32 inBytesPerSecond = 0;
+		int32 outBytesPerSecond = 0;
+		int32 connections = 0;
+		UNetDriver* netDriver = world->GetNetDriver();
+		if (netDriver)
+		{
+			TArray<UNetConnection*> netConnections = netDriver->ClientConnections;
+			if (netDriver->ServerConnection)
+			{
+				netConnections.Add(netDriver->ServerConnection);
+			}
+			for (const UNetConnection* connection : netConnections)
+			{
+				inBytesPerSecond += connection->InBytesPerSecond;
+				outBytesPerSecond += connection->OutBytesPerSecond;
+				connections++;
+			}
+		}
+
+		TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+		report->SetStringField(TEXT("map"), world->GetMapName());
+		report->SetNumberField(TEXT("netMode"), (int32)world->GetNetMode());
+		report->SetBoolField(TEXT("netSprintDash"), CVarNetSprintDash.GetValueOnGameThread() != 0);
+		report->SetNumberField(TEXT("moveResponses"), moveResponses);
+		report->SetNumberField(TEXT("corrections"), corrections);
+		report->SetNumberField(TEXT("correctionRate"), moveResponses > 0 ? (double)corrections / moveResponses : 0.0);
+		report->SetNumberField(TEXT("connections"), connections);
+		report->SetNumberField(TEXT("inBytesPerSecond"), inBytesPerSecond);
+		report->SetNumberField(TEXT("outBytesPerSecond"), outBytesPerSecond);
+#if DO_ENABLE_NET_TEST
+		if (netDriver)
+		{
+			report->SetNumberField(TEXT("pktLag"), netDriver->PacketSimulationSettings.PktLag);
+			report->SetNumberField(TEXT("pktLoss"), netDriver->PacketSimulationSettings.PktLoss);
+		}
+#endif
+
+		URebellionBenchmarkSubsystem::SaveReport(report, TEXT("Movement"), true);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs movementReportCommand(
+		TEXT("Rebellion.Movement.Report"),
+		TEXT("Writes the owning client's movement correction rate and this machine's connection bandwidth as JSON to Saved/Profiling/Rebellion. Args: [reset]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&WriteReport));
+}
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "RebellionCharacterMovementComponent.generated.h"
+
+/** CustomMovementMode values while MovementMode is MOVE_Custom */
+UENUM(BlueprintType)
+enum class ERebellionMovementMode : uint8
+{
+	NONE,
+	//Straight line at dashSpeed for dashSteps fixed steps
+	DASH
+};
+
+/** Server corrections also carry the dash state, so the client replays its moves from the server's */
+struct FRebellionMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+
+	int32 dashStepsRemaining = 0;
+	float dashStepAccumulator = 0.f;
+	float dashCooldownRemaining = 0.f;
+	FVector dashDirection = FVector::ForwardVector;
+};
+
+/**
+ * Character movement with sprint and dash inside the prediction model. Both are input flags sent in the
+ * compressed flags of every saved move, so the server simulates them from the same moves the client
+ * predicted. Dash is its own movement mode that advances in fixed dashStepSeconds steps, so it covers
+ * the same distance whatever the frame rate, and its cooldown counts down inside the simulation.
+ * Corrections carry the dash state back to the client so replayed moves resume from the server's.
+ * Rebellion.Movement.Report writes the correction rate and connection bandwidth of a networked session.
+ */
+UCLASS()
+class REBELLION_API URebellionCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	URebellionCharacterMovementComponent();
+
+	virtual float GetMaxSpeed() const override;
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void ClientHandleMoveResponse(const struct FCharacterMoveResponseDataContainer& MoveResponse) override;
+
+	/** Input state, latched into the next saved move */
+	void SetWantsToSprint(bool bInWantsToSprint) { bWantsToSprint = bInWantsToSprint; }
+	void RequestDash() { bWantsToDash = true; }
+	bool WantsToSprint() const { return bWantsToSprint; }
+	bool WantsToDash() const { return bWantsToDash; }
+
+	/** Dash covering distance in about duration seconds, rounded to whole steps */
+	void ConfigureDash(float distance, float duration, float cooldown);
+
+	bool IsDashing() const { return MovementMode == MOVE_Custom && CustomMovementMode == (uint8)ERebellionMovementMode::DASH; }
+	bool CanDash() const;
+
+	/** Walking speed with the sprint flag set */
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Sprint")
+		float sprintSpeed;
+
+	/** Simulation step of the dash mode, every step moves dashSpeed * dashStepSeconds */
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Dash")
+		float dashStepSeconds;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Dash")
+		int32 dashSteps;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Dash")
+		float dashSpeed;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Dash")
+		float dashCooldown;
+	/** Dash where the controller looks instead of along the movement input, the control rotation is part of every move */
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Dash")
+		bool bDashAlongControlRotation;
+
+	/** Dash state, part of the simulation so corrections carry it */
+	int32 GetDashStepsRemaining() const { return dashStepsRemaining; }
+	float GetDashStepAccumulator() const { return dashStepAccumulator; }
+	float GetDashCooldownRemaining() const { return dashCooldownRemaining; }
+	const FVector& GetDashDirection() const { return dashDirection; }
+
+	/** Moves the server acknowledged and how many of them were corrections, counted on the owning client */
+	int32 GetMoveResponseCount() const { return moveResponseCount; }
+	int32 GetCorrectionCount() const { return correctionCount; }
+	void ResetNetStats() { moveResponseCount = 0; correctionCount = 0; }
+
+protected:
+
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+
+private:
+
+	void StartDash();
+	void PhysDash(float deltaTime, int32 Iterations);
+	void EndDash(float remainingTime, int32 Iterations);
+
+	bool bWantsToSprint = false;
+	//One shot, cleared by the move that consumes it
+	bool bWantsToDash = false;
+
+	FVector dashDirection = FVector::ForwardVector;
+	int32 dashStepsRemaining = 0;
+	//Time not yet spent on a whole step
+	float dashStepAccumulator = 0.f;
+	float dashCooldownRemaining = 0.f;
+
+	FRebellionMoveResponseDataContainer moveResponseData;
+	int32 moveResponseCount = 0;
+	int32 correctionCount = 0;
+};
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionCombatPackCommandlet.h"
+#include "AttackStartNotifyState.h"
+#include "CombatDataPack.h"
+#include "CombatDataSubsystem.h"
+#include "Rebellion.h"
+#include "RebellionCharacter.h"
+#include "Animation/AnimMontage.h"
+#include "Engine/DataTable.h"
+#include "Misc/Paths.h"
+
+static const TCHAR* defaultPackPawnPath = TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C");
+
+URebellionCombatPackCommandlet::URebellionCombatPackCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+//A section without an attack notify plays but never opens its attack window
+static bool HasAttackNotify(const UAnimMontage* montage, FName sectionName)
+{
+	const int32 sectionIndex = montage ? montage->GetSectionIndex(sectionName) : INDEX_NONE;
+	if (sectionIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const float sectionStart = montage->GetAnimCompositeSection(sectionIndex).GetTime();
+	const float sectionEnd = sectionStart + montage->GetSectionLength(sectionIndex);
+	for (const FAnimNotifyEvent& notify : montage->Notifies)
+	{
+		const float triggerTime = notify.GetTriggerTime();
+		if (Cast<UAttackStartNotifyState>(notify.NotifyStateClass) && triggerTime >= sectionStart && triggerTime < sectionEnd)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//One profile for the pawn class at pawnPath, keyed by that path so no other class picks it up
+static bool AddPawnProfile(FCombatDataPackWriter& writer, const FString& pawnPath, int32& outAttackCount)
+{
+	UClass* pawnClass = LoadClass<ARebellionCharacter>(nullptr, *pawnPath);
+	if (!pawnClass)
+	{
+		UE_LOG(LogRebellion, Error, TEXT("Could not load pawn class %s"), *pawnPath);
+		return false;
+	}
+	const ARebellionCharacter* pawnDefaults = pawnClass->GetDefaultObject<ARebellionCharacter>();
+
+	UDataTable* attackTable = pawnDefaults->playerAttackDataTable.LoadSynchronous();
+	if (!attackTable)
+	{
+		UE_LOG(LogRebellion, Error, TEXT("%s has no attack data table"), *pawnPath);
+		return false;
+	}
+
+	FCombatPackMovement movement;
+	movement.jumpHeight = pawnDefaults->jumpHeight;
+	movement.walkSpeed = pawnDefaults->walkSpeed;
+	movement.sprintSpeed = pawnDefaults->sprintSpeed;
+	movement.dashDistance = pawnDefaults->dashDistance;
+	movement.dashCooldown = pawnDefaults->dashCooldown;
+	movement.dashStopTimer = pawnDefaults->dashStopTimer;
+	//Same path ARebellionCharacter looks its profile up by
+	writer.AddProfile(pawnClass->GetPathName(), movement);
+
+	for (const TPair<FName, uint8*>& rowPair : attackTable->GetRowMap())
+	{
+		const FPlayerAttackMontage* row = reinterpret_cast<const FPlayerAttackMontage*>(rowPair.Value);
+		if (!row->montage)
+		{
+			UE_LOG(LogRebellion, Warning, TEXT("Attack row %s has no montage, skipped"), *rowPair.Key.ToString());
+			continue;
+		}
+
+		writer.AddAttack(rowPair.Key.ToString(), row->montage->GetPathName(), row->damage > 0.f ? row->damage : pawnDefaults->defaultAttackDamage);
+
+		//Same section naming and fallback count as ARebellionCharacter::BuildAttackMontageCache
+		const int32 sectionCount = row->animSectionCount > 0 ? row->animSectionCount : 3;
+		for (int32 step = 0; step < sectionCount; step++)
+		{
+			const FName sectionName(*FString::Printf(TEXT("start_%d"), step + 1));
+			if (!HasAttackNotify(row->montage, sectionName))
+			{
+				UE_LOG(LogRebellion, Warning, TEXT("%s section %s has no attack notify"), *row->montage->GetName(), *sectionName.ToString());
+			}
+
+			//Combos loop back to the first step
+			writer.AddSection(sectionName.ToString(), (step + 1) % sectionCount);
+		}
+		outAttackCount++;
+	}
+	return true;
+}
+
+int32 URebellionCombatPackCommandlet::Main(const FString& Params)
+{
+	FString pawnPaths = defaultPackPawnPath;
+	FParse::Value(*Params, TEXT("pawns="), pawnPaths, false);
+	FString outputPath = UCombatDataSubsystem::GetDefaultPackPath();
+	FParse::Value(*Params, TEXT("output="), outputPath);
+
+	TArray<FString> pawnPathList;
+	pawnPaths.ParseIntoArray(pawnPathList, TEXT(","));
+
+	FCombatDataPackWriter writer;
+	int32 attackCount = 0;
+	for (const FString& pawnPath : pawnPathList)
+	{
+		if (!AddPawnProfile(writer, pawnPath.TrimStartAndEnd(), attackCount))
+		{
+			return 1;
+		}
+	}
+
+	if (!writer.Save(outputPath))
+	{
+		UE_LOG(LogRebellion, Error, TEXT("Could not write combat pack %s"), *outputPath);
+		return 1;
+	}
+
+	UE_LOG(LogRebellion, Display, TEXT("Wrote combat pack version %u with %d profiles and %d attacks to %s"), combatPackVersion, pawnPathList.Num(), attackCount, *FPaths::ConvertRelativePathToFull(outputPath));
+	return 0;
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RebellionCombatPackCommandlet.generated.h"
+
+/**
+ * Compiles each pawn class's attack data table, combo graph and movement defaults into the binary
+ * pack UCombatDataSubsystem maps at runtime, one profile per class. Run before cooking, the pack is
+ * staged loose (DirectoriesToAlwaysStageAsNonUFS) so it can be mapped straight from disk:
+ *
+ *	UE4Editor-Cmd Rebellion.uproject -run=RebellionCombatPack [-pawns=/Game/.../A.A_C,/Game/.../B.B_C] [-output=path.rcpk]
+ */
+UCLASS()
+class URebellionCombatPackCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	URebellionCombatPackCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionCombatState.h"
+#include "Rebellion.h"
+#include "RebellionCharacter.h"
+#include "RebellionBenchmarkSubsystem.h"
+#include "CoreGlobals.h"
+#include "EngineUtils.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+static TAutoConsoleVariable<int32> CVarNetPackedCombatState(
+	TEXT("Rebellion.Net.PackedCombatState"),
+	1,
+	TEXT("Write combat state bit packed and delta compressed. 0 writes every field at full width on every change, for bandwidth comparisons."),
+	ECVF_Default);
+
+int64 FCombatNetCounters::stateBits = 0;
+int32 FCombatNetCounters::stateUpdates = 0;
+int64 FCombatNetCounters::eventBits = 0;
+int32 FCombatNetCounters::events = 0;
+double FCombatNetCounters::resetSeconds = 0.0;
+
+void FCombatNetCounters::Reset()
+{
+	stateBits = 0;
+	stateUpdates = 0;
+	eventBits = 0;
+	events = 0;
+	resetSeconds = FPlatformTime::Seconds();
+}
+
+/** Combat state a connection was last sent, the engine rolls it back to the acknowledged one on packet loss */
+class FRebellionCombatStateBase : public INetDeltaBaseState
+{
+public:
+
+	explicit FRebellionCombatStateBase(const FRebellionCombatState& inState)
+		: state(inState)
+	{
+	}
+
+	virtual bool IsStateEqual(INetDeltaBaseState* otherState) override
+	{
+		return state == static_cast<FRebellionCombatStateBase*>(otherState)->state;
+	}
+
+	FRebellionCombatState state;
+};
+
+bool FRebellionCombatState::IsPackingEnabled()
+{
+	return CVarNetPackedCombatState.GetValueOnAnyThread() != 0;
+}
+
+bool FRebellionCombatState::operator==(const FRebellionCombatState& other) const
+{
+	return healthTenths == other.healthTenths
+		&& attackType == other.attackType
+		&& attackWindowState == other.attackWindowState
+		&& comboStep == other.comboStep
+		&& bKeyboardEnabled == other.bKeyboardEnabled
+		&& bDashing == other.bDashing
+		&& bBlocking == other.bBlocking
+		&& attackStartTick == other.attackStartTick
+		&& dashCooldownEndTick == other.dashCooldownEndTick;
+}
+
+uint8 FRebellionCombatState::GetChangedFields(const FRebellionCombatState& base) const
+{
+	uint8 fields = 0;
+	fields |= healthTenths != base.healthTenths ? HEALTH : 0;
+	fields |= attackType != base.attackType || comboStep != base.comboStep || attackStartTick != base.attackStartTick ? ATTACK_START : 0;
+	fields |= attackWindowState != base.attackWindowState ? ATTACK_WINDOW : 0;
+	fields |= bKeyboardEnabled != base.bKeyboardEnabled || bDashing != base.bDashing || bBlocking != base.bBlocking ? FLAGS : 0;
+	fields |= dashCooldownEndTick != base.dashCooldownEndTick ? DASH_COOLDOWN : 0;
+	return fields;
+}
+
+void FRebellionCombatState::SerializeFields(FArchive& Ar, uint8 fields, bool bPacked)
+{
+	if (!bPacked)
+	{
+		//What the same data costs as the character's own members: float health and times, byte enums and bools, int32 combo step
+		float health = GetHealth();
+		int32 fullComboStep = comboStep;
+		float attackStartTime = attackStartTick / TicksPerSecond;
+		float dashCooldownEndTime = dashCooldownEndTick / TicksPerSecond;
+		uint8 keyboardEnabled = bKeyboardEnabled ? 1 : 0;
+		uint8 dashing = bDashing ? 1 : 0;
+		uint8 blocking = bBlocking ? 1 : 0;
+		Ar << health << attackType << fullComboStep << attackStartTime << attackWindowState << keyboardEnabled << dashing << blocking << dashCooldownEndTime;
+		if (Ar.IsLoading())
+		{
+			SetHealth(health);
+			comboStep = (uint8)fullComboStep;
+			attackStartTick = (uint16)FMath::RoundToInt(attackStartTime * TicksPerSecond);
+			dashCooldownEndTick = (uint16)FMath::RoundToInt(dashCooldownEndTime * TicksPerSecond);
+			bKeyboardEnabled = keyboardEnabled != 0;
+			bDashing = dashing != 0;
+			bBlocking = blocking != 0;
+		}
+		return;
+	}
+
+	if (fields & HEALTH)
+	{
+		Ar << healthTenths;
+	}
+	if (fields & ATTACK_START)
+	{
+		Ar.SerializeBits(&attackType, AttackTypeBits);
+		Ar.SerializeBits(&comboStep, ComboStepBits);
+		Ar << attackStartTick;
+	}
+	if (fields & ATTACK_WINDOW)
+	{
+		Ar.SerializeBits(&attackWindowState, WindowStateBits);
+	}
+	if (fields & FLAGS)
+	{
+		uint8 flags = (bKeyboardEnabled ? 1 : 0) | (bDashing ? 2 : 0) | (bBlocking ? 4 : 0);
+		Ar.SerializeBits(&flags, 3);
+		bKeyboardEnabled = (flags & 1) != 0;
+		bDashing = (flags & 2) != 0;
+		bBlocking = (flags & 4) != 0;
+	}
+	if (fields & DASH_COOLDOWN)
+	{
+		Ar << dashCooldownEndTick;
+	}
+}
+
+bool FRebellionCombatState::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	//No object references, nothing to gather or map
+	if (DeltaParms.GatherGuidReferences || DeltaParms.MoveGuidToUnmapped || DeltaParms.bUpdateUnmappedObjects)
+	{
+		return false;
+	}
+
+	if (DeltaParms.Writer)
+	{
+		//No base for a new channel, that update carries everything
+		const FRebellionCombatStateBase* base = static_cast<const FRebellionCombatStateBase*>(DeltaParms.OldState);
+		const uint8 changedFields = base ? GetChangedFields(base->state) : (uint8)ALL_FIELDS;
+		if (changedFields == 0)
+		{
+			return false;
+		}
+		*DeltaParms.NewState = MakeShared<FRebellionCombatStateBase>(*this);
+
+		FBitWriter& writer = *DeltaParms.Writer;
+		const int64 startBits = writer.GetNumBits();
+		uint8 packed = IsPackingEnabled() ? 1 : 0;
+		uint8 fields = packed ? changedFields : (uint8)ALL_FIELDS;
+		writer.SerializeBits(&packed, 1);
+		if (packed)
+		{
+			writer.SerializeBits(&fields, FieldBits);
+		}
+		SerializeFields(writer, fields, packed != 0);
+
+		FCombatNetCounters::stateBits += writer.GetNumBits() - startBits;
+		FCombatNetCounters::stateUpdates++;
+		return true;
+	}
+
+	if (DeltaParms.Reader)
+	{
+		FBitReader& reader = *DeltaParms.Reader;
+		uint8 packed = 0;
+		uint8 fields = ALL_FIELDS;
+		reader.SerializeBits(&packed, 1);
+		if (packed)
+		{
+			reader.SerializeBits(&fields, FieldBits);
+		}
+		SerializeFields(reader, fields, packed != 0);
+		return !reader.IsError();
+	}
+
+	return true;
+}
+
+bool FRebellionAttackEvent::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar.SerializeBits(&attackType, FRebellionCombatState::AttackTypeBits);
+	Ar.SerializeBits(&comboStep, FRebellionCombatState::ComboStepBits);
+	Ar << startTick;
+
+	if (Ar.IsSaving())
+	{
+		FCombatNetCounters::eventBits += FRebellionCombatState::AttackTypeBits + FRebellionCombatState::ComboStepBits + 16;
+		FCombatNetCounters::events++;
+	}
+	bOutSuccess = true;
+	return true;
+}
+
+bool FRebellionShotEvent::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	direction.NetSerialize(Ar, Map, bOutSuccess);
+	Ar << startTick;
+	Ar << shotId;
+	return true;
+}
+
+namespace RebellionCombatNetReport
+{
+	static void WriteReport(const TArray<FString>& args, UWorld* world)
+	{
+		if (!world)
+		{
+			return;
+		}
+
+		if (args.Contains(TEXT("reset")))
+		{
+			FCombatNetCounters::Reset();
+			UE_LOG(LogRebellion, Display, TEXT("Combat net counters reset"));
+			return;
+		}
+
+		int32 characters = 0;
+		for (TActorIterator<ARebellionCharacter> iterator(world); iterator; ++iterator)
+		{
+			characters++;
+		}
+
+		//Current rates of every connection this machine has, as in Rebellion.Movement.Report
+		int32 outBytesPerSecond = 0;
+		int32 connections = 0;
+		if (const UNetDriver* netDriver = world->GetNetDriver())
+		{
+			for (const UNetConnection* connection : netDriver->ClientConnections)
+			{
+				outBytesPerSecond += connection->OutBytesPerSecond;
+				connections++;
+			}
+		}
+
+		//Counted from engine start until the first reset
+		const double startSeconds = FCombatNetCounters::resetSeconds > 0.0 ? FCombatNetCounters::resetSeconds : GStartTime;
+		const double seconds = FMath::Max(FPlatformTime::Seconds() - startSeconds, 0.001);
+		const double perCharacterSecond = 1.0 / (FMath::Max(characters, 1) * seconds);
+
+		TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+		report->SetStringField(TEXT("map"), world->GetMapName());
+		report->SetNumberField(TEXT("netMode"), (int32)world->GetNetMode());
+		report->SetBoolField(TEXT("packedCombatState"), FRebellionCombatState::IsPackingEnabled());
+		report->SetNumberField(TEXT("seconds"), seconds);
+		report->SetNumberField(TEXT("characters"), characters);
+		report->SetNumberField(TEXT("connections"), connections);
+		report->SetNumberField(TEXT("stateUpdates"), FCombatNetCounters::stateUpdates);
+		report->SetNumberField(TEXT("stateBitsPerUpdate"), FCombatNetCounters::stateUpdates > 0 ? (double)FCombatNetCounters::stateBits / FCombatNetCounters::stateUpdates : 0.0);
+		report->SetNumberField(TEXT("stateBytesPerCharacterPerSecond"), FCombatNetCounters::stateBits / 8.0 * perCharacterSecond);
+		report->SetNumberField(TEXT("attackEvents"), FCombatNetCounters::events);
+		report->SetNumberField(TEXT("eventBytesPerCharacterPerSecond"), FCombatNetCounters::eventBits / 8.0 * perCharacterSecond);
+		report->SetNumberField(TEXT("outBytesPerSecond"), outBytesPerSecond);
+		report->SetNumberField(TEXT("outBytesPerConnectionPerCharacter"), connections > 0 && characters > 0 ? (double)outBytesPerSecond / connections / characters : 0.0);
+
+		URebellionBenchmarkSubsystem::SaveReport(report, TEXT("CombatNet"), true);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs combatNetReportCommand(
+		TEXT("Rebellion.Net.CombatReport"),
+		TEXT("Writes the combat state and attack event bytes this server sent per character per second since the last reset as JSON to Saved/Profiling/Rebellion. Args: [reset]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&WriteReport));
+}
@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "RebellionCombatState.generated.h"
+
+/**
+ * A character's replicated combat state in one property: health, the current attack and its window,
+ * input lock, block and dash. Enums and the combo step are written in as few bits as they need, health in
+ * tenths of a point and times as 16 bit network time ticks, so a running timer doesn't change the state.
+ * Only the fields that differ from the last state the connection acknowledged are written, a lost packet
+ * makes the next update resend everything since. Rebellion.Net.PackedCombatState 0 writes every field
+ * at the width of the character member it comes from instead, for comparing bandwidth.
+ */
+USTRUCT()
+struct REBELLION_API FRebellionCombatState
+{
+	GENERATED_BODY()
+
+	static constexpr float TicksPerSecond = 60.f;
+	static constexpr int32 AttackTypeBits = 2;
+	static constexpr int32 WindowStateBits = 2;
+	static constexpr int32 ComboStepBits = 4;
+
+	//Health in tenths of a point
+	uint16 healthTenths = 0;
+	//EAttackType and EAttackWindowState, RebellionCharacter.cpp checks they fit their bits
+	uint8 attackType = 0;
+	uint8 attackWindowState = 0;
+	//Attack montage section playing
+	uint8 comboStep = 0;
+	bool bKeyboardEnabled = true;
+	bool bDashing = false;
+	//The server resolves damage, so a client's block only counts once it is here
+	bool bBlocking = false;
+	//Network time ticks the current attack started at and the dash cooldown ends at, 0 while no cooldown runs
+	uint16 attackStartTick = 0;
+	uint16 dashCooldownEndTick = 0;
+
+	void SetHealth(float health) { healthTenths = (uint16)FMath::Clamp(FMath::RoundToInt(health * 10.f), 0, (int32)MAX_uint16); }
+	float GetHealth() const { return healthTenths / 10.f; }
+
+	/** Network time as a tick, wraps about every 18 minutes */
+	static uint16 ToNetTick(float networkTime) { return (uint16)(FMath::FloorToInt(networkTime * TicksPerSecond) & MAX_uint16); }
+	/** Seconds from one tick to another, negative if toTick is earlier. Right for ticks within 9 minutes of each other */
+	static float GetTickSeconds(uint16 fromTick, uint16 toTick) { return (int16)(uint16)(toTick - fromTick) / TicksPerSecond; }
+
+	static bool IsPackingEnabled();
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+	bool operator==(const FRebellionCombatState& other) const;
+	bool operator!=(const FRebellionCombatState& other) const { return !(*this == other); }
+
+private:
+
+	/** Fields of one update, a bit each in the mask that leads it */
+	enum EField : uint8
+	{
+		HEALTH = 1 << 0,
+		ATTACK_START = 1 << 1,
+		ATTACK_WINDOW = 1 << 2,
+		FLAGS = 1 << 3,
+		DASH_COOLDOWN = 1 << 4,
+		ALL_FIELDS = (1 << 5) - 1
+	};
+	static constexpr int32 FieldBits = 5;
+
+	uint8 GetChangedFields(const FRebellionCombatState& base) const;
+	void SerializeFields(FArchive& Ar, uint8 fields, bool bPacked);
+};
+
+template<>
+struct TStructOpsTypeTraits<FRebellionCombatState> : public TStructOpsTypeTraitsBase2<FRebellionCombatState>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
+
+/** An attack as it is sent to the server and on to simulated proxies, 22 bits */
+USTRUCT()
+struct REBELLION_API FRebellionAttackEvent
+{
+	GENERATED_BODY()
+
+	uint8 attackType = 0;
+	uint8 comboStep = 0;
+	//Network time tick the attack started at, receivers start the montage that far in
+	uint16 startTick = 0;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FRebellionAttackEvent> : public TStructOpsTypeTraitsBase2<FRebellionAttackEvent>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/** A ranged shot as it is sent to the server and on to simulated proxies, 80 bits */
+USTRUCT()
+struct REBELLION_API FRebellionShotEvent
+{
+	GENERATED_BODY()
+
+	//Aim after leaning towards the shot target, receivers fire from their own copy of the shooter
+	FVector_NetQuantizeNormal direction = FVector::ForwardVector;
+	//Network time tick the shot was fired at, receivers start the projectile that far along
+	uint16 startTick = 0;
+	//Shooter's count of its shots, what its hit claims name the shot by
+	uint16 shotId = 0;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FRebellionShotEvent> : public TStructOpsTypeTraitsBase2<FRebellionShotEvent>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/** Combat state and attack event payload bits this machine has written, for Rebellion.Net.CombatReport */
+struct FCombatNetCounters
+{
+	static int64 stateBits;
+	static int32 stateUpdates;
+	static int64 eventBits;
+	static int32 events;
+	static double resetSeconds;
+
+	static void Reset();
+};
@@ -1,15 +1,106 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "RebellionGameMode.h"
+#include "Rebellion.h"
 #include "RebellionCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "CombatDataSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/PlayerController.h"
 
 ARebellionGameMode::ARebellionGameMode()
 {
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	// set default pawn class to our Blueprinted character, swapped in once it has streamed in
+	defaultPawnSoftClass = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/ThirdPersonCPP/Blueprints/ThirdPersonCharacter.ThirdPersonCharacter_C")));
+	DefaultPawnClass = ARebellionCharacter::StaticClass();
+}
+
+void ARebellionGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	preloadStartSeconds = FPlatformTime::Seconds();
+
+	//Native defaults go in the same request, a Blueprint pawn usually keeps them
+	TArray<FSoftObjectPath> preloadPaths;
+	if (!defaultPawnSoftClass.IsNull())
+	{
+		preloadPaths.Add(defaultPawnSoftClass.ToSoftObjectPath());
+	}
+	const UCombatDataSubsystem* combatData = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCombatDataSubsystem>() : nullptr;
+	GetDefault<ARebellionCharacter>()->GetCombatAssetPaths(combatData ? combatData->GetPack() : nullptr, preloadPaths);
+
+	pawnClassPreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(preloadPaths,
+		FStreamableDelegate::CreateUObject(this, &ARebellionGameMode::OnPawnClassPreloaded),
+		FStreamableManager::AsyncLoadHighPriority, false, false, TEXT("RebellionPawnPreload"));
+	if (!pawnClassPreloadHandle.IsValid())
+	{
+		OnCombatPreloadComplete();
+	}
+}
+
+void ARebellionGameMode::OnPawnClassPreloaded()
+{
+	UClass* pawnClass = defaultPawnSoftClass.Get();
+	if (pawnClass)
+	{
+		DefaultPawnClass = pawnClass;
+	}
+	else if (!defaultPawnSoftClass.IsNull())
+	{
+		UE_LOG(LogRebellion, Warning, TEXT("Could not load %s, using %s"), *defaultPawnSoftClass.ToString(), *GetNameSafe(DefaultPawnClass));
+	}
+
+	//The Blueprint can point at different attack data than the native class
+	TArray<FSoftObjectPath> combatPaths;
+	if (const ARebellionCharacter* pawnDefaults = Cast<ARebellionCharacter>(DefaultPawnClass->GetDefaultObject()))
+	{
+		const UCombatDataSubsystem* combatData = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCombatDataSubsystem>() : nullptr;
+		pawnDefaults->GetCombatAssetPaths(combatData ? combatData->GetPack() : nullptr, combatPaths);
+	}
+
+	if (combatPaths.Num() > 0)
+	{
+		combatPreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(combatPaths,
+			FStreamableDelegate::CreateUObject(this, &ARebellionGameMode::OnCombatPreloadComplete),
+			FStreamableManager::AsyncLoadHighPriority, false, false, TEXT("RebellionCombatPreload"));
+	}
+	if (!combatPreloadHandle.IsValid())
+	{
+		OnCombatPreloadComplete();
+	}
+}
+
+void ARebellionGameMode::OnCombatPreloadComplete()
+{
+	if (bCombatPreloadComplete)
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		return;
 	}
+	bCombatPreloadComplete = true;
+
+	UE_LOG(LogRebellion, Log, TEXT("Combat preload finished in %.1f ms, starting %d waiting players"),
+		(FPlatformTime::Seconds() - preloadStartSeconds) * 1000.0, playersWaitingForPreload.Num());
+
+	TArray<APlayerController*> waitingPlayers = MoveTemp(playersWaitingForPreload);
+	for (APlayerController* player : waitingPlayers)
+	{
+		if (IsValid(player))
+		{
+			Super::HandleStartingNewPlayer_Implementation(player);
+		}
+	}
+}
+
+void ARebellionGameMode::HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer)
+{
+	//Spawning before the preload would give the player the fallback pawn without its attacks
+	if (!bCombatPreloadComplete)
+	{
+		playersWaitingForPreload.AddUnique(NewPlayer);
+		return;
+	}
+
+	Super::HandleStartingNewPlayer_Implementation(NewPlayer);
 }
@@ -6,6 +6,12 @@
 #include "GameFramework/GameModeBase.h"
 #include "RebellionGameMode.generated.h"
 
+struct FStreamableHandle;
+
+/**
+ * Streams the default pawn class and its combat assets in asynchronously at map load
+ * and holds players back until they are resident, nothing is hard loaded by a class default object.
+ */
 UCLASS(minimalapi)
 class ARebellionGameMode : public AGameModeBase
 {
@@ -13,7 +19,28 @@ class ARebellionGameMode : public AGameModeBase
 
 public:
 	ARebellionGameMode();
-};
 
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer) override;
+
+	/** Blueprinted character, becomes DefaultPawnClass once the preload finishes */
+	UPROPERTY(EditDefaultsOnly, Category = Classes)
+		TSoftClassPtr<APawn> defaultPawnSoftClass;
+
+	/** Players are only started once this is true */
+	bool IsCombatPreloadComplete() const { return bCombatPreloadComplete; }
 
+private:
 
+	void OnPawnClassPreloaded();
+	void OnCombatPreloadComplete();
+
+	//Held for the whole match so the preloaded assets stay resident between pawns
+	TSharedPtr<FStreamableHandle> pawnClassPreloadHandle;
+	TSharedPtr<FStreamableHandle> combatPreloadHandle;
+	bool bCombatPreloadComplete = false;
+	double preloadStartSeconds = 0.0;
+
+	UPROPERTY()
+		TArray<APlayerController*> playersWaitingForPreload;
+};
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionLog.h"
+#include "Rebellion.h"
+#include "CoreGlobals.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/Engine.h"
+
+static_assert((FRebellionLog::Capacity & (FRebellionLog::Capacity - 1)) == 0, "Ring buffer capacity must be a power of two");
+
+static int32 runtimeLogLevel = REBELLION_LOG_LEVEL_TRACE;
+static FAutoConsoleVariableRef runtimeLogLevelCVar(
+	TEXT("Rebellion.Log.Level"),
+	runtimeLogLevel,
+	TEXT("Lowest gameplay log level recorded (0 trace - 4 error, 5 off)"));
+
+static int32 echoLogLevel = REBELLION_LOG_LEVEL_INFO;
+static FAutoConsoleVariableRef echoLogLevelCVar(
+	TEXT("Rebellion.Log.EchoLevel"),
+	echoLogLevel,
+	TEXT("Lowest gameplay log level also written to LogRebellion"));
+
+static int32 screenLogLevel = REBELLION_LOG_LEVEL_WARNING;
+static FAutoConsoleVariableRef screenLogLevelCVar(
+	TEXT("Rebellion.Log.ScreenLevel"),
+	screenLogLevel,
+	TEXT("Lowest gameplay log level printed on screen (development builds only)"));
+
+FRebellionLog::FEntry FRebellionLog::entries[FRebellionLog::Capacity];
+volatile int64 FRebellionLog::writeIndex = 0;
+
+bool FRebellionLog::IsEnabled(ELogLevel level)
+{
+	return (int32)level >= runtimeLogLevel;
+}
+
+void FRebellionLog::Write(ELogLevel level, const TCHAR* format, ...)
+{
+	//Claim a slot, writers never wait on each other
+	const int64 index = FPlatformAtomics::InterlockedIncrement(&writeIndex) - 1;
+	FEntry& entry = entries[index & (Capacity - 1)];
+	FPlatformAtomics::AtomicStore(&entry.sequence, (int64)0);
+
+	entry.time = FPlatformTime::Seconds();
+	entry.frame = GFrameCounter;
+	entry.level = level;
+	GET_VARARGS(entry.message, MaxMessageLength, MaxMessageLength - 1, format, format);
+
+	FPlatformAtomics::AtomicStore(&entry.sequence, index + 1);
+
+	if ((int32)level >= echoLogLevel)
+	{
+		switch (level)
+		{
+		case ELogLevel::TRACE:
+			UE_LOG(LogRebellion, VeryVerbose, TEXT("%s"), entry.message);
+			break;
+		case ELogLevel::DEBUG:
+			UE_LOG(LogRebellion, Verbose, TEXT("%s"), entry.message);
+			break;
+		case ELogLevel::WARNING:
+			UE_LOG(LogRebellion, Warning, TEXT("%s"), entry.message);
+			break;
+		case ELogLevel::ERROR:
+			UE_LOG(LogRebellion, Error, TEXT("%s"), entry.message);
+			break;
+		default:
+			UE_LOG(LogRebellion, Log, TEXT("%s"), entry.message);
+			break;
+		}
+	}
+
+#if REBELLION_LOG_SCREEN
+	//Only print when the GEngine object is available
+	if ((int32)level >= screenLogLevel && GEngine && IsInGameThread())
+	{
+		//default color
+		FColor logColor = FColor::Cyan;
+		//Change color based on type
+		switch (level)
+		{
+		case ELogLevel::TRACE:
+			logColor = FColor::Green;
+			break;
+		case ELogLevel::INFO:
+			logColor = FColor::White;
+			break;
+		case ELogLevel::WARNING:
+			logColor = FColor::Yellow;
+			break;
+		case ELogLevel::ERROR:
+			logColor = FColor::Red;
+			break;
+		default:
+			break;
+		}
+		//Print message and leave on screen for a duration(4.5 currently)
+		GEngine->AddOnScreenDebugMessage(-1, 4.5f, logColor, entry.message);
+	}
+#endif
+}
+
+void FRebellionLog::Dump()
+{
+	const int64 end = FPlatformAtomics::AtomicRead(&writeIndex);
+	const int64 start = FMath::Max<int64>(0, end - Capacity);
+
+	UE_LOG(LogRebellion, Display, TEXT("---- Rebellion log, last %lld messages ----"), end - start);
+	for (int64 index = start; index < end; index++)
+	{
+		const FEntry& slot = entries[index & (Capacity - 1)];
+		if (FPlatformAtomics::AtomicRead(&slot.sequence) != index + 1)
+		{
+			continue;
+		}
+		//Copy out, then skip it if a writer reused the slot while we were reading
+		const double time = slot.time;
+		const uint64 frame = slot.frame;
+		const ELogLevel level = slot.level;
+		TCHAR message[MaxMessageLength];
+		FCString::Strncpy(message, slot.message, MaxMessageLength);
+		if (FPlatformAtomics::AtomicRead(&slot.sequence) != index + 1)
+		{
+			continue;
+		}
+		UE_LOG(LogRebellion, Display, TEXT("[%.4f][%llu][%d] %s"), time, frame, (int32)level, message);
+	}
+}
+
+static FAutoConsoleCommand dumpLogCommand(
+	TEXT("Rebellion.Log.Dump"),
+	TEXT("Prints the gameplay log ring buffer to LogRebellion"),
+	FConsoleCommandDelegate::CreateStatic(&FRebellionLog::Dump));
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RebellionLog.generated.h"
+
+//MH added for tracking
+UENUM(BlueprintType)
+enum class ELogLevel : uint8 
+{
+	TRACE			UMETA(DisplayName = "Trace"),
+	DEBUG			UMETA(DisplayName = "Debug"),
+	INFO			UMETA(DisplayName = "Info"),
+	WARNING			UMETA(DisplayName = "Warning"),
+	ERROR			UMETA(DisplayName = "Error")
+};
+
+//Numeric twins of ELogLevel so the compile time check can be pasted from the level name
+#define REBELLION_LOG_LEVEL_TRACE	0
+#define REBELLION_LOG_LEVEL_DEBUG	1
+#define REBELLION_LOG_LEVEL_INFO	2
+#define REBELLION_LOG_LEVEL_WARNING	3
+#define REBELLION_LOG_LEVEL_ERROR	4
+#define REBELLION_LOG_LEVEL_NONE	5
+
+//Lowest level compiled in, can be overridden from Rebellion.Build.cs
+#ifndef REBELLION_LOG_COMPILE_LEVEL
+	#if UE_BUILD_SHIPPING
+		#define REBELLION_LOG_COMPILE_LEVEL REBELLION_LOG_LEVEL_NONE
+	#elif UE_BUILD_TEST
+		#define REBELLION_LOG_COMPILE_LEVEL REBELLION_LOG_LEVEL_WARNING
+	#else
+		#define REBELLION_LOG_COMPILE_LEVEL REBELLION_LOG_LEVEL_TRACE
+	#endif
+#endif
+
+//On screen messages only exist in development builds
+#define REBELLION_LOG_SCREEN !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+/**
+ * REB_LOG(INFO, "Attack %d", index)
+ * Levels below REBELLION_LOG_COMPILE_LEVEL are a constant false branch, so neither the format nor
+ * the arguments are evaluated and the call is removed by the compiler.
+ */
+#define REB_LOG(Level, Format, ...) \
+	do \
+	{ \
+		if (REBELLION_LOG_LEVEL_##Level >= REBELLION_LOG_COMPILE_LEVEL && FRebellionLog::IsEnabled(ELogLevel::Level)) \
+		{ \
+			FRebellionLog::Write(ELogLevel::Level, TEXT(Format), ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+/**
+ * Gameplay log. Messages are formatted into a fixed size stack buffer and written to a lock free
+ * ring buffer, which keeps the last Capacity messages and can be dumped with Rebellion.Log.Dump.
+ * Rebellion.Log.Level filters at runtime, Rebellion.Log.EchoLevel/ScreenLevel pick what also goes to
+ * LogRebellion and the screen.
+ */
+class REBELLION_API FRebellionLog
+{
+public:
+	static constexpr int32 Capacity = 1024;
+	static constexpr int32 MaxMessageLength = 160;
+
+	struct FEntry
+	{
+		//Write index + 1 once the entry is complete, 0 while it is being written
+		volatile int64 sequence;
+		double time;
+		uint64 frame;
+		ELogLevel level;
+		TCHAR message[MaxMessageLength];
+	};
+
+	static bool IsEnabled(ELogLevel level);
+
+	static void Write(ELogLevel level, const TCHAR* format, ...);
+
+	/** Prints the buffered messages, oldest first, to LogRebellion */
+	static void Dump();
+
+private:
+	static FEntry entries[Capacity];
+	static volatile int64 writeIndex;
+};
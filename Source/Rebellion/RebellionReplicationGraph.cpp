@@ -0,0 +1,221 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionReplicationGraph.h"
+#include "RebellionLog.h"
+#include "RebellionStats.h"
+#include "ReplicationGraphTypes.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/Character.h"
+#include "UObject/UObjectIterator.h"
+
+static TAutoConsoleVariable<float> CVarNetGridCellSize(
+	TEXT("Rebellion.Net.GridCellSize"),
+	10000.f,
+	TEXT("Size in cm of the replication graph's spatial cells. Read when a server net driver starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarNetGridExtent(
+	TEXT("Rebellion.Net.GridExtent"),
+	200000.f,
+	TEXT("Half size in cm of the area the grid is laid out over before it has to grow. Read when a server net driver starts."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarNetIdleDormancySeconds(
+	TEXT("Rebellion.Net.IdleDormancySeconds"),
+	2.f,
+	TEXT("Characters nobody controls go dormant after standing idle this long. 0 disables idle dormancy and wakes them all."),
+	ECVF_Default);
+
+//Slower than this counts as standing still, root motion and movement input both show up in the velocity
+static const float idleSpeedSquared = 1.f;
+
+void URebellionReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	//Blueprint classes loaded later find their native parent here
+	int32 routedClasses = 0;
+	for (TObjectIterator<UClass> iterator; iterator; ++iterator)
+	{
+		UClass* actorClass = *iterator;
+		const AActor* actorDefaults = Cast<AActor>(actorClass->GetDefaultObject(false));
+		if (!actorDefaults || !actorDefaults->GetIsReplicated() || actorClass->HasAnyClassFlags(CLASS_Abstract | CLASS_NewerVersionExists)
+			|| actorClass->GetName().StartsWith(TEXT("SKEL_")) || actorClass->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		const ERebellionClassRepPolicy policy = ComputeClassPolicy(actorDefaults);
+		classPolicies.Set(actorClass, policy);
+
+		FClassReplicationInfo classInfo;
+		classInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(actorDefaults->NetUpdateFrequency);
+		if (policy == ERebellionClassRepPolicy::SPATIALIZE_STATIC || policy == ERebellionClassRepPolicy::SPATIALIZE_DYNAMIC || policy == ERebellionClassRepPolicy::SPATIALIZE_DORMANCY)
+		{
+			classInfo.SetCullDistanceSquared(actorDefaults->NetCullDistanceSquared);
+		}
+		GlobalActorReplicationInfoMap.SetClassInfo(actorClass, classInfo);
+		routedClasses++;
+	}
+
+	REB_LOG(INFO, "Replication graph routed %d replicated classes", routedClasses);
+}
+
+ERebellionClassRepPolicy URebellionReplicationGraph::ComputeClassPolicy(const AActor* actorDefaults)
+{
+	//Player controllers, only their own connection's node gathers them
+	if (actorDefaults->bOnlyRelevantToOwner)
+	{
+		return ERebellionClassRepPolicy::NOT_ROUTED;
+	}
+
+	//Game state and player states, and anything without a location to put in a cell
+	const USceneComponent* root = actorDefaults->GetRootComponent();
+	if (actorDefaults->bAlwaysRelevant || !root)
+	{
+		return ERebellionClassRepPolicy::RELEVANT_ALL_CONNECTIONS;
+	}
+
+	if (actorDefaults->IsA<ACharacter>())
+	{
+		return ERebellionClassRepPolicy::SPATIALIZE_DORMANCY;
+	}
+	return root->Mobility == EComponentMobility::Static ? ERebellionClassRepPolicy::SPATIALIZE_STATIC : ERebellionClassRepPolicy::SPATIALIZE_DYNAMIC;
+}
+
+ERebellionClassRepPolicy URebellionReplicationGraph::GetClassPolicy(const UClass* actorClass)
+{
+	const ERebellionClassRepPolicy* policy = classPolicies.Get(actorClass);
+	return policy ? *policy : ERebellionClassRepPolicy::NOT_ROUTED;
+}
+
+void URebellionReplicationGraph::InitGlobalGraphNodes()
+{
+	Super::InitGlobalGraphNodes();
+
+	//Cells are addressed from the bias, so the level's negative coordinates land in cell zero upwards
+	const float gridExtent = CVarNetGridExtent.GetValueOnGameThread();
+	gridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	gridNode->CellSize = CVarNetGridCellSize.GetValueOnGameThread();
+	gridNode->SpatialBias = FVector2D(-gridExtent, -gridExtent);
+	AddGlobalGraphNode(gridNode);
+
+	alwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(alwaysRelevantNode);
+}
+
+void URebellionReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* ConnectionManager)
+{
+	Super::InitConnectionGraphNodes(ConnectionManager);
+
+	//The connection's player controller and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* connectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(connectionNode, ConnectionManager);
+}
+
+void URebellionReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetClassPolicy(ActorInfo.Class))
+	{
+	case ERebellionClassRepPolicy::RELEVANT_ALL_CONNECTIONS:
+		alwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case ERebellionClassRepPolicy::SPATIALIZE_STATIC:
+		gridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case ERebellionClassRepPolicy::SPATIALIZE_DYNAMIC:
+		gridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case ERebellionClassRepPolicy::SPATIALIZE_DORMANCY:
+		gridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		if (ACharacter* character = Cast<ACharacter>(ActorInfo.Actor))
+		{
+			FDormancyCandidate& candidate = dormancyCandidates.AddDefaulted_GetRef();
+			candidate.character = character;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void URebellionReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetClassPolicy(ActorInfo.Class))
+	{
+	case ERebellionClassRepPolicy::RELEVANT_ALL_CONNECTIONS:
+		alwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case ERebellionClassRepPolicy::SPATIALIZE_STATIC:
+		gridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case ERebellionClassRepPolicy::SPATIALIZE_DYNAMIC:
+		gridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case ERebellionClassRepPolicy::SPATIALIZE_DORMANCY:
+		gridNode->RemoveActor_Dormancy(ActorInfo);
+		dormancyCandidates.RemoveAllSwap([&ActorInfo](const FDormancyCandidate& candidate)
+		{
+			return !candidate.character.IsValid() || candidate.character.Get() == ActorInfo.Actor;
+		});
+		break;
+	default:
+		break;
+	}
+}
+
+int32 URebellionReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	REBELLION_SCOPE(ReplicateActors);
+
+	const uint64 startCycles = FPlatformTime::Cycles64();
+	UpdateIdleDormancy(DeltaSeconds);
+	const int32 replicated = Super::ServerReplicateActors(DeltaSeconds);
+	lastReplicateMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+	return replicated;
+}
+
+void URebellionReplicationGraph::UpdateIdleDormancy(float DeltaSeconds)
+{
+	const float idleDormancySeconds = CVarNetIdleDormancySeconds.GetValueOnGameThread();
+
+	dormantCount = 0;
+	for (int32 index = dormancyCandidates.Num() - 1; index >= 0; index--)
+	{
+		FDormancyCandidate& candidate = dormancyCandidates[index];
+		ACharacter* character = candidate.character.Get();
+		if (!character)
+		{
+			dormancyCandidates.RemoveAtSwap(index);
+			continue;
+		}
+
+		//Players send moves every frame, and an attack montage can start without moving
+		const bool bIdle = idleDormancySeconds > 0.f && !character->IsPlayerControlled()
+			&& character->GetVelocity().SizeSquared() < idleSpeedSquared && !character->GetCurrentMontage();
+		if (!bIdle)
+		{
+			candidate.idleSeconds = 0.f;
+			if (character->NetDormancy > DORM_Awake)
+			{
+				REB_LOG(TRACE, "%s woke from dormancy", *character->GetName());
+				character->SetNetDormancy(DORM_Awake);
+			}
+			continue;
+		}
+
+		candidate.idleSeconds += DeltaSeconds;
+		if (candidate.idleSeconds >= idleDormancySeconds && character->NetDormancy == DORM_Awake)
+		{
+			REB_LOG(TRACE, "%s went dormant after %.1fs idle", *character->GetName(), candidate.idleSeconds);
+			character->SetNetDormancy(DORM_DormantAll);
+		}
+		if (character->NetDormancy > DORM_Awake)
+		{
+			dormantCount++;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_Rebellion_DormantCharacters, dormantCount);
+}
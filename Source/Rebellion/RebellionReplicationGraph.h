@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "RebellionReplicationGraph.generated.h"
+
+class ACharacter;
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+
+/** How a replicated class is routed into the graph, decided once per class */
+enum class ERebellionClassRepPolicy : uint8
+{
+	//Not added to any global node, owner only actors come from the connection's own node
+	NOT_ROUTED,
+	//Sent to every connection, game state, player states and other always relevant actors
+	RELEVANT_ALL_CONNECTIONS,
+	//Grid cells, by net cull distance from each viewer
+	SPATIALIZE_STATIC,
+	SPATIALIZE_DYNAMIC,
+	//Dynamic while awake, treated as static and skipped per connection while dormant
+	SPATIALIZE_DORMANCY
+};
+
+/**
+ * Replication driver for large sessions, set as ReplicationDriverClassName in DefaultEngine.ini.
+ * The default per actor relevancy loop asks every actor about every connection each net tick; here actors
+ * are routed once by class into a 2D grid of cells and every connection only gathers the cells around its
+ * viewers, plus one list of always relevant actors and its own player controller. Characters go in the
+ * grid with dormancy: characters nobody controls that stand idle for Rebellion.Net.IdleDormancySeconds
+ * go dormant, stop being considered for any connection and wake as soon as they move or attack.
+ * Rebellion.Bench.NetSoak measures the server side of a local multi client session.
+ */
+UCLASS(Transient)
+class REBELLION_API URebellionReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* ConnectionManager) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/** Time of the last net tick's replication, gather and send for every connection */
+	double GetLastReplicateMs() const { return lastReplicateMs; }
+	/** Characters that can go dormant and how many of them are */
+	int32 GetDormancyCandidateCount() const { return dormancyCandidates.Num(); }
+	int32 GetDormantCount() const { return dormantCount; }
+
+	UPROPERTY()
+		UReplicationGraphNode_GridSpatialization2D* gridNode;
+
+	UPROPERTY()
+		UReplicationGraphNode_ActorList* alwaysRelevantNode;
+
+private:
+
+	struct FDormancyCandidate
+	{
+		TWeakObjectPtr<ACharacter> character;
+		float idleSeconds = 0.f;
+	};
+
+	/** Policy from the class defaults, used to fill classPolicies */
+	static ERebellionClassRepPolicy ComputeClassPolicy(const AActor* actorDefaults);
+	/** Routing of a spawned actor's class, Blueprint subclasses inherit their native parent's */
+	ERebellionClassRepPolicy GetClassPolicy(const UClass* actorClass);
+	/** Puts idle characters nobody controls to sleep and wakes the ones that moved, before this tick's gather */
+	void UpdateIdleDormancy(float DeltaSeconds);
+
+	TClassMap<ERebellionClassRepPolicy> classPolicies;
+	TArray<FDormancyCandidate> dormancyCandidates;
+	int32 dormantCount = 0;
+	double lastReplicateMs = 0.0;
+};
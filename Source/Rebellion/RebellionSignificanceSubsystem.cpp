@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionSignificanceSubsystem.h"
+#include "RebellionStats.h"
+#include "LagCompensationSubsystem.h"
+#include "IAnimationBudgetAllocator.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "Camera/CameraComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/SpringArmComponent.h"
+
+static TAutoConsoleVariable<int32> CVarSignificanceEnabled(
+	TEXT("Rebellion.Significance.Enabled"),
+	1,
+	TEXT("Throttle character, movement and animation updates by significance. 0 updates everything at full rate."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarSignificanceNearDistance(
+	TEXT("Rebellion.Significance.NearDistance"),
+	1500.f,
+	TEXT("Distance from the closest player view at which a visible, idle character drops out of the FULL bucket."),
+	ECVF_Default);
+
+//Score multipliers, a hidden character counts as if it were further away and a fighting one as closer
+static const float hiddenScoreScale = 0.3f;
+static const float combatScoreScale = 3.f;
+//How long after an attack or hit a character still counts as in combat
+static const float combatGraceSeconds = 3.f;
+//Lowest score for each bucket, indexed by ESignificanceBucket
+static const float bucketMinScores[] = { 1.f, 0.4f, 0.15f, 0.f };
+//Tick intervals in seconds for each bucket
+static const float actorTickIntervals[] = { 0.f, 0.f, 0.1f, 0.25f };
+static const float movementTickIntervals[] = { 0.f, 0.f, 1.f / 20.f, 1.f / 10.f };
+//Allocator significance for the player and never skipped characters
+static const float maxBudgetSignificance = 1000.f;
+static_assert(UE_ARRAY_COUNT(bucketMinScores) == (int32)ESignificanceBucket::COUNT, "Every bucket needs a score");
+static_assert(UE_ARRAY_COUNT(actorTickIntervals) == (int32)ESignificanceBucket::COUNT, "Every bucket needs an actor tick interval");
+static_assert(UE_ARRAY_COUNT(movementTickIntervals) == (int32)ESignificanceBucket::COUNT, "Every bucket needs a movement tick interval");
+
+bool URebellionSignificanceSubsystem::IsEnabled()
+{
+	return CVarSignificanceEnabled.GetValueOnGameThread() != 0;
+}
+
+void URebellionSignificanceSubsystem::Deinitialize()
+{
+	trackedCharacters.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId URebellionSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URebellionSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType URebellionSignificanceSubsystem::GetTickableTickType() const
+{
+	//The class default object must never tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+void URebellionSignificanceSubsystem::RegisterCharacter(ACharacter* character)
+{
+	FTrackedCharacter& tracked = trackedCharacters.AddDefaulted_GetRef();
+	tracked.character = character;
+
+	if (USkeletalMeshComponent* mesh = character->GetMesh())
+	{
+		tracked.defaultAnimTickOption = mesh->VisibilityBasedAnimTickOption;
+		tracked.bDefaultUpdateRateOptimizations = mesh->bEnableUpdateRateOptimizations;
+	}
+}
+
+void URebellionSignificanceSubsystem::UnregisterCharacter(ACharacter* character)
+{
+	const int32 index = trackedCharacters.IndexOfByPredicate([character](const FTrackedCharacter& tracked) { return tracked.character == character; });
+	if (index != INDEX_NONE)
+	{
+		trackedCharacters.RemoveAtSwap(index);
+	}
+}
+
+void URebellionSignificanceSubsystem::NotifyCombat(AActor* actor)
+{
+	FTrackedCharacter* tracked = trackedCharacters.FindByPredicate([actor](const FTrackedCharacter& entry) { return entry.character == actor; });
+	if (tracked)
+	{
+		tracked->lastCombatTime = GetWorld()->GetTimeSeconds();
+	}
+}
+
+void URebellionSignificanceSubsystem::SetNeverSkipAnimation(ACharacter* character, bool bNeverSkip)
+{
+	FTrackedCharacter* tracked = trackedCharacters.FindByPredicate([character](const FTrackedCharacter& entry) { return entry.character == character; });
+	if (tracked && tracked->bNeverSkipAnimation != bNeverSkip)
+	{
+		tracked->bNeverSkipAnimation = bNeverSkip;
+		//Straight away, the window's first sweep may happen before our next tick
+		UpdateAnimationBudget(*tracked);
+	}
+}
+
+ESignificanceBucket URebellionSignificanceSubsystem::GetBucket(const ACharacter* character) const
+{
+	const FTrackedCharacter* tracked = trackedCharacters.FindByPredicate([character](const FTrackedCharacter& entry) { return entry.character == character; });
+	return tracked ? tracked->bucket : ESignificanceBucket::FULL;
+}
+
+void URebellionSignificanceSubsystem::Tick(float DeltaTime)
+{
+	REBELLION_SCOPE(SignificanceUpdate);
+
+	const bool bEnabled = IsEnabled();
+	const float worldTime = GetWorld()->GetTimeSeconds();
+	const ULagCompensationSubsystem* lagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	GatherViewLocations();
+
+	FMemory::Memzero(bucketCounts);
+	throttledMeshes = 0;
+	for (int32 index = trackedCharacters.Num() - 1; index >= 0; index--)
+	{
+		FTrackedCharacter& tracked = trackedCharacters[index];
+		if (!tracked.character.IsValid())
+		{
+			trackedCharacters.RemoveAtSwap(index);
+			continue;
+		}
+
+		//Possession can change at any time, the player pawn is possessed after its BeginPlay
+		const bool bPlayerView = IsPlayerView(tracked.character.Get());
+		if (bPlayerView != tracked.bPlayerView)
+		{
+			SetViewComponentsEnabled(tracked, bPlayerView);
+		}
+
+		//The server rewinds these to validate hit claims, throttling them would record a stale pose
+		tracked.bServerHitboxes = lagCompensation && lagCompensation->RecordsHitboxes(tracked.character.Get());
+
+		ESignificanceBucket bucket = ESignificanceBucket::FULL;
+		if (bEnabled && !tracked.bServerHitboxes)
+		{
+			tracked.score = ScoreCharacter(tracked, worldTime);
+			while (bucket < ESignificanceBucket::MINIMAL && tracked.score < bucketMinScores[(int32)bucket])
+			{
+				bucket = (ESignificanceBucket)((int32)bucket + 1);
+			}
+		}
+
+		if (bucket != tracked.bucket)
+		{
+			ApplyBucket(tracked, bucket);
+		}
+		bucketCounts[(int32)bucket]++;
+
+		//Tickables run after the world tick, so this is this frame's pose update
+		if (const USkeletalMeshComponentBudgeted* mesh = Cast<USkeletalMeshComponentBudgeted>(tracked.character->GetMesh()))
+		{
+			if (!mesh->PoseTickedThisFrame())
+			{
+				throttledMeshes++;
+			}
+			UpdateAnimationBudget(tracked);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_Rebellion_ThrottledCharacters, trackedCharacters.Num() - bucketCounts[(int32)ESignificanceBucket::FULL]);
+	SET_DWORD_STAT(STAT_Rebellion_ThrottledMeshes, throttledMeshes);
+	CSV_CUSTOM_STAT(Rebellion, ThrottledMeshes, throttledMeshes, ECsvCustomStatOp::Set);
+}
+
+bool URebellionSignificanceSubsystem::IsPlayerView(const ACharacter* character)
+{
+	return character->IsLocallyControlled() && !character->IsBotControlled();
+}
+
+void URebellionSignificanceSubsystem::SetViewComponentsEnabled(FTrackedCharacter& tracked, bool bEnabled)
+{
+	tracked.bPlayerView = bEnabled;
+
+	//Only the player's own view uses the boom and camera
+	ACharacter* character = tracked.character.Get();
+	if (USpringArmComponent* boom = character->FindComponentByClass<USpringArmComponent>())
+	{
+		boom->SetComponentTickEnabled(bEnabled);
+	}
+	if (UCameraComponent* camera = character->FindComponentByClass<UCameraComponent>())
+	{
+		camera->SetComponentTickEnabled(bEnabled);
+	}
+}
+
+void URebellionSignificanceSubsystem::GatherViewLocations()
+{
+	viewLocations.Reset();
+	for (FConstPlayerControllerIterator iterator = GetWorld()->GetPlayerControllerIterator(); iterator; ++iterator)
+	{
+		const APlayerController* controller = iterator->Get();
+		if (controller && controller->IsLocalController())
+		{
+			FVector location;
+			FRotator rotation;
+			controller->GetPlayerViewPoint(location, rotation);
+			viewLocations.Add(location);
+		}
+	}
+}
+
+float URebellionSignificanceSubsystem::ScoreCharacter(const FTrackedCharacter& tracked, float worldTime) const
+{
+	const ACharacter* character = tracked.character.Get();
+	if (tracked.bPlayerView)
+	{
+		return BIG_NUMBER;
+	}
+
+	//No local view (dedicated server), nothing is drawn so only combat matters
+	float distance = viewLocations.Num() > 0 ? MAX_flt : CVarSignificanceNearDistance.GetValueOnGameThread() * 4.f;
+	for (const FVector& viewLocation : viewLocations)
+	{
+		distance = FMath::Min(distance, FVector::Dist(viewLocation, character->GetActorLocation()));
+	}
+
+	float score = CVarSignificanceNearDistance.GetValueOnGameThread() / FMath::Max(distance, 1.f);
+
+	const USkeletalMeshComponent* mesh = character->GetMesh();
+	if (!mesh || !mesh->WasRecentlyRendered(0.2f))
+	{
+		score *= hiddenScoreScale;
+	}
+	if (worldTime - tracked.lastCombatTime < combatGraceSeconds)
+	{
+		score *= combatScoreScale;
+	}
+	return score;
+}
+
+void URebellionSignificanceSubsystem::ApplyBucket(FTrackedCharacter& tracked, ESignificanceBucket bucket)
+{
+	tracked.bucket = bucket;
+	ACharacter* character = tracked.character.Get();
+
+	character->SetActorTickInterval(actorTickIntervals[(int32)bucket]);
+	if (UCharacterMovementComponent* movement = character->GetCharacterMovement())
+	{
+		//Movement substeps over the longer delta (MaxSimulationTimeStep), so paths stay the same, just coarser
+		movement->SetComponentTickInterval(movementTickIntervals[(int32)bucket]);
+	}
+
+	//The budget allocator drives tick rate and interpolation of budgeted meshes itself
+	USkeletalMeshComponent* mesh = character->GetMesh();
+	if (mesh && !mesh->IsA<USkeletalMeshComponentBudgeted>())
+	{
+		//URO skips anim evaluation by screen size and interpolates the skipped frames
+		mesh->bEnableUpdateRateOptimizations = bucket == ESignificanceBucket::FULL ? tracked.bDefaultUpdateRateOptimizations : true;
+		//Montages keep ticking off screen so attack notifies still fire
+		const EVisibilityBasedAnimTickOption tickOption = tracked.bServerHitboxes ? EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones : tracked.defaultAnimTickOption;
+		mesh->VisibilityBasedAnimTickOption = bucket == ESignificanceBucket::MINIMAL ? EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered : tickOption;
+	}
+}
+
+void URebellionSignificanceSubsystem::UpdateAnimationBudget(const FTrackedCharacter& tracked) const
+{
+	USkeletalMeshComponentBudgeted* mesh = Cast<USkeletalMeshComponentBudgeted>(tracked.character->GetMesh());
+	IAnimationBudgetAllocator* allocator = IAnimationBudgetAllocator::Get(GetWorld());
+	if (!mesh || !allocator || mesh->GetAnimationBudgetHandle() == INDEX_NONE)
+	{
+		return;
+	}
+
+	//Attack windows need exact notify and socket timing, the player needs it to feel right
+	const bool bNeverSkip = tracked.bPlayerView || tracked.bNeverSkipAnimation || tracked.bServerHitboxes;
+	const float significance = bNeverSkip || !IsEnabled() ? maxBudgetSignificance : FMath::Min(tracked.score, maxBudgetSignificance);
+	//Nothing is rendered on a dedicated server, recorded hitboxes have to tick anyway
+	allocator->SetComponentSignificance(mesh, significance, bNeverSkip, tracked.bNeverSkipAnimation || tracked.bServerHitboxes);
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "RebellionSignificanceSubsystem.generated.h"
+
+class ACharacter;
+
+/** How much update budget a character gets, most significant first */
+UENUM()
+enum class ESignificanceBucket : uint8
+{
+	FULL,
+	//Not NEAR and FAR, windows.h defines both as empty macros
+	NEAR_VIEW,
+	FAR_VIEW,
+	MINIMAL,
+	COUNT		UMETA(Hidden)
+};
+
+/**
+ * Scores every registered character each frame by distance to the closest player viewpoint,
+ * whether it was rendered recently and whether it has been in combat lately, then buckets it.
+ * A bucket change sets the actor and movement component tick intervals, the mesh's Update Rate
+ * Optimizations (skipped anim frames are interpolated) and its off screen tick option.
+ * Locally controlled characters are always FULL, everyone else has camera boom and camera ticking off.
+ * Characters whose hitboxes ULagCompensationSubsystem records on the server are always FULL and never
+ * skip animation, claims are validated against their pose.
+ * Rebellion.Significance.Enabled 0 puts everyone back to FULL.
+ *
+ * Budgeted meshes (USkeletalMeshComponentBudgeted) are left to the animation budget allocator instead of
+ * URO: their score is its significance, and characters in an attack window are never skipped.
+ */
+UCLASS()
+class REBELLION_API URebellionSignificanceSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	void RegisterCharacter(ACharacter* character);
+	void UnregisterCharacter(ACharacter* character);
+
+	/** Keeps a character significant for a while after it attacks or is hit */
+	void NotifyCombat(AActor* actor);
+
+	/** Full rate animation regardless of budget, for the length of an attack window */
+	void SetNeverSkipAnimation(ACharacter* character, bool bNeverSkip);
+
+	/** Current bucket, FULL for characters that aren't registered */
+	ESignificanceBucket GetBucket(const ACharacter* character) const;
+
+	/** Rebellion.Significance.Enabled */
+	static bool IsEnabled();
+
+	/** Characters per bucket after the last update */
+	const int32* GetBucketCounts() const { return bucketCounts; }
+
+	/** Budgeted meshes whose pose was not evaluated last frame */
+	int32 GetThrottledMeshCount() const { return throttledMeshes; }
+
+private:
+
+	struct FTrackedCharacter
+	{
+		TWeakObjectPtr<ACharacter> character;
+		ESignificanceBucket bucket = ESignificanceBucket::FULL;
+		float lastCombatTime = -BIG_NUMBER;
+		float score = 1.f;
+		//Restored when the character returns to FULL
+		EVisibilityBasedAnimTickOption defaultAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+		bool bDefaultUpdateRateOptimizations = false;
+		//Boom and camera tick, components start enabled
+		bool bPlayerView = true;
+		bool bNeverSkipAnimation = false;
+		//Recorded for lag compensation on this server
+		bool bServerHitboxes = false;
+	};
+
+	static bool IsPlayerView(const ACharacter* character);
+	void SetViewComponentsEnabled(FTrackedCharacter& tracked, bool bEnabled);
+
+	void GatherViewLocations();
+	float ScoreCharacter(const FTrackedCharacter& tracked, float worldTime) const;
+	void ApplyBucket(FTrackedCharacter& tracked, ESignificanceBucket bucket);
+	void UpdateAnimationBudget(const FTrackedCharacter& tracked) const;
+
+	TArray<FTrackedCharacter> trackedCharacters;
+	TArray<FVector, TInlineAllocator<4>> viewLocations;
+	int32 bucketCounts[(int32)ESignificanceBucket::COUNT] = {};
+	int32 throttledMeshes = 0;
+};
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionStats.h"
+
+CSV_DEFINE_CATEGORY(Rebellion, true);
+
+DEFINE_STAT(STAT_Rebellion_AttackInput);
+DEFINE_STAT(STAT_Rebellion_AttackStart);
+DEFINE_STAT(STAT_Rebellion_AttackEnd);
+DEFINE_STAT(STAT_Rebellion_OnAttackHit);
+DEFINE_STAT(STAT_Rebellion_SweepWeapon);
+DEFINE_STAT(STAT_Rebellion_MoveForward);
+DEFINE_STAT(STAT_Rebellion_MoveRight);
+DEFINE_STAT(STAT_Rebellion_Dash);
+DEFINE_STAT(STAT_Rebellion_CombatTick);
+DEFINE_STAT(STAT_Rebellion_DamageResolve);
+DEFINE_STAT(STAT_Rebellion_HitCompute);
+DEFINE_STAT(STAT_Rebellion_SignificanceUpdate);
+DEFINE_STAT(STAT_Rebellion_CrowdUpdate);
+DEFINE_STAT(STAT_Rebellion_CrowdInstanceUpload);
+DEFINE_STAT(STAT_Rebellion_CombatAudioPlay);
+DEFINE_STAT(STAT_Rebellion_ProjectileIntegrate);
+DEFINE_STAT(STAT_Rebellion_ProjectileCollide);
+DEFINE_STAT(STAT_Rebellion_ProjectileInstanceUpload);
+DEFINE_STAT(STAT_Rebellion_LagCompRecord);
+DEFINE_STAT(STAT_Rebellion_ReplicateActors);
+
+DEFINE_STAT(STAT_Rebellion_AttackInputCalls);
+DEFINE_STAT(STAT_Rebellion_AttackWindows);
+DEFINE_STAT(STAT_Rebellion_WeaponHits);
+DEFINE_STAT(STAT_Rebellion_MoveCalls);
+DEFINE_STAT(STAT_Rebellion_DashCalls);
+DEFINE_STAT(STAT_Rebellion_WeaponSweeps);
+DEFINE_STAT(STAT_Rebellion_HitsResolved);
+DEFINE_STAT(STAT_Rebellion_HitsBlocked);
+DEFINE_STAT(STAT_Rebellion_WeaponSweepsCulled);
+DEFINE_STAT(STAT_Rebellion_CombatSoundsCulled);
+DEFINE_STAT(STAT_Rebellion_LagCompConfirmed);
+DEFINE_STAT(STAT_Rebellion_LagCompRejected);
+DEFINE_STAT(STAT_Rebellion_MovementCorrections);
+DEFINE_STAT(STAT_Rebellion_Characters);
+DEFINE_STAT(STAT_Rebellion_ThrottledCharacters);
+DEFINE_STAT(STAT_Rebellion_ThrottledMeshes);
+DEFINE_STAT(STAT_Rebellion_CrowdEnemies);
+DEFINE_STAT(STAT_Rebellion_CombatAudioVoices);
+DEFINE_STAT(STAT_Rebellion_LiveProjectiles);
+DEFINE_STAT(STAT_Rebellion_DormantCharacters);
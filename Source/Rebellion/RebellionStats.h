@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+//"stat Rebellion" in game, Rebellion category in -csvprofile captures
+DECLARE_STATS_GROUP(TEXT("Rebellion"), STATGROUP_Rebellion, STATCAT_Advanced);
+
+CSV_DECLARE_CATEGORY_EXTERN(Rebellion);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AttackInput"), STAT_Rebellion_AttackInput, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AttackStart"), STAT_Rebellion_AttackStart, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AttackEnd"), STAT_Rebellion_AttackEnd, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnAttackHit"), STAT_Rebellion_OnAttackHit, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SweepWeapon"), STAT_Rebellion_SweepWeapon, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MoveForward"), STAT_Rebellion_MoveForward, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MoveRight"), STAT_Rebellion_MoveRight, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Dash"), STAT_Rebellion_Dash, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Combat Subsystem Tick"), STAT_Rebellion_CombatTick, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Damage Resolve"), STAT_Rebellion_DamageResolve, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hit Compute"), STAT_Rebellion_HitCompute, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Significance Update"), STAT_Rebellion_SignificanceUpdate, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Update"), STAT_Rebellion_CrowdUpdate, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Instance Upload"), STAT_Rebellion_CrowdInstanceUpload, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Combat Audio Play"), STAT_Rebellion_CombatAudioPlay, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Integrate"), STAT_Rebellion_ProjectileIntegrate, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Collide"), STAT_Rebellion_ProjectileCollide, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Instance Upload"), STAT_Rebellion_ProjectileInstanceUpload, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lag Compensation Record"), STAT_Rebellion_LagCompRecord, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Replicate Actors"), STAT_Rebellion_ReplicateActors, STATGROUP_Rebellion, REBELLION_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("AttackInput Calls"), STAT_Rebellion_AttackInputCalls, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Attack Windows"), STAT_Rebellion_AttackWindows, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Weapon Hits"), STAT_Rebellion_WeaponHits, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Move Calls"), STAT_Rebellion_MoveCalls, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dash Calls"), STAT_Rebellion_DashCalls, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Weapon Sweeps Issued"), STAT_Rebellion_WeaponSweeps, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits Resolved"), STAT_Rebellion_HitsResolved, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits Blocked"), STAT_Rebellion_HitsBlocked, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Weapon Sweeps Culled"), STAT_Rebellion_WeaponSweepsCulled, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Combat Sounds Culled"), STAT_Rebellion_CombatSoundsCulled, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hit Claims Confirmed"), STAT_Rebellion_LagCompConfirmed, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hit Claims Rejected"), STAT_Rebellion_LagCompRejected, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Movement Corrections"), STAT_Rebellion_MovementCorrections, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Characters"), STAT_Rebellion_Characters, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Throttled Characters"), STAT_Rebellion_ThrottledCharacters, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Anim Throttled Meshes"), STAT_Rebellion_ThrottledMeshes, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd Enemies Alive"), STAT_Rebellion_CrowdEnemies, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Combat Audio Voices"), STAT_Rebellion_CombatAudioVoices, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Projectiles"), STAT_Rebellion_LiveProjectiles, STATGROUP_Rebellion, REBELLION_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Dormant Characters"), STAT_Rebellion_DormantCharacters, STATGROUP_Rebellion, REBELLION_API);
+
+/**
+ * One scope for all three profilers: stat cycle counter, CSV timing in the Rebellion category
+ * and an Unreal Insights CPU event. Divide by "Characters" for the per character cost.
+ */
+#define REBELLION_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_Rebellion_##Name); \
+	CSV_SCOPED_TIMING_STAT(Rebellion, Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Rebellion_##Name)
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InputComponent.h"
+#include "InputCoreTypes.h"
+
+/**
+ * Drives a pawn through the bindings it makes in SetupPlayerInputComponent without a player
+ * controller, so bots and replays exercise exactly the same handlers as real input.
+ * Pawn classes that want to be driven declare "friend struct FScriptedInput;".
+ */
+struct FScriptedInput
+{
+	/** Creates an input component owned by the pawn and lets the pawn bind its actions and axes to it */
+	template<class TPawn>
+	static UInputComponent* Bind(TPawn* pawn)
+	{
+		UInputComponent* inputComponent = NewObject<UInputComponent>(pawn, TEXT("ScriptedInputComponent"));
+		pawn->SetupPlayerInputComponent(inputComponent);
+		return inputComponent;
+	}
+
+	/** Fires every binding for actionName/keyEvent, returns false if nothing is bound */
+	static bool Action(UInputComponent* inputComponent, FName actionName, EInputEvent keyEvent)
+	{
+		bool bExecuted = false;
+		for (int32 index = 0; index < inputComponent->GetNumActionBindings(); index++)
+		{
+			FInputActionBinding& binding = inputComponent->GetActionBinding(index);
+			if (binding.KeyEvent == keyEvent && binding.GetActionName() == actionName)
+			{
+				binding.ActionDelegate.Execute(EKeys::Invalid);
+				bExecuted = true;
+			}
+		}
+		return bExecuted;
+	}
+
+	/** Feeds value to every binding of axisName, returns false if nothing is bound */
+	static bool Axis(UInputComponent* inputComponent, FName axisName, float value)
+	{
+		bool bExecuted = false;
+		for (FInputAxisBinding& binding : inputComponent->AxisBindings)
+		{
+			if (binding.AxisName == axisName)
+			{
+				binding.AxisDelegate.Execute(value);
+				bExecuted = true;
+			}
+		}
+		return bExecuted;
+	}
+};
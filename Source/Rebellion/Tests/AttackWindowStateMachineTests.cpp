@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AttackWindowStateMachine.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static constexpr uint32 attackWindowTestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter;
+
+//A new attack while the window is open closes it and winds up again
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAttackWindowInterruptTest, "Rebellion.Combat.AttackWindow.Interrupt", attackWindowTestFlags)
+bool FAttackWindowInterruptTest::RunTest(const FString& Parameters)
+{
+	FAttackWindowStateMachine window;
+	EAttackWindowState previous;
+
+	TestTrue(TEXT("Attack starts"), window.StartAttack(previous));
+	TestTrue(TEXT("Window opens"), window.NotifyBegin(previous));
+	const uint32 interruptedSerial = window.GetSerial();
+
+	TestTrue(TEXT("New attack interrupts the open window"), window.StartAttack(previous));
+	TestEqual(TEXT("Left the open window"), previous, EAttackWindowState::ACTIVE);
+	TestEqual(TEXT("Winding up the new attack"), window.GetState(), EAttackWindowState::WINDUP);
+	TestNotEqual(TEXT("New attack has its own serial"), window.GetSerial(), interruptedSerial);
+
+	//Starting again while already winding up changes no state but still replaces the attack
+	const uint32 windupSerial = window.GetSerial();
+	TestFalse(TEXT("Still winding up"), window.StartAttack(previous));
+	TestNotEqual(TEXT("Replaced attack has a new serial"), window.GetSerial(), windupSerial);
+	return true;
+}
+
+//The interrupted montage blends out after the new attack started, it must not end it
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAttackWindowStaleBlendOutTest, "Rebellion.Combat.AttackWindow.StaleBlendOut", attackWindowTestFlags)
+bool FAttackWindowStaleBlendOutTest::RunTest(const FString& Parameters)
+{
+	FAttackWindowStateMachine window;
+	EAttackWindowState previous;
+
+	window.StartAttack(previous);
+	const uint32 replacedSerial = window.GetSerial();
+	window.StartAttack(previous);
+	window.NotifyBegin(previous);
+
+	TestFalse(TEXT("Stale blend out ignored"), window.MontageBlendingOut(replacedSerial, previous));
+	TestEqual(TEXT("New attack still active"), window.GetState(), EAttackWindowState::ACTIVE);
+
+	window.NotifyEnd(previous);
+	TestTrue(TEXT("Current montage's blend out ends the attack"), window.MontageBlendingOut(window.GetSerial(), previous));
+	TestEqual(TEXT("Left recovery"), previous, EAttackWindowState::RECOVERY);
+	TestEqual(TEXT("Idle"), window.GetState(), EAttackWindowState::IDLE);
+	return true;
+}
+
+//A notify end arriving after the window was already closed doesn't reopen recovery
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAttackWindowLateNotifyEndTest, "Rebellion.Combat.AttackWindow.LateNotifyEnd", attackWindowTestFlags)
+bool FAttackWindowLateNotifyEndTest::RunTest(const FString& Parameters)
+{
+	FAttackWindowStateMachine window;
+	EAttackWindowState previous;
+
+	//Montage blended out with the window open
+	window.StartAttack(previous);
+	window.NotifyBegin(previous);
+	TestTrue(TEXT("Blend out closes the open window"), window.MontageBlendingOut(window.GetSerial(), previous));
+	TestEqual(TEXT("Left the open window"), previous, EAttackWindowState::ACTIVE);
+	TestFalse(TEXT("Late notify end ignored when idle"), window.NotifyEnd(previous));
+	TestEqual(TEXT("Still idle"), window.GetState(), EAttackWindowState::IDLE);
+
+	//Next attack interrupted the window before its notify ended
+	window.StartAttack(previous);
+	window.NotifyBegin(previous);
+	window.StartAttack(previous);
+	TestFalse(TEXT("Late notify end ignored while winding up"), window.NotifyEnd(previous));
+	TestEqual(TEXT("Still winding up"), window.GetState(), EAttackWindowState::WINDUP);
+	return true;
+}
+
+//Death stops the attack with its window open, its montage events arriving after are ignored
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAttackWindowDeathTest, "Rebellion.Combat.AttackWindow.DeathMidWindow", attackWindowTestFlags)
+bool FAttackWindowDeathTest::RunTest(const FString& Parameters)
+{
+	FAttackWindowStateMachine window;
+	EAttackWindowState previous;
+
+	window.StartAttack(previous);
+	window.NotifyBegin(previous);
+	const uint32 serial = window.GetSerial();
+
+	TestTrue(TEXT("Death stops the attack"), window.Stop(previous));
+	TestEqual(TEXT("Left the open window"), previous, EAttackWindowState::ACTIVE);
+	TestEqual(TEXT("Idle"), window.GetState(), EAttackWindowState::IDLE);
+
+	TestFalse(TEXT("Notify end after death ignored"), window.NotifyEnd(previous));
+	TestFalse(TEXT("Blend out of the stopped montage ignored"), window.MontageBlendingOut(serial, previous));
+	TestFalse(TEXT("Stopping again changes nothing"), window.Stop(previous));
+	TestEqual(TEXT("Still idle"), window.GetState(), EAttackWindowState::IDLE);
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
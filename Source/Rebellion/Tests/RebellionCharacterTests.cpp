@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RebellionCharacter.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static constexpr uint32 characterTestFlags = EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter;
+
+//A character spawned into a running world with nothing else set up can attack, and the server plays its attacks
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRebellionCharacterNewCanAttackTest, "Rebellion.Combat.Character.NewCharacterCanAttack", characterTestFlags)
+bool FRebellionCharacterNewCanAttackTest::RunTest(const FString& Parameters)
+{
+	UWorld* world = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	worldContext.SetCurrentWorld(world);
+	world->InitializeActorsForPlay(FURL());
+	//No game mode to start play, actors spawned after this get BeginPlay straight away
+	world->GetWorldSettings()->NotifyBeginPlay();
+
+	ARebellionCharacter* character = world->SpawnActor<ARebellionCharacter>();
+	if (TestNotNull(TEXT("Character spawned"), character))
+	{
+		TestFalse(TEXT("Alive"), character->IsDead());
+		TestTrue(TEXT("New character can start an attack"), character->CanStartAttack());
+		TestTrue(TEXT("Server accepts its first attack"), character->CanAcceptClientAttack(0));
+		TestTrue(TEXT("Server accepts it at any start tick"), character->CanAcceptClientAttack(MAX_uint16));
+
+		character->SetIsKeyboardEnabled(false);
+		TestFalse(TEXT("Locked input blocks attacks"), character->CanStartAttack());
+		TestFalse(TEXT("Server holds the client to the lock"), character->CanAcceptClientAttack(0));
+		character->SetIsKeyboardEnabled(true);
+		TestTrue(TEXT("Unlocked again"), character->CanStartAttack());
+	}
+
+	GEngine->DestroyWorldContext(world);
+	world->DestroyWorld(false);
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS